@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Device-side setup for the Arduino implementation of hal.h: attaches the
+// DHT22 driver, resolves the ingest host for the uplink and loads the key
+// that signs uploads as deviceId.
+void halArduinoBegin(const char* deviceId);
+
+// Stores this device's 32-byte request signing key in NVS and starts signing
+// with it. The key is HMAC-SHA256(INGEST_SIGNING_KEY, device id); see README.
+bool halSetSigningKey(const uint8_t* key, size_t length);
+bool halHasSigningKey();
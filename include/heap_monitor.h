@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+#include "json_writer.h"
+
+// Heap and stack health for long-uptime debugging: free heap, largest free
+// block (fragmentation), minimum-ever free, per-task stack high-water marks,
+// and a count of malloc/new calls made by the loop task.
+//
+// Allocation counting relies on the linker wrapping malloc/calloc/realloc/
+// free (see build_flags in platformio.ini); without HEAP_MONITOR_WRAP_MALLOC
+// the counters stay at zero.
+
+const int HEAP_MONITOR_MAX_TASKS = 4;
+
+struct AllocCounters {
+  uint32_t allocs;
+  uint32_t bytes;
+  uint32_t frees;
+};
+
+struct HeapCycleStats {
+  uint32_t freeHeap;
+  uint32_t largestFreeBlock;
+  uint32_t minFreeEver;
+  AllocCounters cycle;
+  AllocCounters uplink;
+  uint32_t cycles;
+  uint32_t allocatingCycles;
+};
+
+void heapMonitorBegin();
+void heapMonitorWatchTask(const char* name);
+
+AllocCounters allocCounters();
+AllocCounters allocDelta(const AllocCounters& since);
+
+void heapMonitorCycleStart();
+void heapMonitorCycleEnd();
+void heapMonitorUplinkStart();
+void heapMonitorUplinkEnd();
+
+const HeapCycleStats& heapMonitorStats();
+void heapMonitorPrint(Print& out);
+void heapMonitorAppendJson(JsonWriter& json);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "sample_history.h"
+
+// Local-network push stream of samples as Server-Sent Events on GET /events.
+// Each subscriber owns a bounded queue; when a slow client falls behind the
+// oldest queued event is dropped so the sampling loop never blocks on it.
+//
+// The same port answers GET /history from the on-device sample history:
+//
+//   /history?minutes=N               count, min, max, mean and alert count of
+//                                    every channel over the last N minutes,
+//                                    from the rollups past the raw ring
+//   /history?channel=z1_temp&minutes=N
+//                                    the same for one channel, plus its points
+//                                    as [ms ago, value, flags]
+//
+// minutes defaults to 60 and is cut to what the rings reach at the current
+// cycle interval (the raw ring alone when a channel is given); the reply
+// carries that limit as max_minutes, and requested_minutes when it applied.
+// The reply (about 50 KB for a day of one channel)
+// is written from the ring in small chunks, only as fast as the client takes
+// them, and the connection closed; a client that stalls is dropped. It holds
+// one of the LIVE_STREAM_MAX_CLIENTS slots meanwhile.
+
+const uint16_t LIVE_STREAM_PORT = 80;
+const int LIVE_STREAM_MAX_CLIENTS = 4;
+const int LIVE_STREAM_QUEUE_DEPTH = 8;
+const int LIVE_STREAM_EVENT_MAX = 256;
+const unsigned long LIVE_STREAM_KEEPALIVE_MS = 15000;
+
+void liveStreamBegin(const SampleHistory* history);
+void liveStreamService();
+void liveStreamPublish(const char* json, size_t length);
+int liveStreamClientCount();
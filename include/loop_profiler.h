@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+#include "json_writer.h"
+#include "profile_phases.h"
+
+// Per-phase latency histograms for the sampling/uplink cycle. Each phase keeps
+// fixed log2 buckets in microseconds (bucket 0 is < 1 us, bucket k covers
+// [2^(k-1), 2^k) us), so the cost is constant RAM regardless of uptime.
+
+const int PROFILE_BUCKETS = 26;
+
+struct PhaseStats {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint32_t lastUs;
+  uint64_t totalUs;
+  uint32_t buckets[PROFILE_BUCKETS];
+};
+
+void profileBegin(ProfilePhase phase);
+void profileEnd(ProfilePhase phase);
+void profileReset();
+
+const PhaseStats& profileStats(ProfilePhase phase);
+uint32_t profilePercentileUs(ProfilePhase phase, float percentile);
+
+void profilePrint(Print& out);
+void profileAppendJson(JsonWriter& json);
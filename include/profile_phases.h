@@ -0,0 +1,25 @@
+#pragma once
+
+// Cycle phases timed by the loop profiler. Shared with the trace decoder,
+// which names phase_begin/phase_end records by this index.
+
+enum ProfilePhase {
+  PHASE_ADC,
+  PHASE_DHT,
+  PHASE_ALERTS,
+  PHASE_LCD1,
+  PHASE_LCD2,
+  PHASE_JSON,
+  PHASE_TLS_CONNECT,
+  PHASE_POST,
+  PHASE_RESPONSE,
+  PHASE_SIGN,
+  PHASE_COUNT
+};
+
+inline const char* profilePhaseName(int phase) {
+  static const char* const NAMES[PHASE_COUNT] = {
+    "adc", "dht", "alerts", "lcd1", "lcd2", "json", "tls", "post", "resp", "sign"
+  };
+  return (phase >= 0 && phase < PHASE_COUNT) ? NAMES[phase] : "unknown";
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Arduino.h>
+#include "trace_events.h"
+
+// Fixed-size ring of binary trace records. Recording is a handful of stores,
+// so it can sit on the hot path where Serial prints used to be; the history
+// is dumped on demand with the `trace` serial command and decoded on the
+// host with tools/trace_decode.
+
+const int TRACE_CAPACITY = 512;
+
+void trace(TraceEvent event, uint16_t aux = 0, int32_t arg = 0);
+void traceFloat(TraceEvent event, uint16_t aux, float value);
+void traceClear();
+void traceDump(Print& out);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+
+// Binary trace record layout and event catalogue, shared by the firmware
+// ring buffer and the host-side decoder in tools/trace_decode. Records are
+// written little-endian; keep this header free of Arduino dependencies.
+
+const uint8_t TRACE_FORMAT_VERSION = 1;
+
+struct TraceRecord {
+  uint32_t timestampUs;
+  uint16_t event;
+  uint16_t aux;
+  int32_t arg;
+};
+
+static_assert(sizeof(TraceRecord) == 12, "TraceRecord must stay 12 bytes");
+
+enum TraceArgKind {
+  TRACE_ARG_NONE,
+  TRACE_ARG_INT,
+  TRACE_ARG_FLOAT,
+  TRACE_ARG_IPV4,
+  TRACE_ARG_MAC,
+  TRACE_ARG_PHASE
+};
+
+enum TraceEvent : uint16_t {
+  TRACE_BOOT,
+  TRACE_NTC_INVALID_ADC,
+  TRACE_NTC_TERM1_INVALID,
+  TRACE_NTC_TERM4_ZERO,
+  TRACE_NTC_NOT_FINITE,
+  TRACE_DHT_ERROR,
+  TRACE_WIFI_CONNECTING,
+  TRACE_WIFI_MAC,
+  TRACE_WIFI_RETRY,
+  TRACE_WIFI_CONNECTED,
+  TRACE_WIFI_FAILED,
+  TRACE_WIFI_NOT_CONNECTED,
+  TRACE_PAYLOAD_BUILT,
+  TRACE_UPLINK_BEGIN,
+  TRACE_TLS_CONNECT_FAILED,
+  TRACE_HTTP_RESPONSE,
+  TRACE_HTTP_UNEXPECTED_STATUS,
+  TRACE_HTTP_ERROR,
+  TRACE_CYCLE_OVERRUN,
+  TRACE_PHASE_BEGIN,
+  TRACE_PHASE_END,
+  TRACE_UPLINK_UNSIGNED,
+  TRACE_EVENT_COUNT
+};
+
+struct TraceEventInfo {
+  const char* name;
+  TraceArgKind argKind;
+  const char* auxLabel;
+};
+
+// aux carries the pin for sensor events, the phase index for phase events,
+// the first two MAC bytes for TRACE_WIFI_MAC and the body length for responses.
+// TRACE_UPLINK_UNSIGNED's arg is why the request was sent unsigned: 0 no
+// signing key is provisioned, 1 the clock has not been set by SNTP yet.
+inline const TraceEventInfo& traceEventInfo(uint16_t event) {
+  static const TraceEventInfo INFO[TRACE_EVENT_COUNT + 1] = {
+    {"boot", TRACE_ARG_NONE, nullptr},
+    {"ntc_invalid_adc", TRACE_ARG_INT, "pin"},
+    {"ntc_term1_invalid", TRACE_ARG_FLOAT, "pin"},
+    {"ntc_term4_zero", TRACE_ARG_FLOAT, "pin"},
+    {"ntc_not_finite", TRACE_ARG_FLOAT, "pin"},
+    {"dht_error", TRACE_ARG_INT, "pin"},
+    {"wifi_connecting", TRACE_ARG_INT, "channel"},
+    {"wifi_mac", TRACE_ARG_MAC, nullptr},
+    {"wifi_retry", TRACE_ARG_INT, "attempt"},
+    {"wifi_connected", TRACE_ARG_IPV4, nullptr},
+    {"wifi_failed", TRACE_ARG_INT, "attempts"},
+    {"wifi_not_connected", TRACE_ARG_NONE, nullptr},
+    {"payload_built", TRACE_ARG_INT, nullptr},
+    {"uplink_begin", TRACE_ARG_INT, nullptr},
+    {"tls_connect_failed", TRACE_ARG_NONE, "port"},
+    {"http_response", TRACE_ARG_INT, "body_len"},
+    {"http_unexpected_status", TRACE_ARG_INT, nullptr},
+    {"http_error", TRACE_ARG_INT, nullptr},
+    {"cycle_overrun", TRACE_ARG_INT, nullptr},
+    {"phase_begin", TRACE_ARG_PHASE, nullptr},
+    {"phase_end", TRACE_ARG_PHASE, nullptr},
+    {"uplink_unsigned", TRACE_ARG_INT, nullptr},
+    {"unknown", TRACE_ARG_INT, "aux"}
+  };
+  return INFO[event < TRACE_EVENT_COUNT ? event : (uint16_t)TRACE_EVENT_COUNT];
+}
@@ -0,0 +1,177 @@
+#include "hal_sim.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "hal.h"
+#include "device_config.h"
+
+struct SimState {
+  int analog[SIM_PIN_COUNT] = {};
+  bool digital[SIM_PIN_COUNT] = {};
+  bool output[SIM_PIN_COUNT] = {};
+  uint32_t digitalWrites[SIM_PIN_COUNT] = {};
+  uint64_t nowUs = 0;
+  float temperatureC = 22.0f;
+  float humidity = 45.0f;
+  bool climateOk = true;
+  int climateStatus = 0;
+  uint32_t storedSequence = 0;
+  uint32_t sequenceStores = 0;
+  uint8_t storedConfig[SIM_CONFIG_CAPACITY] = {};
+  size_t storedConfigLength = 0;
+  SimHttpSink http = {0, 0, 204, {0}, 0};
+};
+
+static SimState sim;
+
+static bool validPin(int pin) {
+  return pin >= 0 && pin < SIM_PIN_COUNT;
+}
+
+void simReset() {
+  sim = SimState();
+}
+
+void simSetAnalog(int pin, int raw) {
+  if (validPin(pin)) sim.analog[pin] = raw;
+}
+
+int simAdcForCelsius(float celsius) {
+  const DeviceConfig& config = deviceConfig;
+  float term4 = 1.0f / (celsius + 273.15f);
+  float term2 = (term4 - 1.0f / config.ntcT0Kelvin) * config.ntcBeta;
+  float term1 = config.ntcSeriesOhm / config.ntcNominalOhm * expf(-term2);
+  return (int)lroundf(config.adcMax / (term1 + 1.0f));
+}
+
+int simAdcForLux(float lux) {
+  if (lux <= 0) return 0;
+  const DeviceConfig& config = deviceConfig;
+  float resistance = config.ldrRl10KOhm * 1e3f * powf(10, config.ldrGamma) / powf(lux, config.ldrGamma);
+  float voltage = config.adcRefVoltage * resistance / (config.ldrSeriesOhm + resistance);
+  return (int)lroundf(voltage / config.adcRefVoltage * config.adcMax);
+}
+
+bool simDigitalState(int pin) {
+  return validPin(pin) && sim.digital[pin];
+}
+
+uint32_t simDigitalWrites(int pin) {
+  return validPin(pin) ? sim.digitalWrites[pin] : 0;
+}
+
+void simAdvanceMs(uint32_t ms) {
+  sim.nowUs += (uint64_t)ms * 1000;
+}
+
+void simAdvanceUs(uint32_t us) {
+  sim.nowUs += us;
+}
+
+void simSetClimate(float temperatureC, float humidity) {
+  sim.temperatureC = temperatureC;
+  sim.humidity = humidity;
+  sim.climateOk = true;
+  sim.climateStatus = 0;
+}
+
+void simSetClimateFailure(int status) {
+  sim.climateOk = false;
+  sim.climateStatus = status;
+}
+
+uint32_t simStoredSequence() {
+  return sim.storedSequence;
+}
+
+uint32_t simSequenceStores() {
+  return sim.sequenceStores;
+}
+
+void simSetStoredSequence(uint32_t next) {
+  sim.storedSequence = next;
+}
+
+const uint8_t* simStoredConfig(size_t& length) {
+  length = sim.storedConfigLength;
+  return sim.storedConfig;
+}
+
+void simSetStoredConfig(const void* data, size_t length) {
+  if (length > SIM_CONFIG_CAPACITY) length = SIM_CONFIG_CAPACITY;
+  memcpy(sim.storedConfig, data, length);
+  sim.storedConfigLength = length;
+}
+
+SimHttpSink& simHttpSink() {
+  return sim.http;
+}
+
+void simSetHttpStatus(int status) {
+  sim.http.responseStatus = status;
+}
+
+void halPinModeOutput(int pin) {
+  if (validPin(pin)) sim.output[pin] = true;
+}
+
+void halDigitalWrite(int pin, bool high) {
+  if (!validPin(pin)) return;
+  sim.digital[pin] = high;
+  sim.digitalWrites[pin]++;
+}
+
+int halAnalogRead(int pin) {
+  return validPin(pin) ? sim.analog[pin] : 0;
+}
+
+uint32_t halMillis() {
+  return (uint32_t)(sim.nowUs / 1000);
+}
+
+uint32_t halMicros() {
+  return (uint32_t)sim.nowUs;
+}
+
+void halDelay(uint32_t ms) {
+  simAdvanceMs(ms);
+}
+
+bool halReadClimate(float& temperatureC, float& humidity, int& status) {
+  status = sim.climateStatus;
+  if (!sim.climateOk) return false;
+  temperatureC = sim.temperatureC;
+  humidity = sim.humidity;
+  return true;
+}
+
+uint32_t halLoadSequence() {
+  return sim.storedSequence;
+}
+
+void halStoreSequence(uint32_t next) {
+  sim.storedSequence = next;
+  sim.sequenceStores++;
+}
+
+size_t halLoadConfig(void* data, size_t capacity) {
+  memcpy(data, sim.storedConfig, capacity < sim.storedConfigLength ? capacity : sim.storedConfigLength);
+  return sim.storedConfigLength;
+}
+
+bool halStoreConfig(const void* data, size_t length) {
+  if (length > SIM_CONFIG_CAPACITY) return false;
+  simSetStoredConfig(data, length);
+  return true;
+}
+
+int halHttpPost(const char* body, size_t length) {
+  sim.http.posts++;
+  sim.http.bytes += length;
+  size_t kept = length < sizeof(sim.http.lastBody) - 1 ? length : sizeof(sim.http.lastBody) - 1;
+  memcpy(sim.http.lastBody, body, kept);
+  sim.http.lastBody[kept] = '\0';
+  sim.http.lastLength = length;
+  return sim.http.responseStatus;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Controls for the simulated hardware behind hal.h. Time only moves when the
+// code under test calls halDelay() or the harness calls simAdvanceMs(), so a
+// simulated 30 s cycle costs microseconds of wall time.
+
+const int SIM_PIN_COUNT = 40;
+
+void simReset();
+
+void simSetAnalog(int pin, int raw);
+
+// Inverse of the firmware conversions: the ADC code the NTC divider or LDR
+// divider would produce for a given temperature or illuminance.
+int simAdcForCelsius(float celsius);
+int simAdcForLux(float lux);
+bool simDigitalState(int pin);
+uint32_t simDigitalWrites(int pin);
+
+void simAdvanceMs(uint32_t ms);
+void simAdvanceUs(uint32_t us);
+
+void simSetClimate(float temperatureC, float humidity);
+void simSetClimateFailure(int status);
+
+struct SimHttpSink {
+  uint32_t posts;
+  uint64_t bytes;
+  int responseStatus;
+  char lastBody[1024];
+  size_t lastLength;
+};
+
+// The value behind halLoadSequence()/halStoreSequence(), and how many times
+// it was written.
+uint32_t simStoredSequence();
+uint32_t simSequenceStores();
+void simSetStoredSequence(uint32_t next);
+
+// The blob behind halLoadConfig()/halStoreConfig(). Longer blobs are cut
+// short when set directly and refused when stored through the HAL.
+const size_t SIM_CONFIG_CAPACITY = 512;
+const uint8_t* simStoredConfig(size_t& length);
+void simSetStoredConfig(const void* data, size_t length);
+
+SimHttpSink& simHttpSink();
+void simSetHttpStatus(int status);
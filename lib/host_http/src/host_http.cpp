@@ -0,0 +1,229 @@
+#include "host_http.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+
+static const size_t MAX_HEADER_BYTES = 16 * 1024;
+
+const std::string* HttpMessage::header(const std::string& name) const {
+  auto it = headers.find(name);
+  return it == headers.end() ? nullptr : &it->second;
+}
+
+bool HttpMessage::keepAlive() const {
+  const std::string* connection = header("connection");
+  if (!connection) return true;
+  std::string value = *connection;
+  for (char& c : value) c = (char)tolower((unsigned char)c);
+  return value.find("close") == std::string::npos;
+}
+
+HttpConnection::~HttpConnection() {
+  if (ssl_) {
+    SSL_shutdown(ssl_);
+    SSL_free(ssl_);
+  }
+  if (fd_ >= 0) close(fd_);
+}
+
+long HttpConnection::readSome(char* buffer, size_t length) {
+  long n;
+  if (ssl_) {
+    n = SSL_read(ssl_, buffer, (int)length);
+  } else {
+    do {
+      n = recv(fd_, buffer, length, 0);
+    } while (n < 0 && errno == EINTR);
+  }
+  if (n > 0) bytesRead_ += n;
+  return n;
+}
+
+bool HttpConnection::writeAll(const char* data, size_t length) {
+  while (length > 0) {
+    long n;
+    if (ssl_) {
+      n = SSL_write(ssl_, data, (int)length);
+    } else {
+      n = send(fd_, data, length, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR) continue;
+    }
+    if (n <= 0) return false;
+    bytesWritten_ += n;
+    data += n;
+    length -= n;
+  }
+  return true;
+}
+
+static std::string trim(const std::string& s) {
+  size_t start = s.find_first_not_of(" \t");
+  size_t end = s.find_last_not_of(" \t\r");
+  return start == std::string::npos ? "" : s.substr(start, end - start + 1);
+}
+
+bool HttpConnection::readMessage(HttpMessage& message, bool isRequest, size_t maxBody) {
+  char buffer[8192];
+  size_t headerEnd;
+  while ((headerEnd = pending_.find("\r\n\r\n")) == std::string::npos) {
+    if (pending_.size() > MAX_HEADER_BYTES) return false;
+    long n = readSome(buffer, sizeof(buffer));
+    if (n <= 0) return false;
+    pending_.append(buffer, n);
+  }
+
+  message = HttpMessage();
+  size_t lineEnd = pending_.find("\r\n");
+  std::string startLine = pending_.substr(0, lineEnd);
+  size_t firstSpace = startLine.find(' ');
+  size_t secondSpace = firstSpace == std::string::npos ? std::string::npos : startLine.find(' ', firstSpace + 1);
+  if (firstSpace == std::string::npos) return false;
+  if (isRequest) {
+    message.method = startLine.substr(0, firstSpace);
+    message.target = startLine.substr(firstSpace + 1, secondSpace == std::string::npos ? std::string::npos : secondSpace - firstSpace - 1);
+  } else {
+    message.status = atoi(startLine.c_str() + firstSpace + 1);
+  }
+
+  size_t pos = lineEnd + 2;
+  while (pos < headerEnd) {
+    size_t end = pending_.find("\r\n", pos);
+    std::string line = pending_.substr(pos, end - pos);
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+      std::string name = line.substr(0, colon);
+      for (char& c : name) c = (char)tolower((unsigned char)c);
+      message.headers[name] = trim(line.substr(colon + 1));
+    }
+    pos = end + 2;
+  }
+
+  size_t contentLength = 0;
+  if (const std::string* length = message.header("content-length")) {
+    contentLength = strtoul(length->c_str(), nullptr, 10);
+    if (contentLength > maxBody) return false;
+  }
+  pending_.erase(0, headerEnd + 4);
+
+  while (pending_.size() < contentLength) {
+    long n = readSome(buffer, sizeof(buffer));
+    if (n <= 0) return false;
+    pending_.append(buffer, n);
+  }
+  message.body = pending_.substr(0, contentLength);
+  pending_.erase(0, contentLength);
+  return true;
+}
+
+int listenTcp(uint16_t port, int backlog) {
+  int fd = socket(AF_INET6, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  int on = 1;
+  int off = 0;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+  sockaddr_in6 addr = {};
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(port);
+  if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int connectTcp(const char* host, uint16_t port) {
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+
+  addrinfo* results = nullptr;
+  if (getaddrinfo(host, service, &hints, &results) != 0) return -1;
+
+  int fd = -1;
+  for (addrinfo* ai = results; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) continue;
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(results);
+
+  if (fd >= 0) {
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  }
+  return fd;
+}
+
+SSL_CTX* createServerTlsContext(const char* certPath, const char* keyPath) {
+  SSL_CTX* context = SSL_CTX_new(TLS_server_method());
+  if (!context) return nullptr;
+  if (SSL_CTX_use_certificate_chain_file(context, certPath) != 1 ||
+      SSL_CTX_use_PrivateKey_file(context, keyPath, SSL_FILETYPE_PEM) != 1) {
+    ERR_print_errors_fp(stderr);
+    SSL_CTX_free(context);
+    return nullptr;
+  }
+  return context;
+}
+
+// No verification, matching the firmware's WiFiClientSecure::setInsecure().
+SSL_CTX* createClientTlsContext() {
+  SSL_CTX* context = SSL_CTX_new(TLS_client_method());
+  if (context) SSL_CTX_set_verify(context, SSL_VERIFY_NONE, nullptr);
+  return context;
+}
+
+SSL* tlsAccept(SSL_CTX* context, int fd) {
+  SSL* ssl = SSL_new(context);
+  SSL_set_fd(ssl, fd);
+  if (SSL_accept(ssl) != 1) {
+    SSL_free(ssl);
+    return nullptr;
+  }
+  return ssl;
+}
+
+SSL* tlsConnect(SSL_CTX* context, int fd, const char* serverName) {
+  SSL* ssl = SSL_new(context);
+  SSL_set_fd(ssl, fd);
+  SSL_set_tlsext_host_name(ssl, serverName);
+  if (SSL_connect(ssl) != 1) {
+    SSL_free(ssl);
+    return nullptr;
+  }
+  return ssl;
+}
+
+const char* httpReason(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 415: return "Unsupported Media Type";
+    case 500: return "Internal Server Error";
+    default: return "Unknown";
+  }
+}
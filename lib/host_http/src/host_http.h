@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include <openssl/ssl.h>
+
+// Just enough HTTP/1.1 for the local ingest stand-in and load driver:
+// blocking sockets, optional TLS, Content-Length bodies and keep-alive.
+
+struct HttpMessage {
+  std::string method;
+  std::string target;
+  int status = 0;
+  std::map<std::string, std::string> headers;  // names lower-cased
+  std::string body;
+
+  const std::string* header(const std::string& name) const;
+  bool keepAlive() const;
+};
+
+class HttpConnection {
+ public:
+  HttpConnection(int fd, SSL* ssl) : fd_(fd), ssl_(ssl) {}
+  ~HttpConnection();
+
+  HttpConnection(const HttpConnection&) = delete;
+  HttpConnection& operator=(const HttpConnection&) = delete;
+
+  bool writeAll(const char* data, size_t length);
+  bool writeAll(const std::string& data) { return writeAll(data.data(), data.size()); }
+
+  // Reads one request (isRequest) or response. Returns false on EOF, a
+  // malformed message, or a body larger than maxBody.
+  bool readMessage(HttpMessage& message, bool isRequest, size_t maxBody = 1 << 20);
+
+  uint64_t bytesRead() const { return bytesRead_; }
+  uint64_t bytesWritten() const { return bytesWritten_; }
+
+ private:
+  long readSome(char* buffer, size_t length);
+
+  int fd_;
+  SSL* ssl_;
+  std::string pending_;
+  uint64_t bytesRead_ = 0;
+  uint64_t bytesWritten_ = 0;
+};
+
+int listenTcp(uint16_t port, int backlog = 512);
+int connectTcp(const char* host, uint16_t port);
+
+SSL_CTX* createServerTlsContext(const char* certPath, const char* keyPath);
+SSL_CTX* createClientTlsContext();
+
+// Performs the TLS handshake on an accepted or connected socket; returns
+// nullptr (and leaves fd open) on failure.
+SSL* tlsAccept(SSL_CTX* context, int fd);
+SSL* tlsConnect(SSL_CTX* context, int fd, const char* serverName);
+
+const char* httpReason(int status);
@@ -0,0 +1,116 @@
+#include "request_signing.h"
+
+#include <string.h>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+static std::string toHex(const uint8_t* bytes, size_t length) {
+  std::string out(2 * length, '0');
+  for (size_t i = 0; i < length; i++) {
+    out[2 * i] = HEX_DIGITS[bytes[i] >> 4];
+    out[2 * i + 1] = HEX_DIGITS[bytes[i] & 0x0F];
+  }
+  return out;
+}
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool parseHex(const char* hex, std::vector<uint8_t>& out) {
+  size_t length = strlen(hex);
+  if (length % 2 != 0) return false;
+  out.resize(length / 2);
+  for (size_t i = 0; i < out.size(); i++) {
+    int high = hexDigit(hex[2 * i]);
+    int low = hexDigit(hex[2 * i + 1]);
+    if (high < 0 || low < 0) return false;
+    out[i] = (uint8_t)(high << 4 | low);
+  }
+  return true;
+}
+
+SigningKey deriveDeviceKey(const std::vector<uint8_t>& masterKey, const std::string& deviceId) {
+  SigningKey key;
+  HMAC(EVP_sha256(), masterKey.data(), (int)masterKey.size(), (const uint8_t*)deviceId.data(), deviceId.size(),
+       key.bytes, nullptr);
+  return key;
+}
+
+std::string randomNonce() {
+  uint8_t bytes[16];
+  RAND_bytes(bytes, sizeof(bytes));
+  return toHex(bytes, sizeof(bytes));
+}
+
+// t as sent, since the MAC covers its text.
+static void signatureMac(const SigningKey& key, const std::string& t, const std::string& nonce, const char* body,
+                         size_t length, uint8_t mac[32]) {
+  std::string message = t + '.' + nonce + '.';
+  message.append(body, length);
+  HMAC(EVP_sha256(), key.bytes, sizeof(key.bytes), (const uint8_t*)message.data(), message.size(), mac, nullptr);
+}
+
+std::string signatureHeader(const SigningKey& key, int64_t unixS, const std::string& nonce,
+                            const char* body, size_t length) {
+  uint8_t mac[32];
+  signatureMac(key, std::to_string(unixS), nonce, body, length, mac);
+  return "t=" + std::to_string(unixS) + ",n=" + nonce + ",v1=" + toHex(mac, sizeof(mac));
+}
+
+static std::string field(const std::string& header, const char* name) {
+  size_t start = 0;
+  size_t nameLength = strlen(name);
+  while (start < header.size()) {
+    size_t end = header.find(',', start);
+    if (end == std::string::npos) end = header.size();
+    size_t first = header.find_first_not_of(' ', start);
+    if (first < end && header.compare(first, nameLength, name) == 0 && header[first + nameLength] == '=') {
+      size_t value = first + nameLength + 1;
+      size_t last = header.find_last_not_of(' ', end - 1);
+      return last >= value ? header.substr(value, last - value + 1) : std::string();
+    }
+    start = end + 1;
+  }
+  return std::string();
+}
+
+static bool allOf(const std::string& text, const char* digits) {
+  return text.find_first_not_of(digits) == std::string::npos;
+}
+
+SignatureCheck checkSignature(const std::string& header, const SigningKey& key, const std::string& body,
+                              int64_t nowS, std::string& nonce) {
+  std::string t = field(header, "t");
+  std::string n = field(header, "n");
+  std::vector<uint8_t> mac;
+  if (t.empty() || t.size() > 12 || !allOf(t, "0123456789") || n.size() < 16 || n.size() > 64 ||
+      !allOf(n, HEX_DIGITS) || !parseHex(field(header, "v1").c_str(), mac) || mac.size() != 32) {
+    return SIGNATURE_MALFORMED;
+  }
+  nonce = n;
+  int64_t unixS = std::stoll(t);
+  if (unixS < nowS - SIGNATURE_WINDOW_S || unixS > nowS + SIGNATURE_WINDOW_S) return SIGNATURE_EXPIRED;
+
+  uint8_t expected[32];
+  signatureMac(key, t, n, body.data(), body.size(), expected);
+  return CRYPTO_memcmp(expected, mac.data(), sizeof(expected)) == 0 ? SIGNATURE_OK : SIGNATURE_INVALID;
+}
+
+const char* signatureError(SignatureCheck check) {
+  switch (check) {
+    case SIGNATURE_OK: return "";
+    case SIGNATURE_MALFORMED: return "Malformed signature";
+    case SIGNATURE_EXPIRED: return "Signature expired";
+    case SIGNATURE_INVALID: return "Invalid signature";
+  }
+  return "Invalid signature";
+}
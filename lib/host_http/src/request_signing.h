@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// Ingest request signing, as the firmware does it (src/hal_arduino.cpp) and
+// supabase/functions/log-sensor-data checks it:
+//
+//   X-Device-Id: <device id>
+//   X-Signature: t=<unix seconds>,n=<hex nonce>,v1=<hex HMAC-SHA256>
+//
+// with the MAC over "<t>.<n>." and the body, keyed with the device key
+// HMAC-SHA256(master key, device id).
+
+const size_t SIGNING_KEY_SIZE = 32;
+const int64_t SIGNATURE_WINDOW_S = 5 * 60;
+
+struct SigningKey {
+  uint8_t bytes[SIGNING_KEY_SIZE];
+};
+
+enum SignatureCheck {
+  SIGNATURE_OK,
+  SIGNATURE_MALFORMED,
+  SIGNATURE_EXPIRED,
+  SIGNATURE_INVALID
+};
+
+// Hex digits to bytes; false on odd length or a non-hex character.
+bool parseHex(const char* hex, std::vector<uint8_t>& out);
+
+SigningKey deriveDeviceKey(const std::vector<uint8_t>& masterKey, const std::string& deviceId);
+
+// A fresh random nonce of 16 bytes as hex.
+std::string randomNonce();
+
+std::string signatureHeader(const SigningKey& key, int64_t unixS, const std::string& nonce,
+                            const char* body, size_t length);
+
+// Parses the header, checks t against the window around nowS and the MAC in
+// constant time. nonce is set once the header parses, for the caller's
+// replay check.
+SignatureCheck checkSignature(const std::string& header, const SigningKey& key, const std::string& body,
+                              int64_t nowS, std::string& nonce);
+
+// The edge function's error message for a failed check.
+const char* signatureError(SignatureCheck check);
@@ -0,0 +1,446 @@
+#include "ingest_contract.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+std::string jsNumberToString(double value) {
+  if (isnan(value)) return "NaN";
+  if (isinf(value)) return value > 0 ? "Infinity" : "-Infinity";
+  if (value == 0) return "0";
+
+  char buf[40];
+  for (int precision = 1; precision <= 17; precision++) {
+    snprintf(buf, sizeof(buf), "%.*e", precision - 1, value);
+    if (strtod(buf, nullptr) == value) break;
+  }
+
+  // buf is [-]d[.ddd]e[+-]xx; split into sign, digits and decimal exponent n
+  // where value = 0.digits * 10^n, then lay it out the way ECMAScript does.
+  std::string sign;
+  const char* p = buf;
+  if (*p == '-') {
+    sign = "-";
+    p++;
+  }
+  std::string digits;
+  while (*p && *p != 'e') {
+    if (*p != '.') digits += *p;
+    p++;
+  }
+  int exponent = atoi(p + 1);
+  while (digits.size() > 1 && digits.back() == '0') digits.pop_back();
+
+  int k = (int)digits.size();
+  int n = exponent + 1;
+  std::string out;
+  if (k <= n && n <= 21) {
+    out = digits + std::string(n - k, '0');
+  } else if (0 < n && n <= 21) {
+    out = digits.substr(0, n) + "." + digits.substr(n);
+  } else if (-6 < n && n <= 0) {
+    out = "0." + std::string(-n, '0') + digits;
+  } else {
+    out = digits.substr(0, 1);
+    if (k > 1) out += "." + digits.substr(1);
+    out += (n - 1 >= 0) ? "e+" : "e-";
+    out += std::to_string(abs(n - 1));
+  }
+  return sign + out;
+}
+
+std::string jsString(const JsonValue& value) {
+  switch (value.type()) {
+    case JsonValue::NUL: return "null";
+    case JsonValue::BOOLEAN: return value.boolean() ? "true" : "false";
+    case JsonValue::NUMBER: return jsNumberToString(value.number());
+    case JsonValue::STRING: return value.string();
+    case JsonValue::OBJECT: return "[object Object]";
+    case JsonValue::ARRAY: {
+      // Array.prototype.join: null and undefined elements become "".
+      std::string out;
+      for (size_t i = 0; i < value.array().size(); i++) {
+        if (i > 0) out += ",";
+        const JsonValue& item = value.array()[i];
+        if (!item.isNull()) out += jsString(item);
+      }
+      return out;
+    }
+  }
+  return "";
+}
+
+static OptionalNumber parseSensorValue(const JsonValue* value) {
+  OptionalNumber result;
+  if (value && value->isNumber() && isfinite(value->number())) {
+    result.present = true;
+    result.value = value->number();
+  }
+  return result;
+}
+
+// `x ?? fallback`: only undefined (missing) and null fall through.
+static bool nullish(const JsonValue* value) {
+  return value == nullptr || value->isNull();
+}
+
+// parseSeq(): Number.isSafeInteger(x) && x >= 0.
+static OptionalNumber parseSeq(const JsonValue* value) {
+  OptionalNumber result;
+  if (value && value->isNumber() && value->number() >= 0 && value->number() <= 9007199254740991.0 &&
+      floor(value->number()) == value->number()) {
+    result.present = true;
+    result.value = value->number();
+  }
+  return result;
+}
+
+// parseLux(): "luxState" wins when it names a saturated end; firmware from
+// before that field sent the strings "DARK" and "BRIGHT" in place of lux.
+static void parseLux(const JsonValue* lux, const JsonValue* state, LogEntry& entry) {
+  if (state && state->isString() && (state->string() == "dark" || state->string() == "bright")) {
+    entry.z1LuxState = state->string();
+    return;
+  }
+  if (lux && lux->isString() && lux->string() == "DARK") {
+    entry.z1LuxState = "dark";
+    return;
+  }
+  if (lux && lux->isString() && lux->string() == "BRIGHT") {
+    entry.z1LuxState = "bright";
+    return;
+  }
+  entry.z1Lux = parseSensorValue(lux);
+  if (entry.z1Lux.present) entry.z1LuxState = "ok";
+}
+
+bool parseLogEntry(const char* body, size_t length, LogEntry& entry, std::string& error) {
+  JsonValue data;
+  if (!JsonValue::parse(body, length, data, &error)) {
+    error = "Invalid JSON payload";
+    return false;
+  }
+  return logEntryFromValue(data, entry, error);
+}
+
+bool logEntryFromValue(const JsonValue& data, LogEntry& entry, std::string& error) {
+  if (data.isNull()) {
+    error = "Cannot read properties of null (reading 'zone1')";
+    return false;
+  }
+
+  // `data.zone1 || {}`: a falsy zone becomes {}, and member access on any
+  // non-object yields undefined, which get() already returns as nullptr.
+  static const JsonValue EMPTY;
+  const JsonValue* z1 = data.get("zone1");
+  const JsonValue* z2 = data.get("zone2");
+  if (!z1 || !z1->truthy()) z1 = &EMPTY;
+  if (!z2 || !z2->truthy()) z2 = &EMPTY;
+
+  const JsonValue* lux = z1->get("lux");
+  const JsonValue* z1Alert = z1->get("alert");
+  const JsonValue* z2Alert = z2->get("alert");
+  const JsonValue* fanOn = data.get("fan_on");
+
+  entry = LogEntry();
+  entry.z1Temp = parseSensorValue(z1->get("tempC"));
+  parseLux(lux, z1->get("luxState"), entry);
+  entry.z1Alert = nullish(z1Alert) ? false : z1Alert->truthy();
+  entry.z2Temp = parseSensorValue(z2->get("dhtTempC"));
+  entry.z2Humidity = parseSensorValue(z2->get("humidity"));
+  entry.z2Alert = nullish(z2Alert) ? false : z2Alert->truthy();
+  entry.fanOn = nullish(fanOn) ? false : fanOn->truthy();
+  entry.seq = parseSeq(data.get("seq"));
+  const JsonValue* device = data.get("device");
+  if (!nullish(device)) {
+    entry.hasDevice = true;
+    entry.deviceId = jsString(*device);
+  }
+  return true;
+}
+
+static bool namesOther(const JsonValue* device, const std::string& signer) {
+  return !nullish(device) && jsString(*device) != signer;
+}
+
+bool namesOtherDevice(const JsonValue& data, const std::string& signer) {
+  auto anyReading = [&](const JsonValue& readings) {
+    for (const JsonValue& reading : readings.array()) {
+      if (namesOther(reading.get("device"), signer)) return true;
+    }
+    return false;
+  };
+  if (data.isArray()) return anyReading(data);
+  if (namesOther(data.get("device"), signer)) return true;
+  const JsonValue* readings = data.get("readings");
+  return readings && readings->isArray() && anyReading(*readings);
+}
+
+static void appendJsonString(std::string& out, const std::string& text) {
+  out += '"';
+  for (unsigned char c : text) {
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      case '\b': out += "\\b"; break;
+      case '\f': out += "\\f"; break;
+      default:
+        if (c < 0x20) {
+          char esc[8];
+          snprintf(esc, sizeof(esc), "\\u%04x", c);
+          out += esc;
+        } else {
+          out += (char)c;
+        }
+    }
+  }
+  out += '"';
+}
+
+static void appendOptional(std::string& out, const OptionalNumber& value) {
+  out += value.present ? jsNumberToString(value.value) : "null";
+}
+
+static void appendEntryFields(std::string& out, const LogEntry& entry) {
+  out += ",\"z1_temp\":";
+  appendOptional(out, entry.z1Temp);
+  out += ",\"z1_lux\":";
+  appendOptional(out, entry.z1Lux);
+  out += ",\"z1_lux_state\":";
+  if (entry.z1LuxState.empty()) out += "null"; else appendJsonString(out, entry.z1LuxState);
+  out += ",\"z1_alert\":";
+  out += entry.z1Alert ? "true" : "false";
+  out += ",\"z2_temp\":";
+  appendOptional(out, entry.z2Temp);
+  out += ",\"z2_humidity\":";
+  appendOptional(out, entry.z2Humidity);
+  out += ",\"z2_alert\":";
+  out += entry.z2Alert ? "true" : "false";
+  out += ",\"fan_on\":";
+  out += entry.fanOn ? "true" : "false";
+  out += ",\"seq\":";
+  appendOptional(out, entry.seq);
+  out += ",\"device_id\":";
+  if (entry.hasDevice) appendJsonString(out, entry.deviceId); else out += "null";
+}
+
+std::string logEntryToJson(const LogEntry& entry, uint64_t id, const std::string& createdAt) {
+  std::string out = "{\"id\":" + std::to_string(id) + ",\"created_at\":";
+  appendJsonString(out, createdAt);
+  appendEntryFields(out, entry);
+  out += "}";
+  return out;
+}
+
+std::string batchRowToJson(const BatchRow& row, uint64_t id, const std::string& createdAt) {
+  std::string out = "{\"id\":" + std::to_string(id) + ",\"created_at\":";
+  appendJsonString(out, createdAt);
+  appendEntryFields(out, row.entry);
+  out += ",\"recorded_at\":";
+  appendJsonString(out, row.recordedAt);
+  out += "}";
+  return out;
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date (Howard Hinnant's
+// days_from_civil) and its inverse.
+static int64_t daysFromCivil(int64_t y, int m, int d) {
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  int64_t yoe = y - era * 400;
+  int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+static void civilFromDays(int64_t z, int64_t& y, int& m, int& d) {
+  z += 719468;
+  int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  int64_t doe = z - era * 146097;
+  int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int64_t mp = (5 * doy + 2) / 153;
+  d = (int)(doy - (153 * mp + 2) / 5 + 1);
+  m = (int)(mp < 10 ? mp + 3 : mp - 9);
+  y = yoe + era * 400 + (m <= 2);
+}
+
+std::string isoTimestamp(int64_t ms) {
+  int64_t days = ms >= 0 ? ms / 86400000 : -((-ms + 86399999) / 86400000);
+  int64_t rest = ms - days * 86400000;
+  int64_t year;
+  int month;
+  int day;
+  civilFromDays(days, year, month, day);
+  char buf[40];
+  snprintf(buf, sizeof(buf), "%04lld-%02d-%02dT%02d:%02d:%02d.%03dZ", (long long)year, month, day,
+           (int)(rest / 3600000), (int)(rest / 60000 % 60), (int)(rest / 1000 % 60), (int)(rest % 1000));
+  return buf;
+}
+
+static bool readDigits(const char*& p, int count, int& value) {
+  value = 0;
+  for (int i = 0; i < count; i++) {
+    if (p[i] < '0' || p[i] > '9') return false;
+    value = value * 10 + (p[i] - '0');
+  }
+  p += count;
+  return true;
+}
+
+// YYYY-MM-DD[THH:MM[:SS[.sss]][Z|+HH:MM|-HH:MM]] as Date.parse() reads it;
+// no offset means UTC, the edge runtime's zone.
+static bool parseIsoTimestamp(const std::string& text, double& ms) {
+  const char* p = text.c_str();
+  int year, month, day, hour = 0, minute = 0, second = 0, millis = 0;
+  if (!readDigits(p, 4, year) || *p++ != '-' || !readDigits(p, 2, month) || *p++ != '-' || !readDigits(p, 2, day)) return false;
+  // V8 lets any day up to 31 roll into the next month ("2026-02-30" is
+  // 2 March); daysFromCivil() does the same.
+  if (month < 1 || month > 12 || day < 1 || day > 31) return false;
+  int offsetMinutes = 0;
+  if (*p == 'T') {
+    p++;
+    if (!readDigits(p, 2, hour) || *p++ != ':' || !readDigits(p, 2, minute)) return false;
+    if (*p == ':') {
+      p++;
+      if (!readDigits(p, 2, second)) return false;
+      if (*p == '.') {
+        p++;
+        int digits = 0;
+        int scale = 100;
+        while (*p >= '0' && *p <= '9') {
+          if (digits < 3) millis += (*p - '0') * scale;
+          scale /= 10;
+          digits++;
+          p++;
+        }
+        if (digits == 0) return false;
+      }
+    }
+    if (*p == 'Z') {
+      p++;
+    } else if (*p == '+' || *p == '-') {
+      int sign = *p++ == '-' ? -1 : 1;
+      int offsetHours, offsetMins;
+      if (!readDigits(p, 2, offsetHours) || *p++ != ':' || !readDigits(p, 2, offsetMins)) return false;
+      offsetMinutes = sign * (offsetHours * 60 + offsetMins);
+    }
+    if (minute > 59 || second > 59 || hour > 24 || (hour == 24 && (minute || second || millis))) return false;
+  }
+  if (*p != '\0') return false;
+  ms = (double)daysFromCivil(year, month, day) * 86400000.0 +
+       ((hour * 60.0 + minute - offsetMinutes) * 60.0 + second) * 1000.0 + millis;
+  return true;
+}
+
+bool isLogBatch(const JsonValue& data) {
+  if (data.isArray()) return true;
+  const JsonValue* readings = data.get("readings");
+  return readings && readings->isArray();
+}
+
+bool parseLogBatch(const JsonValue& data, int64_t nowMs, LogBatch& batch, int& status, std::string& error) {
+  const std::vector<JsonValue>& readings = data.isArray() ? data.array() : data.get("readings")->array();
+  const JsonValue* defaultDevice = data.isArray() ? nullptr : data.get("device");
+
+  batch = LogBatch();
+  if (readings.empty()) {
+    status = 400;
+    error = "Empty batch";
+    return false;
+  }
+  if (readings.size() > MAX_BATCH_ROWS) {
+    status = 413;
+    error = "Batch too large (max " + std::to_string(MAX_BATCH_ROWS) + " readings)";
+    return false;
+  }
+
+  for (size_t i = 0; i < readings.size(); i++) {
+    const JsonValue& reading = readings[i];
+    if (!reading.isObject()) {
+      batch.errors.push_back({i, "not an object"});
+      continue;
+    }
+
+    const JsonValue* ts = reading.get("ts");
+    double ms = NAN;
+    if (nullish(ts)) {
+      ms = (double)nowMs;
+    } else if (ts->isNumber()) {
+      ms = ts->number() < 1e12 ? ts->number() * 1000 : ts->number();
+    } else if (ts->isString() && !parseIsoTimestamp(ts->string(), ms)) {
+      ms = NAN;
+    }
+    if (!isfinite(ms) || ms < 0) {
+      batch.errors.push_back({i, "invalid ts"});
+      continue;
+    }
+    if (ms > (double)(nowMs + MAX_CLOCK_SKEW_MS)) {
+      batch.errors.push_back({i, "ts in the future"});
+      continue;
+    }
+    if (ms < (double)(nowMs - MAX_READING_AGE_MS)) {
+      batch.errors.push_back({i, "ts too old"});
+      continue;
+    }
+
+    BatchRow row;
+    std::string unused;
+    logEntryFromValue(reading, row.entry, unused);
+    if (!row.entry.hasDevice && !nullish(defaultDevice)) {
+      row.entry.hasDevice = true;
+      row.entry.deviceId = jsString(*defaultDevice);
+    }
+    row.recordedAt = isoTimestamp((int64_t)floor(ms));
+    batch.rows.push_back(row);
+  }
+  return true;
+}
+
+bool prefersMinimalAck(const std::string& prefer) {
+  size_t start = 0;
+  while (start <= prefer.size()) {
+    size_t end = prefer.find(',', start);
+    if (end == std::string::npos) end = prefer.size();
+    size_t first = prefer.find_first_not_of(" \t", start);
+    size_t last = prefer.find_last_not_of(" \t", end - 1);
+    if (first < end && last != std::string::npos && last >= first &&
+        prefer.compare(first, last - first + 1, "return=minimal") == 0) {
+      return true;
+    }
+    start = end + 1;
+  }
+  return false;
+}
+
+int logBatchStatus(const LogBatch& batch, bool minimal) {
+  if (batch.rows.empty()) return 422;
+  return minimal && batch.errors.empty() ? 204 : 201;
+}
+
+std::string logBatchResponse(const LogBatch& batch) {
+  std::string out;
+  if (batch.rows.empty()) {
+    out = "{\"error\":\"No valid readings\",\"accepted\":0";
+    out += ",\"rejected\":" + std::to_string(batch.errors.size());
+  } else {
+    out = "{\"status\":";
+    out += batch.errors.empty() ? "\"success\"" : "\"partial\"";
+    out += ",\"accepted\":" + std::to_string(batch.rows.size());
+    out += ",\"rejected\":" + std::to_string(batch.errors.size());
+    out += ",\"duplicates\":" + std::to_string(batch.duplicates);
+  }
+  out += ",\"errors\":[";
+  for (size_t i = 0; i < batch.errors.size(); i++) {
+    if (i > 0) out += ",";
+    out += "[" + std::to_string(batch.errors[i].index) + ",";
+    appendJsonString(out, batch.errors[i].message);
+    out += "]";
+  }
+  out += "]}";
+  return out;
+}
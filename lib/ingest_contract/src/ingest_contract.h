@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "json_value.h"
+
+// C++ mirror of how supabase/functions/log-sensor-data turns a request body
+// into a sensor_logs row, including its JavaScript coercions:
+// parseSensorValue() keeps only finite numbers, parseLux() for lux and its
+// saturation state, and Boolean(x ?? false) for the alert flags.
+
+struct OptionalNumber {
+  bool present = false;
+  double value = 0;
+};
+
+struct LogEntry {
+  OptionalNumber z1Temp;
+  OptionalNumber z1Lux;
+  // "ok", "dark" or "bright"; empty for null.
+  std::string z1LuxState;
+  bool z1Alert = false;
+  OptionalNumber z2Temp;
+  OptionalNumber z2Humidity;
+  bool z2Alert = false;
+  bool fanOn = false;
+  // parseSeq(): a non-negative safe integer, else null.
+  OptionalNumber seq;
+  // String(data.device) unless it is null or missing.
+  bool hasDevice = false;
+  std::string deviceId;
+};
+
+// Fails only where the edge function would throw: a body that is not JSON,
+// or a JSON null at the top level.
+bool parseLogEntry(const char* body, size_t length, LogEntry& entry, std::string& error);
+
+// buildLogEntry() on an already parsed body.
+bool logEntryFromValue(const JsonValue& data, LogEntry& entry, std::string& error);
+
+// The edge function's namesOtherDevice(): true when a signed upload names a
+// device, at the top level or in any reading, other than the one that
+// signed it (refused with 403).
+bool namesOtherDevice(const JsonValue& data, const std::string& signer);
+
+// Batch uploads: a bare array of readings or {"device": ..., "readings": [...]}.
+const size_t MAX_BATCH_ROWS = 500;
+const int64_t MAX_CLOCK_SKEW_MS = 5 * 60 * 1000;
+const int64_t MAX_READING_AGE_MS = 7 * 24 * 60 * 60 * 1000LL;
+
+// The entry's device falls back to the batch's "device".
+struct BatchRow {
+  LogEntry entry;
+  std::string recordedAt;
+};
+
+struct BatchError {
+  size_t index;
+  std::string message;
+};
+
+struct LogBatch {
+  std::vector<BatchRow> rows;
+  std::vector<BatchError> errors;
+  // Rows the database dropped as an already stored (device, seq); set by
+  // whoever does the insert.
+  size_t duplicates = 0;
+};
+
+bool isLogBatch(const JsonValue& data);
+
+// Per-reading validation as handleBatch() does it. Whole-batch failures
+// (empty, too large) return false with the HTTP status and error message.
+// Only ISO-8601 strings are understood for "ts", where Date.parse() also
+// accepts some engine-specific formats.
+bool parseLogBatch(const JsonValue& data, int64_t nowMs, LogBatch& batch, int& status, std::string& error);
+
+// The edge function's wantsMinimalAck(): "return=minimal" among the
+// comma-separated Prefer preferences. Such requests get a 204 with no body instead of the row echo
+// (and for batches, whenever no reading was rejected).
+bool prefersMinimalAck(const std::string& prefer);
+
+// The status handleBatch() answers a parsed batch with: 422 when every
+// reading was rejected, 204 for a minimal acknowledgement with none
+// rejected, 201 otherwise.
+int logBatchStatus(const LogBatch& batch, bool minimal);
+
+// The 201 body: {"status","accepted","rejected","duplicates","errors":[[index,"message"],...]},
+// or for a 422 {"error","accepted":0,"rejected","errors"}.
+std::string logBatchResponse(const LogBatch& batch);
+
+// A stored batch row, with device_id and recorded_at after the sensor fields.
+std::string batchRowToJson(const BatchRow& row, uint64_t id, const std::string& createdAt);
+
+// Date.prototype.toISOString() for epoch milliseconds.
+std::string isoTimestamp(int64_t ms);
+
+// The row as JSON, with the id and created_at the database would add and
+// device_id after the sensor fields.
+std::string logEntryToJson(const LogEntry& entry, uint64_t id, const std::string& createdAt);
+
+// Number formatting of JavaScript's String(n) / JSON.stringify(n).
+std::string jsNumberToString(double value);
+
+// String(value) for a parsed JSON value.
+std::string jsString(const JsonValue& value);
@@ -0,0 +1,259 @@
+#include "json_value.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int MAX_DEPTH = 64;
+
+class JsonParser {
+ public:
+  JsonParser(const char* text, size_t length) : p_(text), end_(text + length) {}
+
+  bool parseDocument(JsonValue& out) {
+    skipSpace();
+    if (!parseValue(out, 0)) return false;
+    skipSpace();
+    if (p_ != end_) return fail("trailing characters");
+    return true;
+  }
+
+  const std::string& error() const { return error_; }
+
+ private:
+  bool fail(const char* message) {
+    if (error_.empty()) error_ = message;
+    return false;
+  }
+
+  void skipSpace() {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) p_++;
+  }
+
+  bool literal(const char* word) {
+    size_t len = strlen(word);
+    if ((size_t)(end_ - p_) < len || memcmp(p_, word, len) != 0) return fail("invalid literal");
+    p_ += len;
+    return true;
+  }
+
+  bool parseValue(JsonValue& out, int depth) {
+    if (depth > MAX_DEPTH) return fail("nesting too deep");
+    if (p_ >= end_) return fail("unexpected end of input");
+
+    switch (*p_) {
+      case 'n':
+        out.type_ = JsonValue::NUL;
+        return literal("null");
+      case 't':
+        out.type_ = JsonValue::BOOLEAN;
+        out.boolean_ = true;
+        return literal("true");
+      case 'f':
+        out.type_ = JsonValue::BOOLEAN;
+        out.boolean_ = false;
+        return literal("false");
+      case '"':
+        out.type_ = JsonValue::STRING;
+        return parseString(out.string_);
+      case '[':
+        return parseArray(out, depth);
+      case '{':
+        return parseObject(out, depth);
+      default:
+        return parseNumber(out);
+    }
+  }
+
+  bool parseNumber(JsonValue& out) {
+    const char* start = p_;
+    if (p_ < end_ && *p_ == '-') p_++;
+    if (p_ >= end_) return fail("invalid number");
+    if (*p_ == '0') {
+      p_++;
+    } else if (*p_ >= '1' && *p_ <= '9') {
+      while (p_ < end_ && *p_ >= '0' && *p_ <= '9') p_++;
+    } else {
+      return fail("invalid number");
+    }
+    if (p_ < end_ && *p_ == '.') {
+      p_++;
+      if (p_ >= end_ || *p_ < '0' || *p_ > '9') return fail("invalid fraction");
+      while (p_ < end_ && *p_ >= '0' && *p_ <= '9') p_++;
+    }
+    if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+      p_++;
+      if (p_ < end_ && (*p_ == '+' || *p_ == '-')) p_++;
+      if (p_ >= end_ || *p_ < '0' || *p_ > '9') return fail("invalid exponent");
+      while (p_ < end_ && *p_ >= '0' && *p_ <= '9') p_++;
+    }
+
+    std::string text(start, p_ - start);
+    out.type_ = JsonValue::NUMBER;
+    out.number_ = strtod(text.c_str(), nullptr);
+    return true;
+  }
+
+  static void appendUtf8(std::string& out, unsigned long cp) {
+    if (cp < 0x80) {
+      out += (char)cp;
+    } else if (cp < 0x800) {
+      out += (char)(0xC0 | (cp >> 6));
+      out += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+      out += (char)(0xE0 | (cp >> 12));
+      out += (char)(0x80 | ((cp >> 6) & 0x3F));
+      out += (char)(0x80 | (cp & 0x3F));
+    } else {
+      out += (char)(0xF0 | (cp >> 18));
+      out += (char)(0x80 | ((cp >> 12) & 0x3F));
+      out += (char)(0x80 | ((cp >> 6) & 0x3F));
+      out += (char)(0x80 | (cp & 0x3F));
+    }
+  }
+
+  bool parseHex4(unsigned long& value) {
+    if (end_ - p_ < 4) return fail("truncated escape");
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+      char c = *p_++;
+      value <<= 4;
+      if (c >= '0' && c <= '9') value |= c - '0';
+      else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+      else return fail("invalid escape");
+    }
+    return true;
+  }
+
+  bool parseString(std::string& out) {
+    p_++;
+    out.clear();
+    while (p_ < end_) {
+      unsigned char c = (unsigned char)*p_++;
+      if (c == '"') return true;
+      if (c < 0x20) return fail("control character in string");
+      if (c != '\\') {
+        out += (char)c;
+        continue;
+      }
+      if (p_ >= end_) break;
+      char e = *p_++;
+      switch (e) {
+        case '"': out += '"'; break;
+        case '\\': out += '\\'; break;
+        case '/': out += '/'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+          unsigned long cp;
+          if (!parseHex4(cp)) return false;
+          if (cp >= 0xD800 && cp <= 0xDBFF && end_ - p_ >= 6 && p_[0] == '\\' && p_[1] == 'u') {
+            p_ += 2;
+            unsigned long low;
+            if (!parseHex4(low)) return false;
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+              cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            } else {
+              appendUtf8(out, cp);
+              cp = low;
+            }
+          }
+          appendUtf8(out, cp);
+          break;
+        }
+        default:
+          return fail("invalid escape");
+      }
+    }
+    return fail("unterminated string");
+  }
+
+  bool parseArray(JsonValue& out, int depth) {
+    p_++;
+    out.type_ = JsonValue::ARRAY;
+    skipSpace();
+    if (p_ < end_ && *p_ == ']') {
+      p_++;
+      return true;
+    }
+    while (true) {
+      skipSpace();
+      out.array_.emplace_back();
+      if (!parseValue(out.array_.back(), depth + 1)) return false;
+      skipSpace();
+      if (p_ >= end_) return fail("unterminated array");
+      if (*p_ == ']') {
+        p_++;
+        return true;
+      }
+      if (*p_ != ',') return fail("expected ',' in array");
+      p_++;
+    }
+  }
+
+  bool parseObject(JsonValue& out, int depth) {
+    p_++;
+    out.type_ = JsonValue::OBJECT;
+    skipSpace();
+    if (p_ < end_ && *p_ == '}') {
+      p_++;
+      return true;
+    }
+    while (true) {
+      skipSpace();
+      if (p_ >= end_ || *p_ != '"') return fail("expected object key");
+      std::string key;
+      if (!parseString(key)) return false;
+      skipSpace();
+      if (p_ >= end_ || *p_ != ':') return fail("expected ':'");
+      p_++;
+      skipSpace();
+      // Later duplicates win, as with JSON.parse.
+      JsonValue value;
+      if (!parseValue(value, depth + 1)) return false;
+      out.object_[key] = std::move(value);
+      skipSpace();
+      if (p_ >= end_) return fail("unterminated object");
+      if (*p_ == '}') {
+        p_++;
+        return true;
+      }
+      if (*p_ != ',') return fail("expected ',' in object");
+      p_++;
+    }
+  }
+
+  const char* p_;
+  const char* end_;
+  std::string error_;
+};
+
+bool JsonValue::parse(const char* text, size_t length, JsonValue& out, std::string* error) {
+  JsonParser parser(text, length);
+  out = JsonValue();
+  bool ok = parser.parseDocument(out);
+  if (!ok && error) *error = parser.error();
+  return ok;
+}
+
+const JsonValue* JsonValue::get(const std::string& key) const {
+  if (type_ != OBJECT) return nullptr;
+  auto it = object_.find(key);
+  return it == object_.end() ? nullptr : &it->second;
+}
+
+bool JsonValue::truthy() const {
+  switch (type_) {
+    case NUL: return false;
+    case BOOLEAN: return boolean_;
+    case NUMBER: return number_ != 0 && !isnan(number_);
+    case STRING: return !string_.empty();
+    case ARRAY:
+    case OBJECT: return true;
+  }
+  return false;
+}
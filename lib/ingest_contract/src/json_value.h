@@ -0,0 +1,49 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Small strict JSON parser for host tools (RFC 8259: no trailing commas,
+// comments or NaN literals). Independent of the firmware's JsonWriter so it
+// can be used to check that writer's output.
+
+class JsonValue {
+ public:
+  enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+  JsonValue() : type_(NUL), boolean_(false), number_(0) {}
+
+  static bool parse(const char* text, size_t length, JsonValue& out, std::string* error = nullptr);
+
+  Type type() const { return type_; }
+  bool isNull() const { return type_ == NUL; }
+  bool isBool() const { return type_ == BOOLEAN; }
+  bool isNumber() const { return type_ == NUMBER; }
+  bool isString() const { return type_ == STRING; }
+  bool isArray() const { return type_ == ARRAY; }
+  bool isObject() const { return type_ == OBJECT; }
+
+  bool boolean() const { return boolean_; }
+  double number() const { return number_; }
+  const std::string& string() const { return string_; }
+  const std::vector<JsonValue>& array() const { return array_; }
+  const std::map<std::string, JsonValue>& object() const { return object_; }
+
+  // Member lookup; returns nullptr when this is not an object or the key is
+  // missing (JavaScript's `undefined`).
+  const JsonValue* get(const std::string& key) const;
+
+  // JavaScript truthiness, as used by Boolean(x) in the edge function.
+  bool truthy() const;
+
+ private:
+  friend class JsonParser;
+
+  Type type_;
+  bool boolean_;
+  double number_;
+  std::string string_;
+  std::vector<JsonValue> array_;
+  std::map<std::string, JsonValue> object_;
+};
@@ -0,0 +1,28 @@
+#include "alerts.h"
+
+void evaluateAlerts(SensorSample& sample, const AlertThresholds& thresholds) {
+  sample.zone1Alert = false;
+  sample.zone2Alert = false;
+  sample.highTempAlert = false;
+
+  float temperatureCZ1 = sample.temperatureCZ1;
+  float luxZ1 = sample.luxZ1;
+  float temperatureCZ2 = sample.temperatureCZ2;
+  float humidityZ2 = sample.humidityZ2;
+
+  bool z1_temp_alert = (temperatureCZ1 != TEMP_INVALID && temperatureCZ1 > thresholds.tempHigh);
+  bool z1_lux_alert = (luxZ1 != LUX_DARK && luxZ1 < thresholds.lightLow && luxZ1 != LUX_BRIGHT);
+  if (z1_temp_alert || z1_lux_alert) {
+    sample.zone1Alert = true;
+  }
+
+  bool z2_temp_alert = (temperatureCZ2 != DHT_NEVER_READ && temperatureCZ2 != DHT_READ_FAILED && temperatureCZ2 > thresholds.tempHigh);
+  bool z2_humidity_alert = (humidityZ2 != DHT_NEVER_READ && humidityZ2 != DHT_READ_FAILED && humidityZ2 > thresholds.humidityHigh);
+  if (z2_temp_alert || z2_humidity_alert) {
+    sample.zone2Alert = true;
+  }
+
+  if (z1_temp_alert || z2_temp_alert) {
+    sample.highTempAlert = true;
+  }
+}
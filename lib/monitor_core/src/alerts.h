@@ -0,0 +1,14 @@
+#pragma once
+
+#include "device_config.h"
+#include "sensor_sample.h"
+
+struct AlertThresholds {
+  float tempHigh = deviceConfig.tempHighC;
+  float lightLow = deviceConfig.lightLowLux;
+  float humidityHigh = deviceConfig.humidityHighPct;
+};
+
+// Sets zone1Alert, zone2Alert and highTempAlert from the sample's readings.
+// The thresholds default to deviceConfig; the replay tool overrides them.
+void evaluateAlerts(SensorSample& sample, const AlertThresholds& thresholds = AlertThresholds());
@@ -0,0 +1,299 @@
+#include "device_config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+#include "monitor_config.h"
+
+static const size_t HEADER_SIZE = offsetof(DeviceConfig, cycleIntervalMs);
+static const size_t CRC_START = offsetof(DeviceConfig, crc) + sizeof(uint32_t);
+
+#define FIELD(key, member, type, min, max, flags) \
+  {key, type, (uint16_t)offsetof(DeviceConfig, member), (uint16_t)sizeof(DeviceConfig::member), min, max, flags}
+
+const ConfigField CONFIG_FIELDS[] = {
+  FIELD("cycle_interval_ms", cycleIntervalMs, CONFIG_U32, 1000, 3600000, 0),
+  FIELD("buzzer_pulse_ms", buzzerPulseMs, CONFIG_U32, 0, 1000, 0),
+  FIELD("temp_high_c", tempHighC, CONFIG_FLOAT, -40, 125, 0),
+  FIELD("light_low_lux", lightLowLux, CONFIG_FLOAT, 0, 100000, 0),
+  FIELD("humidity_high_pct", humidityHighPct, CONFIG_FLOAT, 0, 100, 0),
+  FIELD("adc_max", adcMax, CONFIG_FLOAT, 1, 65535, 0),
+  FIELD("adc_ref_v", adcRefVoltage, CONFIG_FLOAT, 0.1f, 10, 0),
+  FIELD("ntc_beta", ntcBeta, CONFIG_FLOAT, 1, 100000, 0),
+  FIELD("ntc_series_ohm", ntcSeriesOhm, CONFIG_FLOAT, 1, 10000000, 0),
+  FIELD("ntc_nominal_ohm", ntcNominalOhm, CONFIG_FLOAT, 1, 10000000, 0),
+  FIELD("ntc_t0_k", ntcT0Kelvin, CONFIG_FLOAT, 1, 1000, 0),
+  FIELD("ldr_gamma", ldrGamma, CONFIG_FLOAT, 0.01f, 10, 0),
+  FIELD("ldr_rl10_kohm", ldrRl10KOhm, CONFIG_FLOAT, 0.001f, 100000, 0),
+  FIELD("ldr_series_ohm", ldrSeriesOhm, CONFIG_FLOAT, 1, 10000000, 0),
+  FIELD("pin_temp_z1", tempPinZ1, CONFIG_PIN, 0, 39, CONFIG_AT_BOOT | CONFIG_PIN_ADC1),
+  FIELD("pin_light_z1", lightPinZ1, CONFIG_PIN, 0, 39, CONFIG_AT_BOOT | CONFIG_PIN_ADC1),
+  FIELD("pin_dht_z2", dhtPinZ2, CONFIG_PIN, 0, 39, CONFIG_AT_BOOT | CONFIG_PIN_OUTPUT),
+  FIELD("pin_led_green", greenLedPin, CONFIG_PIN, 0, 39, CONFIG_AT_BOOT | CONFIG_PIN_OUTPUT),
+  FIELD("pin_led_yellow", yellowLedPin, CONFIG_PIN, 0, 39, CONFIG_AT_BOOT | CONFIG_PIN_OUTPUT),
+  FIELD("pin_led_red", redLedPin, CONFIG_PIN, 0, 39, CONFIG_AT_BOOT | CONFIG_PIN_OUTPUT),
+  FIELD("pin_buzzer", buzzerPin, CONFIG_PIN, 0, 39, CONFIG_AT_BOOT | CONFIG_PIN_OUTPUT),
+  FIELD("pin_fan", fanLedPin, CONFIG_PIN, 0, 39, CONFIG_AT_BOOT | CONFIG_PIN_OUTPUT),
+  FIELD("lcd1_addr", lcd1Address, CONFIG_U8, 0x08, 0x77, CONFIG_AT_BOOT | CONFIG_HEX),
+  FIELD("lcd2_addr", lcd2Address, CONFIG_U8, 0x08, 0x77, CONFIG_AT_BOOT | CONFIG_HEX),
+  FIELD("wifi_channel", wifiChannel, CONFIG_U8, 1, 13, CONFIG_AT_BOOT),
+  FIELD("wifi_ssid", wifiSsid, CONFIG_TEXT, 0, 0, CONFIG_AT_BOOT),
+  FIELD("wifi_password", wifiPassword, CONFIG_TEXT, 0, 0, CONFIG_AT_BOOT | CONFIG_SECRET),
+  FIELD("server_url", serverUrl, CONFIG_TEXT, 0, 0, CONFIG_AT_BOOT),
+};
+
+#undef FIELD
+
+const size_t CONFIG_FIELD_COUNT = sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]);
+
+static DeviceConfig defaultConfig() {
+  DeviceConfig config;
+  configDefaults(config);
+  return config;
+}
+
+DeviceConfig deviceConfig = defaultConfig();
+static DeviceConfig storedConfig = defaultConfig();
+
+static void copyText(char* out, size_t size, const char* text) {
+  strncpy(out, text, size - 1);
+  out[size - 1] = '\0';
+}
+
+void configDefaults(DeviceConfig& config) {
+  memset(&config, 0, sizeof(config));
+  config.cycleIntervalMs = CYCLE_INTERVAL_MS;
+  config.buzzerPulseMs = BUZZER_PULSE_MS;
+  config.tempHighC = TEMP_HIGH_THRESHOLD;
+  config.lightLowLux = LIGHT_LOW_THRESHOLD;
+  config.humidityHighPct = HUMIDITY_HIGH_THRESHOLD;
+  config.adcMax = ADC_MAX_VALUE;
+  config.adcRefVoltage = ADC_REF_VOLTAGE;
+  config.ntcBeta = BETA;
+  config.ntcSeriesOhm = R_KNOWN;
+  config.ntcNominalOhm = NTC_NOMINAL_OHM;
+  config.ntcT0Kelvin = T0_KELVIN;
+  config.ldrGamma = LDR_GAMMA;
+  config.ldrRl10KOhm = LDR_RL10;
+  config.ldrSeriesOhm = LDR_SERIES_RESISTOR;
+  config.tempPinZ1 = TEMP_PIN_Z1;
+  config.lightPinZ1 = LIGHT_PIN_Z1;
+  config.dhtPinZ2 = DHT_PIN_Z2;
+  config.greenLedPin = GREEN_LED_PIN;
+  config.yellowLedPin = YELLOW_LED_PIN;
+  config.redLedPin = RED_LED_PIN;
+  config.buzzerPin = BUZZER_PIN;
+  config.fanLedPin = FAN_LED_PIN;
+  config.lcd1Address = LCD1_I2C_ADDRESS;
+  config.lcd2Address = LCD2_I2C_ADDRESS;
+  config.wifiChannel = WIFI_CHANNEL;
+  copyText(config.wifiSsid, sizeof(config.wifiSsid), WIFI_SSID);
+  copyText(config.wifiPassword, sizeof(config.wifiPassword), WIFI_PASSWORD);
+  copyText(config.serverUrl, sizeof(config.serverUrl), SERVER_URL);
+  config.version = CONFIG_VERSION;
+  config.size = sizeof(DeviceConfig);
+  config.crc = configCrc(config);
+}
+
+// CRC-32 (IEEE 802.3, as zlib), bit by bit: it runs at boot and on updates only.
+static uint32_t crc32(const uint8_t* data, size_t length) {
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+  }
+  return ~crc;
+}
+
+uint32_t configCrc(const DeviceConfig& config) {
+  size_t end = config.size < sizeof(DeviceConfig) ? config.size : sizeof(DeviceConfig);
+  if (end < CRC_START) return 0;
+  return crc32((const uint8_t*)&config + CRC_START, end - CRC_START);
+}
+
+const ConfigField* configFindField(const char* key) {
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+    if (strcmp(CONFIG_FIELDS[i].key, key) == 0) return &CONFIG_FIELDS[i];
+  }
+  return nullptr;
+}
+
+static float numericValue(const DeviceConfig& config, const ConfigField& field) {
+  const uint8_t* p = (const uint8_t*)&config + field.offset;
+  switch (field.type) {
+    case CONFIG_U32: { uint32_t v; memcpy(&v, p, sizeof(v)); return (float)v; }
+    case CONFIG_U8: return (float)*p;
+    case CONFIG_PIN: return (float)(int8_t)*p;
+    case CONFIG_FLOAT: { float v; memcpy(&v, p, sizeof(v)); return v; }
+    case CONFIG_TEXT: break;
+  }
+  return 0;
+}
+
+// ESP32 GPIOs by what they can do. 6-11 drive the SPI flash, and 20, 24 and
+// 28-31 are not bonded out; 34-39 are inputs only.
+static const uint64_t GPIO_USABLE = 0xFF0EEFF03Full;
+static const uint64_t GPIO_OUTPUT = GPIO_USABLE & ~0xFC00000000ull;
+static const uint64_t GPIO_ADC1 = 0xFF00000000ull;
+
+static bool pinCapable(int pin, uint8_t flags) {
+  uint64_t capable = GPIO_USABLE;
+  if (flags & CONFIG_PIN_OUTPUT) capable &= GPIO_OUTPUT;
+  if (flags & CONFIG_PIN_ADC1) capable &= GPIO_ADC1;
+  return pin >= 0 && pin < 64 && (capable >> pin) & 1;
+}
+
+static bool fieldValid(const DeviceConfig& config, const ConfigField& field) {
+  if (field.type == CONFIG_TEXT) {
+    return memchr((const uint8_t*)&config + field.offset, '\0', field.size) != nullptr;
+  }
+  float value = numericValue(config, field);
+  if (!isfinite(value) || value < field.min || value > field.max) return false;
+  return field.type != CONFIG_PIN || pinCapable((int)value, field.flags);
+}
+
+// https://<host>[/<path>]. The uplink connects with TLS to port 443 and
+// keeps the host in a CONFIG_HOST_SIZE buffer, so a port or user info in the
+// authority, or a longer host, is refused rather than misread.
+static bool serverUrlValid(const char* url) {
+  static const char SCHEME[] = "https://";
+  if (strncmp(url, SCHEME, sizeof(SCHEME) - 1) != 0) return false;
+  const char* host = url + sizeof(SCHEME) - 1;
+  size_t length = strcspn(host, "/?#");
+  if (length == 0 || length >= CONFIG_HOST_SIZE) return false;
+  for (size_t i = 0; i < length; i++) {
+    char c = host[i];
+    if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const char* configValidate(const DeviceConfig& config) {
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+    if (!fieldValid(config, CONFIG_FIELDS[i])) return CONFIG_FIELDS[i].key;
+  }
+  if (config.buzzerPulseMs >= config.cycleIntervalMs) return "buzzer_pulse_ms";
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+    if (CONFIG_FIELDS[i].type != CONFIG_PIN) continue;
+    int8_t pin = *((const int8_t*)&config + CONFIG_FIELDS[i].offset);
+    for (size_t j = 0; j < i; j++) {
+      if (CONFIG_FIELDS[j].type == CONFIG_PIN && *((const int8_t*)&config + CONFIG_FIELDS[j].offset) == pin) {
+        return CONFIG_FIELDS[i].key;
+      }
+    }
+  }
+  if (!serverUrlValid(config.serverUrl)) return "server_url";
+  return nullptr;
+}
+
+ConfigSource configLoad() {
+  DeviceConfig loaded;
+  configDefaults(loaded);
+  size_t length = halLoadConfig(&loaded, sizeof(loaded));
+  ConfigSource source = CONFIG_FROM_STORE;
+  if (length == 0) {
+    source = CONFIG_FROM_DEFAULTS;
+  } else if (length < HEADER_SIZE || length > sizeof(DeviceConfig) || loaded.size != length || loaded.version == 0 ||
+             loaded.version > CONFIG_VERSION ||
+             (loaded.version == CONFIG_VERSION && length != sizeof(DeviceConfig)) ||
+             loaded.crc != configCrc(loaded)) {
+    source = CONFIG_REJECTED;
+  } else if (loaded.version < CONFIG_VERSION) {
+    // Fields past the old size still hold their defaults.
+    source = CONFIG_MIGRATED;
+    loaded.version = CONFIG_VERSION;
+    loaded.size = sizeof(DeviceConfig);
+    loaded.crc = configCrc(loaded);
+  }
+  if (source == CONFIG_REJECTED || configValidate(loaded)) {
+    source = CONFIG_REJECTED;
+    configDefaults(loaded);
+  }
+  if (source == CONFIG_MIGRATED) halStoreConfig(&loaded, sizeof(loaded));
+
+  deviceConfig = loaded;
+  storedConfig = loaded;
+  return source;
+}
+
+const DeviceConfig& configStored() {
+  return storedConfig;
+}
+
+static bool bootFieldsMatch(const DeviceConfig& a, const DeviceConfig& b) {
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+    const ConfigField& field = CONFIG_FIELDS[i];
+    if (!(field.flags & CONFIG_AT_BOOT)) continue;
+    if (memcmp((const uint8_t*)&a + field.offset, (const uint8_t*)&b + field.offset, field.size) != 0) return false;
+  }
+  return true;
+}
+
+ConfigUpdate configUpdate(const DeviceConfig& next) {
+  DeviceConfig stamped = next;
+  stamped.version = CONFIG_VERSION;
+  stamped.size = sizeof(DeviceConfig);
+  stamped.reserved0 = 0;
+  memset(stamped.reserved1, 0, sizeof(stamped.reserved1));
+  stamped.crc = configCrc(stamped);
+  if (configValidate(stamped)) return CONFIG_INVALID;
+  if (!halStoreConfig(&stamped, sizeof(stamped))) return CONFIG_STORE_FAILED;
+
+  storedConfig = stamped;
+  if (!bootFieldsMatch(stamped, deviceConfig)) return CONFIG_PENDING_RESTART;
+  deviceConfig = stamped;
+  return CONFIG_APPLIED;
+}
+
+bool configParseField(DeviceConfig& config, const ConfigField& field, const char* value) {
+  uint8_t* p = (uint8_t*)&config + field.offset;
+  if (field.type == CONFIG_TEXT) {
+    size_t length = strlen(value);
+    if (length >= field.size) return false;
+    memset(p, 0, field.size);
+    memcpy(p, value, length);
+    return true;
+  }
+
+  char* end;
+  if (field.type == CONFIG_FLOAT) {
+    float number = strtof(value, &end);
+    if (end == value || *end != '\0' || !isfinite(number) || number < field.min || number > field.max) return false;
+    memcpy(p, &number, sizeof(number));
+    return true;
+  }
+
+  long number = strtol(value, &end, 0);
+  if (end == value || *end != '\0' || number < (long)field.min || number > (long)field.max) return false;
+  if (field.type == CONFIG_U32) {
+    uint32_t v = (uint32_t)number;
+    memcpy(p, &v, sizeof(v));
+  } else {
+    *p = (uint8_t)number;
+  }
+  return true;
+}
+
+void configFormatField(const DeviceConfig& config, const ConfigField& field, char* out, size_t size) {
+  const uint8_t* p = (const uint8_t*)&config + field.offset;
+  if (field.flags & CONFIG_SECRET) {
+    snprintf(out, size, "%s", p[0] ? "(set)" : "(empty)");
+  } else if (field.type == CONFIG_TEXT) {
+    snprintf(out, size, "%.*s", (int)field.size, (const char*)p);
+  } else if (field.type == CONFIG_FLOAT) {
+    snprintf(out, size, "%g", numericValue(config, field));
+  } else if (field.flags & CONFIG_HEX) {
+    snprintf(out, size, "0x%02lx", (unsigned long)numericValue(config, field));
+  } else if (field.type == CONFIG_U32) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    snprintf(out, size, "%lu", (unsigned long)v);
+  } else {
+    snprintf(out, size, "%ld", (long)numericValue(config, field));
+  }
+}
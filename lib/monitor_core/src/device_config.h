@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-device configuration: pins, I2C addresses, thresholds, conversion
+// constants, Wi-Fi and the ingest URL, so one build serves a whole fleet.
+// The defaults are the constants in monitor_config.h.
+//
+// The schema is the struct itself, stored as one NVS blob behind a header
+// of version, size and CRC-32. It is loaded once at boot into deviceConfig,
+// which the rest of the firmware reads directly: every read is a plain load
+// of a naturally aligned field. The struct has no padding (see the
+// static_assert), so the blob is byte for byte what is in RAM; it is not
+// __attribute__((packed)), which would turn float reads into byte loads.
+//
+// New fields are only ever appended, with CONFIG_VERSION bumped: an older
+// blob then loads over the defaults and keeps the new fields at theirs.
+
+const uint16_t CONFIG_VERSION = 1;
+
+struct DeviceConfig {
+  uint16_t version;
+  uint16_t size;
+  uint32_t crc;  // CRC-32 of the bytes after this field, up to size
+
+  uint32_t cycleIntervalMs;
+  uint32_t buzzerPulseMs;
+
+  float tempHighC;
+  float lightLowLux;
+  float humidityHighPct;
+
+  float adcMax;
+  float adcRefVoltage;
+  float ntcBeta;
+  float ntcSeriesOhm;
+  float ntcNominalOhm;
+  float ntcT0Kelvin;
+  float ldrGamma;
+  float ldrRl10KOhm;
+  float ldrSeriesOhm;
+
+  int8_t tempPinZ1;
+  int8_t lightPinZ1;
+  int8_t dhtPinZ2;
+  int8_t greenLedPin;
+  int8_t yellowLedPin;
+  int8_t redLedPin;
+  int8_t buzzerPin;
+  int8_t fanLedPin;
+
+  uint8_t lcd1Address;
+  uint8_t lcd2Address;
+  uint8_t wifiChannel;
+  uint8_t reserved0;
+
+  char wifiSsid[33];
+  char wifiPassword[64];
+  char serverUrl[128];
+  uint8_t reserved1[3];
+};
+
+static_assert(sizeof(DeviceConfig) == 304, "DeviceConfig must stay free of padding");
+
+// Read freely; change only through configUpdate().
+extern DeviceConfig deviceConfig;
+
+enum ConfigFieldType {
+  CONFIG_U32,
+  CONFIG_U8,
+  CONFIG_PIN,
+  CONFIG_FLOAT,
+  CONFIG_TEXT
+};
+
+// Field flags: applied at boot only (a change waits for a restart), shown as
+// hex, never printed back.
+const uint8_t CONFIG_AT_BOOT = 1;
+const uint8_t CONFIG_HEX = 2;
+const uint8_t CONFIG_SECRET = 4;
+// Pin fields: driven as an output (the DHT22 data line too), or read by the
+// ADC. Only ADC1 can be read while Wi-Fi is up.
+const uint8_t CONFIG_PIN_OUTPUT = 8;
+const uint8_t CONFIG_PIN_ADC1 = 16;
+
+// server_url is https://<host>[/<path>], on port 443; the host must fit in
+// CONFIG_HOST_SIZE with its terminator.
+const size_t CONFIG_HOST_SIZE = 64;
+
+struct ConfigField {
+  const char* key;
+  ConfigFieldType type;
+  uint16_t offset;
+  uint16_t size;
+  float min;  // inclusive range for numbers, ignored for text
+  float max;
+  uint8_t flags;
+};
+
+extern const ConfigField CONFIG_FIELDS[];
+extern const size_t CONFIG_FIELD_COUNT;
+
+const ConfigField* configFindField(const char* key);
+
+enum ConfigSource {
+  CONFIG_FROM_DEFAULTS,  // nothing stored
+  CONFIG_FROM_STORE,
+  CONFIG_MIGRATED,       // an older version, loaded over the defaults and stored again
+  CONFIG_REJECTED        // bad CRC, size, version or values; defaults used
+};
+
+void configDefaults(DeviceConfig& config);
+// Null when every field is in range, every pin is an ESP32 GPIO that can do
+// what its field needs and no two pin fields share one, and server_url
+// parses; otherwise the first offending key.
+const char* configValidate(const DeviceConfig& config);
+uint32_t configCrc(const DeviceConfig& config);
+
+// Reads the stored blob through halLoadConfig() into deviceConfig. Called
+// once, before anything reads the configuration.
+ConfigSource configLoad();
+
+// What is stored: deviceConfig plus any changes waiting for a restart.
+const DeviceConfig& configStored();
+
+enum ConfigUpdate {
+  CONFIG_APPLIED,
+  CONFIG_PENDING_RESTART,  // stored; a boot-only field changed
+  CONFIG_INVALID,
+  CONFIG_STORE_FAILED
+};
+
+// Validates next, stamps its header and stores it in one halStoreConfig()
+// write. deviceConfig is replaced as a whole, and only once the store
+// succeeded and no boot-only field differs; otherwise it is left untouched.
+ConfigUpdate configUpdate(const DeviceConfig& next);
+
+// Text form of one field, for the serial console. configParseField()
+// leaves config unchanged and returns false when value does not parse or is
+// out of range.
+bool configParseField(DeviceConfig& config, const ConfigField& field, const char* value);
+void configFormatField(const DeviceConfig& config, const ConfigField& field, char* out, size_t size);
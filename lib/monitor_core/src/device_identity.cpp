@@ -0,0 +1,28 @@
+#include "device_identity.h"
+
+#include "hal.h"
+
+void formatDeviceId(const uint8_t mac[6], char* out) {
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+  const char prefix[] = "esp32-";
+  size_t length = sizeof(prefix) - 1;
+  for (size_t i = 0; i < length; i++) out[i] = prefix[i];
+  for (int i = 0; i < 6; i++) {
+    out[length++] = HEX_DIGITS[mac[i] >> 4];
+    out[length++] = HEX_DIGITS[mac[i] & 0x0F];
+  }
+  out[length] = '\0';
+}
+
+void sequenceBegin(SequenceCounter& counter) {
+  counter.next = halLoadSequence();
+  counter.reservedEnd = counter.next;
+}
+
+uint32_t sequenceNext(SequenceCounter& counter) {
+  if (counter.next >= counter.reservedEnd) {
+    counter.reservedEnd = counter.next + SEQUENCE_BLOCK;
+    halStoreSequence(counter.reservedEnd);
+  }
+  return counter.next++;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Who sent a reading and which one it was. Every uplink payload carries
+// "device" and "seq"; the backend drops a (device, seq) pair it has already
+// stored, so a retried POST is never logged twice.
+
+// "esp32-" plus the station MAC as 12 lower-case hex digits.
+const size_t DEVICE_ID_SIZE = 19;
+
+void formatDeviceId(const uint8_t mac[6], char* out);
+
+// Sequence numbers keep increasing across reboots. The counter reserves
+// SEQUENCE_BLOCK numbers at a time through halStoreSequence(), so flash is
+// written once per boot and once per block (about 8.5 hours at the 30 s
+// cycle); whatever is left of a block at a reset is skipped.
+const uint32_t SEQUENCE_BLOCK = 1024;
+
+struct SequenceCounter {
+  uint32_t next = 0;
+  uint32_t reservedEnd = 0;
+};
+
+void sequenceBegin(SequenceCounter& counter);
+uint32_t sequenceNext(SequenceCounter& counter);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Thin hardware abstraction used by monitor_core. The firmware implements it
+// on top of Arduino/ESP32 APIs (src/hal_arduino.cpp); the native build links
+// lib/hal_sim instead, which simulates the ADC, GPIO, clock, DHT22 and an
+// HTTP sink so the same conversion, alert and encoding code runs on Linux.
+
+void halPinModeOutput(int pin);
+void halDigitalWrite(int pin, bool high);
+int halAnalogRead(int pin);
+
+uint32_t halMillis();
+uint32_t halMicros();
+void halDelay(uint32_t ms);
+
+// Returns false when the sensor did not produce a reading; status is the
+// driver's error code either way.
+bool halReadClimate(float& temperatureC, float& humidity, int& status);
+
+// POSTs a JSON body to the ingest endpoint with Prefer: return=minimal.
+// Returns the HTTP status code (204 once the reading is stored), or a
+// negative transport error.
+int halHttpPost(const char* body, size_t length);
+
+// The first reading sequence number not yet handed out, kept in
+// non-volatile storage (0 when nothing was stored). See device_identity.h.
+uint32_t halLoadSequence();
+void halStoreSequence(uint32_t next);
+
+// The configuration blob (see device_config.h), kept in non-volatile
+// storage and replaced in a single write. halLoadConfig() copies at most
+// capacity bytes and returns the stored length, 0 when nothing is stored.
+size_t halLoadConfig(void* data, size_t capacity);
+bool halStoreConfig(const void* data, size_t length);
@@ -0,0 +1,85 @@
+#include "json_writer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+JsonWriter::JsonWriter(char* buffer, size_t capacity)
+    : buffer_(buffer), capacity_(capacity), length_(0), overflow_(capacity == 0) {
+  if (capacity_ > 0) buffer_[0] = '\0';
+}
+
+void JsonWriter::append(const char* text, size_t len) {
+  if (overflow_) return;
+  if (length_ + len >= capacity_) {
+    overflow_ = true;
+    return;
+  }
+  memcpy(buffer_ + length_, text, len);
+  length_ += len;
+  buffer_[length_] = '\0';
+}
+
+void JsonWriter::raw(const char* text) {
+  append(text, strlen(text));
+}
+
+void JsonWriter::raw(char c) {
+  append(&c, 1);
+}
+
+void JsonWriter::quoted(const char* text) {
+  raw('"');
+  for (const char* p = text; *p; p++) {
+    if ((unsigned char)*p < 0x20) {
+      char escape[8];
+      snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)*p);
+      raw(escape);
+      continue;
+    }
+    if (*p == '"' || *p == '\\') raw('\\');
+    raw(*p);
+  }
+  raw('"');
+}
+
+void JsonWriter::fixed(float value, int decimals) {
+  if (!isfinite(value)) {
+    null();
+    return;
+  }
+  // FLT_MAX prints as 39 digits before the decimals.
+  char tmp[64];
+  int len = snprintf(tmp, sizeof(tmp), "%.*f", decimals, value);
+  if (len < 0 || len >= (int)sizeof(tmp)) {
+    overflow_ = true;
+    return;
+  }
+  append(tmp, len);
+}
+
+void JsonWriter::integer(long value) {
+  char tmp[24];
+  int len = snprintf(tmp, sizeof(tmp), "%ld", value);
+  append(tmp, len);
+}
+
+void JsonWriter::unsignedInteger(unsigned long value) {
+  char tmp[24];
+  int len = snprintf(tmp, sizeof(tmp), "%lu", value);
+  append(tmp, len);
+}
+
+void JsonWriter::boolean(bool value) {
+  raw(value ? "true" : "false");
+}
+
+void JsonWriter::null() {
+  raw("null");
+}
+
+void JsonWriter::truncate(size_t length) {
+  if (length > length_) return;
+  length_ = length;
+  if (capacity_ > 0) buffer_[length_] = '\0';
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Appends JSON fragments into a caller-owned buffer. Nothing allocates; once
+// the buffer is full further writes are dropped and ok() turns false, so a
+// truncated document is never mistaken for a complete one.
+
+class JsonWriter {
+ public:
+  JsonWriter(char* buffer, size_t capacity);
+
+  void raw(const char* text);
+  void raw(char c);
+  void quoted(const char* text);
+  // NaN and infinities have no JSON spelling and are written as null.
+  void fixed(float value, int decimals);
+  void integer(long value);
+  void unsignedInteger(unsigned long value);
+  void boolean(bool value);
+  void null();
+
+  void truncate(size_t length);
+
+  const char* c_str() const { return buffer_; }
+  size_t length() const { return length_; }
+  bool ok() const { return !overflow_; }
+
+ private:
+  void append(const char* text, size_t len);
+
+  char* buffer_;
+  size_t capacity_;
+  size_t length_;
+  bool overflow_;
+};
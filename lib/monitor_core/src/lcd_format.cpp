@@ -0,0 +1,110 @@
+#include "lcd_format.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Small cursor over a line buffer so each field reads like the lcd.print()
+// sequence it replaces.
+struct LineWriter {
+  char* out;
+  size_t len;
+
+  void print(const char* text) {
+    int n = snprintf(out + len, LCD_LINE_BUFFER - len, "%s", text);
+    advance(n);
+  }
+  void print(float value, int decimals) {
+    int n = snprintf(out + len, LCD_LINE_BUFFER - len, "%.*f", decimals, value);
+    advance(n);
+  }
+  void print(int value) {
+    int n = snprintf(out + len, LCD_LINE_BUFFER - len, "%d", value);
+    advance(n);
+  }
+  void advance(int n) {
+    if (n < 0) return;
+    len += (size_t)n;
+    if (len > LCD_LINE_BUFFER - 1) len = LCD_LINE_BUFFER - 1;
+  }
+};
+
+static LineWriter lineWriter(char* line) {
+  line[0] = '\0';
+  LineWriter w = {line, 0};
+  return w;
+}
+
+void formatAnalogZoneLine(const SensorSample& sample, int zoneNumber, char line[LCD_LINE_BUFFER]) {
+  LineWriter w = lineWriter(line);
+  w.print("Z");
+  w.print(zoneNumber);
+  w.print(":");
+  if (sample.temperatureCZ1 == TEMP_INVALID) w.print("ERR"); else w.print(sample.temperatureCZ1, 1);
+  w.print("C ");
+  if (sample.luxZ1 == LUX_DARK) w.print("DARK"); else if (sample.luxZ1 == LUX_BRIGHT) w.print(">BRT"); else w.print((int)sample.luxZ1);
+  w.print("lx");
+  if (sample.zone1Alert) w.print("!");
+}
+
+void formatClimateZoneLine(const SensorSample& sample, int zoneNumber, char line[LCD_LINE_BUFFER]) {
+  LineWriter w = lineWriter(line);
+  w.print("Z");
+  w.print(zoneNumber);
+  w.print(":");
+  if (sample.temperatureCZ2 <= DHT_READ_FAILED) w.print("ERR"); else w.print(sample.temperatureCZ2, 1);
+  w.print("C ");
+  if (sample.humidityZ2 <= DHT_READ_FAILED) w.print("H:ERR"); else { w.print("H:"); w.print((int)sample.humidityZ2); w.print("%"); }
+  if (sample.zone2Alert) w.print("!");
+}
+
+void formatHighLowLine(const HistoryStats& temperature, int zoneNumber, const char* window,
+                       char line[LCD_LINE_BUFFER]) {
+  LineWriter w = lineWriter(line);
+  w.print("Z");
+  w.print(zoneNumber);
+  w.print(" ");
+  w.print(window);
+  if (temperature.count == 0) {
+    w.print(" L:-- H:--");
+    return;
+  }
+  w.print(" L:");
+  w.print(temperature.min, 1);
+  w.print(" H:");
+  w.print(temperature.max, 1);
+}
+
+void formatLcd1(const SensorSample& sample, char lines[LCD1_ROWS][LCD_LINE_BUFFER]) {
+  formatAnalogZoneLine(sample, 1, lines[0]);
+  formatClimateZoneLine(sample, 2, lines[1]);
+}
+
+void formatLcd2(const SensorSample& sample, bool wifiConnected, char lines[LCD2_ROWS][LCD_LINE_BUFFER]) {
+  LineWriter w = lineWriter(lines[0]);
+  if (sample.zone1Alert || sample.zone2Alert) {
+      w.print("SYSTEM ALERT ACTIVE!");
+  } else {
+      w.print("System Status: OK");
+  }
+
+  w = lineWriter(lines[1]);
+  w.print("Z1: ");
+  if (sample.temperatureCZ1 == TEMP_INVALID) w.print("T:ERR "); else { w.print("T:"); w.print(sample.temperatureCZ1, 1); w.print("C "); }
+  if (sample.luxZ1 == LUX_DARK) w.print("L:DARK"); else if (sample.luxZ1 == LUX_BRIGHT) w.print("L:>BRT"); else { w.print("L:"); w.print((int)sample.luxZ1); w.print("lx"); }
+  if (sample.zone1Alert) w.print(" !");
+
+  w = lineWriter(lines[2]);
+  w.print("Z2: ");
+  if (sample.temperatureCZ2 <= DHT_READ_FAILED) w.print("T:ERR "); else { w.print("T:"); w.print(sample.temperatureCZ2, 1); w.print("C "); }
+  if (sample.humidityZ2 <= DHT_READ_FAILED) w.print("H:ERR"); else { w.print("H:"); w.print((int)sample.humidityZ2); w.print("%"); }
+  if (sample.zone2Alert) w.print(" !");
+
+  // The "WF!" marker sits at column 18, past the fan status text.
+  w = lineWriter(lines[3]);
+  w.print("Fan Status: ");
+  w.print(sample.highTempAlert ? "ON" : "OFF");
+  if (!wifiConnected) {
+      while (w.len < 18) w.print(" ");
+      w.print("WF!");
+  }
+}
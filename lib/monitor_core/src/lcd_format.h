@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "sample_history.h"
+#include "sensor_sample.h"
+
+// Text for the two status displays. Lines are formatted into caller buffers
+// and may run past the panel width, exactly as the direct lcd.print() calls
+// did; the controller simply doesn't show the overflow.
+
+const size_t LCD_LINE_BUFFER = 41;
+const int LCD1_ROWS = 2;
+const int LCD2_ROWS = 4;
+
+// The two LCD 1 rows for any zone number ("Z1:..." / "Z2:..."), so a paged
+// display of more zones renders each one the same way.
+void formatAnalogZoneLine(const SensorSample& sample, int zoneNumber, char line[LCD_LINE_BUFFER]);
+void formatClimateZoneLine(const SensorSample& sample, int zoneNumber, char line[LCD_LINE_BUFFER]);
+
+// "Z1 24h L:18.2 H:31.4": a zone's temperature range over a window, from
+// historyWindowStats(); "--" for both when the window holds no readings.
+void formatHighLowLine(const HistoryStats& temperature, int zoneNumber, const char* window,
+                       char line[LCD_LINE_BUFFER]);
+
+void formatLcd1(const SensorSample& sample, char lines[LCD1_ROWS][LCD_LINE_BUFFER]);
+void formatLcd2(const SensorSample& sample, bool wifiConnected, char lines[LCD2_ROWS][LCD_LINE_BUFFER]);
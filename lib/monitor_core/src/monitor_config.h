@@ -0,0 +1,45 @@
+#pragma once
+
+// Pins, conversion constants and alert thresholds for the two-zone monitor.
+// Apart from FIRMWARE_VERSION these are the defaults of the per-device
+// configuration (device_config.h); the firmware reads deviceConfig, the
+// host tools simulate this default hardware.
+
+const char* const FIRMWARE_VERSION = "1.1.0";
+
+const char* const SERVER_URL = "https://elxrhewruujmwthlhhni.supabase.co/functions/v1/log-sensor-data";
+
+const char* const WIFI_SSID = "Wokwi-GUEST";
+const char* const WIFI_PASSWORD = "";
+const int WIFI_CHANNEL = 6;
+
+const int LCD1_I2C_ADDRESS = 0x27;
+const int LCD2_I2C_ADDRESS = 0x3F;
+
+const int TEMP_PIN_Z1 = 34;
+const int LIGHT_PIN_Z1 = 35;
+const int DHT_PIN_Z2 = 25;
+const int GREEN_LED_PIN = 19;
+const int YELLOW_LED_PIN = 18;
+const int RED_LED_PIN = 5;
+const int BUZZER_PIN = 17;
+const int FAN_LED_PIN = 16;
+
+const float ADC_MAX_VALUE = 4095.0;
+const float ADC_REF_VOLTAGE = 3.3;
+
+const float BETA = 3950;
+const float R_KNOWN = 10000;          // series resistor of the NTC divider
+const float NTC_NOMINAL_OHM = 10000;  // NTC resistance at T0_KELVIN
+const float T0_KELVIN = 298.15;
+
+const float LDR_GAMMA = 0.7;
+const float LDR_RL10 = 50;
+const float LDR_SERIES_RESISTOR = 10000;
+
+const float TEMP_HIGH_THRESHOLD = 30.0;
+const float LIGHT_LOW_THRESHOLD = 100;
+const float HUMIDITY_HIGH_THRESHOLD = 70.0;
+
+const unsigned long CYCLE_INTERVAL_MS = 30000;
+const unsigned long BUZZER_PULSE_MS = 100;
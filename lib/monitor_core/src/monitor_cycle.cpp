@@ -0,0 +1,89 @@
+#include "monitor_cycle.h"
+
+#include "hal.h"
+#include "device_config.h"
+#include "sensor_convert.h"
+
+void setupIndicators() {
+  halPinModeOutput(deviceConfig.greenLedPin);
+  halPinModeOutput(deviceConfig.yellowLedPin);
+  halPinModeOutput(deviceConfig.redLedPin);
+  halPinModeOutput(deviceConfig.buzzerPin);
+  halPinModeOutput(deviceConfig.fanLedPin);
+
+  halDigitalWrite(deviceConfig.greenLedPin, true);
+  halDigitalWrite(deviceConfig.yellowLedPin, false);
+  halDigitalWrite(deviceConfig.redLedPin, false);
+  halDigitalWrite(deviceConfig.buzzerPin, false);
+  halDigitalWrite(deviceConfig.fanLedPin, false);
+}
+
+void sampleAnalogZone(SensorSample& sample) {
+  int ntcRaw = halAnalogRead(deviceConfig.tempPinZ1);
+  int ldrRaw = halAnalogRead(deviceConfig.lightPinZ1);
+  convertAnalogZone(sample, ntcRaw, ldrRaw);
+}
+
+void convertAnalogZone(SensorSample& sample, int ntcRaw, int ldrRaw) {
+  sample.ntcRaw = ntcRaw;
+  NtcReading ntc = ntcCelsiusFromAdc(ntcRaw);
+  sample.temperatureCZ1 = ntc.celsius;
+  sample.ntcStatus = ntc.status;
+  sample.ntcDetail = ntc.detail;
+
+  sample.luxZ1 = ldrLuxFromAdc(ldrRaw);
+}
+
+void sampleClimateZone(SensorSample& sample) {
+  float temperature = 0;
+  float humidity = 0;
+  int status = 0;
+  bool ok = halReadClimate(temperature, humidity, status);
+  storeClimateReading(sample, ok, temperature, humidity, status);
+}
+
+void storeClimateReading(SensorSample& sample, bool ok, float temperature, float humidity, int status) {
+  sample.climateOk = ok;
+  sample.climateStatus = status;
+  if (ok) {
+    sample.temperatureCZ2 = temperature;
+    sample.humidityZ2 = humidity;
+  } else {
+    if (sample.temperatureCZ2 == DHT_NEVER_READ) sample.temperatureCZ2 = DHT_READ_FAILED;
+    if (sample.humidityZ2 == DHT_NEVER_READ) sample.humidityZ2 = DHT_READ_FAILED;
+  }
+}
+
+uint32_t driveIndicators(const SensorSample& sample) {
+  bool anyAlert = sample.zone1Alert || sample.zone2Alert;
+
+  halDigitalWrite(deviceConfig.yellowLedPin, sample.zone1Alert);
+  halDigitalWrite(deviceConfig.redLedPin, sample.zone2Alert);
+  halDigitalWrite(deviceConfig.greenLedPin, !anyAlert);
+
+  uint32_t blockedMs = 0;
+  if (anyAlert) {
+    halDigitalWrite(deviceConfig.buzzerPin, true);
+    halDelay(deviceConfig.buzzerPulseMs);
+    halDigitalWrite(deviceConfig.buzzerPin, false);
+    blockedMs = deviceConfig.buzzerPulseMs;
+  } else {
+    halDigitalWrite(deviceConfig.buzzerPin, false);
+  }
+
+  halDigitalWrite(deviceConfig.fanLedPin, sample.highTempAlert);
+  return blockedMs;
+}
+
+// The buzzer pulse is counted twice, as it always was: once inside the
+// elapsed time and once as blockedMs.
+CycleDelay cycleDelay(uint32_t cycleStartMs, uint32_t nowMs, uint32_t blockedMs,
+                      uint32_t intervalMs, uint32_t minDelayMs) {
+  long elapsed = (long)(nowMs - cycleStartMs);
+  long remaining = (long)intervalMs - elapsed - (long)blockedMs;
+
+  CycleDelay result;
+  result.overrun = remaining < 0;
+  result.delayMs = result.overrun ? minDelayMs : (uint32_t)remaining;
+  return result;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "sensor_sample.h"
+
+// The hardware-facing steps of one monitoring cycle, written against hal.h.
+
+void setupIndicators();
+
+// Reads the NTC and LDR and converts them; NTC faults are left in
+// sample.ntcStatus / ntcDetail for the caller to log.
+void sampleAnalogZone(SensorSample& sample);
+
+// The conversion half of sampleAnalogZone(), for callers that already hold
+// the ADC codes (benchmarks, traces).
+void convertAnalogZone(SensorSample& sample, int ntcRaw, int ldrRaw);
+
+// Reads the DHT22. On failure the previous values are kept, and a zone that
+// has never been read is marked DHT_READ_FAILED.
+void sampleClimateZone(SensorSample& sample);
+
+// The bookkeeping half of sampleClimateZone() for a reading taken elsewhere.
+void storeClimateReading(SensorSample& sample, bool ok, float temperature, float humidity, int status);
+
+// Drives the status LEDs, fan output and buzzer from the alert flags.
+// Returns how long the buzzer pulse blocked, in ms.
+uint32_t driveIndicators(const SensorSample& sample);
+
+// Time left until the next cycle should start. A cycle that ran over its
+// interval still waits minDelayMs and reports the overrun.
+struct CycleDelay {
+  uint32_t delayMs;
+  bool overrun;
+};
+
+CycleDelay cycleDelay(uint32_t cycleStartMs, uint32_t nowMs, uint32_t blockedMs,
+                      uint32_t intervalMs, uint32_t minDelayMs = 100);
@@ -0,0 +1,81 @@
+#include "payload.h"
+
+#include <math.h>
+
+static void zoneKey(JsonWriter& json, int zoneNumber) {
+  json.raw("\"zone");
+  json.integer(zoneNumber);
+  json.raw("\":{");
+}
+
+// Whole lux, truncated like the (int) cast it has always been; values an int
+// can't hold keep their magnitude rather than hitting an undefined cast.
+static void appendLux(JsonWriter& json, float lux) {
+  if (lux > -2147483648.0f && lux < 2147483648.0f) {
+    json.integer((int)lux);
+  } else {
+    json.fixed(truncf(lux), 0);
+  }
+}
+
+// "dark" or "bright" when the LDR is past either end of its range, where
+// lux itself is null; "ok" alongside a number.
+static void appendLuxState(JsonWriter& json, float lux) {
+  if (lux == LUX_DARK) json.quoted("dark");
+  else if (lux == LUX_BRIGHT) json.quoted("bright");
+  else if (isfinite(lux)) json.quoted("ok");
+  else json.null();
+}
+
+void appendAnalogZone(JsonWriter& json, const SensorSample& sample, int zoneNumber) {
+  zoneKey(json, zoneNumber);
+  json.raw("\"tempC\":");
+  if (sample.temperatureCZ1 == TEMP_INVALID) json.null(); else json.fixed(sample.temperatureCZ1, 1);
+  json.raw(",\"lux\":");
+  if (sample.luxZ1 == LUX_DARK || sample.luxZ1 == LUX_BRIGHT) json.null(); else appendLux(json, sample.luxZ1);
+  json.raw(",\"luxState\":");
+  appendLuxState(json, sample.luxZ1);
+  json.raw(",\"alert\":");
+  json.boolean(sample.zone1Alert);
+  json.raw('}');
+}
+
+void appendClimateZone(JsonWriter& json, const SensorSample& sample, int zoneNumber) {
+  zoneKey(json, zoneNumber);
+  json.raw("\"dhtTempC\":");
+  if (sample.temperatureCZ2 <= DHT_READ_FAILED) json.null(); else json.fixed(sample.temperatureCZ2, 1);
+  json.raw(",\"humidity\":");
+  if (sample.humidityZ2 <= DHT_READ_FAILED) json.null(); else json.fixed(sample.humidityZ2, 1);
+  json.raw(",\"alert\":");
+  json.boolean(sample.zone2Alert);
+  json.raw('}');
+}
+
+void beginPayload(JsonWriter& json, const SensorSample& sample) {
+  json.raw('{');
+  appendAnalogZone(json, sample, 1);
+  json.raw(',');
+  appendClimateZone(json, sample, 2);
+  json.raw(",\"fan_on\":");
+  json.boolean(sample.highTempAlert);
+}
+
+void appendIdentity(JsonWriter& json, const char* deviceId, uint32_t seq) {
+  if (deviceId) {
+    json.raw(",\"device\":");
+    json.quoted(deviceId);
+  }
+  json.raw(",\"seq\":");
+  json.unsignedInteger(seq);
+}
+
+void endPayload(JsonWriter& json) {
+  json.raw('}');
+}
+
+size_t encodePayload(const SensorSample& sample, char* buffer, size_t capacity) {
+  JsonWriter json(buffer, capacity);
+  beginPayload(json, sample);
+  endPayload(json);
+  return json.ok() ? json.length() : 0;
+}
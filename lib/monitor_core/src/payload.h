@@ -0,0 +1,31 @@
+#pragma once
+
+#include "json_writer.h"
+#include "sensor_sample.h"
+
+// Largest payload the firmware builds, diagnostics included.
+const size_t PAYLOAD_BUFFER_SIZE = 1024;
+
+// Writes the sensor fields of the log-sensor-data contract without the
+// closing brace, so diagnostics can be appended before endPayload().
+void beginPayload(JsonWriter& json, const SensorSample& sample);
+void endPayload(JsonWriter& json);
+
+// ,"device":"...","seq":N between beginPayload() and endPayload(). A null
+// deviceId writes only "seq" (readings inside a batch that names the device).
+void appendIdentity(JsonWriter& json, const char* deviceId, uint32_t seq);
+
+// One zone object, "zone<N>":{...}, as beginPayload() writes zone 1 (analog
+// kind) and zone 2 (climate kind). Used on their own by the zone scaling
+// benchmark.
+void appendAnalogZone(JsonWriter& json, const SensorSample& sample, int zoneNumber);
+void appendClimateZone(JsonWriter& json, const SensorSample& sample, int zoneNumber);
+
+// Convenience for the common case: the complete payload for one sample.
+size_t encodePayload(const SensorSample& sample, char* buffer, size_t capacity);
+
+// Whether the ingest endpoint stored the reading: 204 for the minimal
+// acknowledgement, 200/201 from deployments that still echo the row.
+inline bool uplinkAccepted(int status) {
+  return status == 200 || status == 201 || status == 204;
+}
@@ -0,0 +1,167 @@
+#include "sample_history.h"
+
+#include <math.h>
+
+#include "sample_rollup.h"
+
+const HistoryChannelInfo HISTORY_CHANNEL_INFO[HISTORY_CHANNELS] = {
+  {"z1_temp", 10, 1},
+  {"z1_lux", 1, 0},
+  {"z2_temp", 10, 1},
+  {"z2_humidity", 10, 1},
+};
+
+static bool before(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+size_t historyIndexSize(size_t capacity) {
+  return capacity / HISTORY_INDEX_STRIDE;
+}
+
+void historyBegin(SampleHistory& history, HistoryRecord* records, uint32_t* index, size_t capacity) {
+  capacity -= capacity % HISTORY_INDEX_STRIDE;
+  if (!records || !index) capacity = 0;
+  history.capacity = capacity;
+  for (int c = 0; c < HISTORY_CHANNELS; c++) {
+    HistoryRing& ring = history.rings[c];
+    ring.records = capacity ? records + c * capacity : nullptr;
+    ring.index = capacity ? index + c * historyIndexSize(capacity) : nullptr;
+    ring.head = 0;
+    ring.count = 0;
+  }
+}
+
+uint32_t historyRawSpanMs(const SampleHistory& history, uint32_t sampleIntervalMs) {
+  uint64_t span = (uint64_t)history.capacity * sampleIntervalMs;
+  return span < HISTORY_MAX_SPAN_MS ? (uint32_t)span : HISTORY_MAX_SPAN_MS;
+}
+
+void historyAppend(SampleHistory& history, HistoryChannel channel, uint32_t timeMs, int16_t value, uint16_t flags) {
+  HistoryRecord record = {timeMs, value, flags};
+  if (history.capacity == 0) {
+    if (history.rollup) rollupAdd(*history.rollup, channel, record);
+    return;
+  }
+  HistoryRing& ring = history.rings[channel];
+  if (ring.count == history.capacity && history.rollup) rollupAdd(*history.rollup, channel, ring.records[ring.head]);
+  if (ring.head % HISTORY_INDEX_STRIDE == 0) ring.index[ring.head / HISTORY_INDEX_STRIDE] = timeMs;
+  ring.records[ring.head] = record;
+  ring.head = ring.head + 1 == history.capacity ? 0 : ring.head + 1;
+  if (ring.count < history.capacity) ring.count++;
+}
+
+// Rounds to the channel's resolution; values past an int16 keep the end of
+// the range and say so in the flags.
+static void appendScaled(SampleHistory& history, HistoryChannel channel, uint32_t nowMs, float reading, uint16_t flags) {
+  if (!isfinite(reading)) return;
+  float scaled = roundf(reading * HISTORY_CHANNEL_INFO[channel].scale);
+  int16_t value;
+  if (scaled > 32767.0f) {
+    value = 32767;
+    flags |= HISTORY_ABOVE_RANGE;
+  } else if (scaled < -32768.0f) {
+    value = -32768;
+    flags |= HISTORY_BELOW_RANGE;
+  } else {
+    value = (int16_t)scaled;
+  }
+  historyAppend(history, channel, nowMs, value, flags);
+}
+
+void historyAppendSample(SampleHistory& history, const SensorSample& sample, uint32_t nowMs) {
+  uint16_t zone1 = sample.zone1Alert ? HISTORY_ALERT : 0;
+  if (sample.temperatureCZ1 != TEMP_INVALID) {
+    appendScaled(history, HISTORY_TEMP_Z1, nowMs, sample.temperatureCZ1, zone1);
+  }
+  if (sample.luxZ1 == LUX_DARK) {
+    historyAppend(history, HISTORY_LUX_Z1, nowMs, 0, zone1 | HISTORY_BELOW_RANGE);
+  } else if (sample.luxZ1 == LUX_BRIGHT) {
+    historyAppend(history, HISTORY_LUX_Z1, nowMs, 32767, zone1 | HISTORY_ABOVE_RANGE);
+  } else {
+    appendScaled(history, HISTORY_LUX_Z1, nowMs, sample.luxZ1, zone1);
+  }
+
+  if (sample.climateOk) {
+    uint16_t zone2 = sample.zone2Alert ? HISTORY_ALERT : 0;
+    appendScaled(history, HISTORY_TEMP_Z2, nowMs, sample.temperatureCZ2, zone2);
+    appendScaled(history, HISTORY_HUMIDITY_Z2, nowMs, sample.humidityZ2, zone2);
+  }
+}
+
+// First slot in [lo, hi) whose record is not before sinceMs, for slots in
+// time order. The index narrows it to one block, which is then scanned.
+static size_t lowerBound(const HistoryRing& ring, size_t lo, size_t hi, uint32_t sinceMs) {
+  size_t scan = lo;
+  size_t first = (lo + HISTORY_INDEX_STRIDE - 1) / HISTORY_INDEX_STRIDE;
+  size_t last = (hi + HISTORY_INDEX_STRIDE - 1) / HISTORY_INDEX_STRIDE;
+  while (first < last) {
+    size_t mid = first + (last - first) / 2;
+    if (before(ring.index[mid], sinceMs)) {
+      scan = mid * HISTORY_INDEX_STRIDE;
+      first = mid + 1;
+    } else {
+      last = mid;
+    }
+  }
+  while (scan < hi && before(ring.records[scan].timeMs, sinceMs)) scan++;
+  return scan;
+}
+
+HistoryRange historySince(const SampleHistory& history, HistoryChannel channel, uint32_t sinceMs) {
+  HistoryRange range = {nullptr, 0, nullptr, 0};
+  const HistoryRing& ring = history.rings[channel];
+  if (ring.count == 0) return range;
+
+  size_t capacity = history.capacity;
+  size_t oldest = (ring.head + capacity - ring.count) % capacity;
+  if (oldest + ring.count <= capacity) {
+    size_t end = oldest + ring.count;
+    size_t start = lowerBound(ring, oldest, end, sinceMs);
+    range.first = ring.records + start;
+    range.firstCount = end - start;
+  } else if (!before(ring.records[capacity - 1].timeMs, sinceMs)) {
+    size_t start = lowerBound(ring, oldest, capacity, sinceMs);
+    range.first = ring.records + start;
+    range.firstCount = capacity - start;
+    range.second = ring.records;
+    range.secondCount = ring.head;
+  } else {
+    size_t start = lowerBound(ring, 0, ring.head, sinceMs);
+    range.first = ring.records + start;
+    range.firstCount = ring.head - start;
+  }
+  return range;
+}
+
+HistoryRange historyLast(const SampleHistory& history, HistoryChannel channel, uint32_t nowMs, uint32_t windowMs) {
+  return historySince(history, channel, nowMs - windowMs);
+}
+
+float historyValue(HistoryChannel channel, int16_t value) {
+  return (float)value / HISTORY_CHANNEL_INFO[channel].scale;
+}
+
+HistoryStats historyStats(HistoryChannel channel, const HistoryRange& range) {
+  HistoryStats stats = {0, 0, 0, 0, 0};
+  int16_t low = 32767;
+  int16_t high = -32768;
+  int64_t sum = 0;
+  const HistoryRecord* segments[2] = {range.first, range.second};
+  size_t counts[2] = {range.firstCount, range.secondCount};
+  for (int s = 0; s < 2; s++) {
+    for (size_t i = 0; i < counts[s]; i++) {
+      const HistoryRecord& record = segments[s][i];
+      if (record.value < low) low = record.value;
+      if (record.value > high) high = record.value;
+      sum += record.value;
+      if (record.flags & HISTORY_ALERT) stats.alerts++;
+    }
+  }
+  stats.count = range.size();
+  if (stats.count == 0) return stats;
+  stats.min = historyValue(channel, low);
+  stats.max = historyValue(channel, high);
+  stats.mean = (float)sum / (float)stats.count / HISTORY_CHANNEL_INFO[channel].scale;
+  return stats;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sensor_sample.h"
+
+// Recent readings kept on the device, one ring per channel, so the local
+// HTTP API and the LCD can show history without a round trip to the backend.
+//
+// A record is 8 bytes: the halMillis() time of the sample, the value as a
+// scaled 16-bit integer and flag bits. Nothing here allocates; the caller
+// hands over the record storage (PSRAM when the board has it, see
+// src/main.cpp) and a coarse time index with one entry per
+// HISTORY_INDEX_STRIDE records, small enough for internal RAM, so a range
+// search reads the records of one block only. Times are compared as wrapping
+// differences: the millis() rollover after 49.7 days is harmless as long as
+// a ring spans less than 24 days.
+
+enum HistoryChannel {
+  HISTORY_TEMP_Z1,
+  HISTORY_LUX_Z1,
+  HISTORY_TEMP_Z2,
+  HISTORY_HUMIDITY_Z2,
+  HISTORY_CHANNELS
+};
+
+struct HistoryChannelInfo {
+  const char* name;  // the sensor_logs column it mirrors
+  int16_t scale;     // stored value = reading * scale
+  uint8_t decimals;
+};
+
+extern const HistoryChannelInfo HISTORY_CHANNEL_INFO[HISTORY_CHANNELS];
+
+// Record flags. Out-of-range readings keep the end of the range as their
+// value, so min and max over a window still order them sensibly: a dark LDR
+// is stored as 0 lux, a saturated one as 32767.
+const uint16_t HISTORY_ALERT = 1;
+const uint16_t HISTORY_BELOW_RANGE = 2;
+const uint16_t HISTORY_ABOVE_RANGE = 4;
+
+struct HistoryRecord {
+  uint32_t timeMs;
+  int16_t value;
+  uint16_t flags;
+};
+
+const size_t HISTORY_INDEX_STRIDE = 32;
+// The wrapping comparison above holds for anything shorter.
+const uint32_t HISTORY_MAX_SPAN_MS = 24UL * 24 * 60 * 60 * 1000;
+
+struct SampleRollup;
+
+struct HistoryRing {
+  HistoryRecord* records;
+  uint32_t* index;  // time of the record in slot i * HISTORY_INDEX_STRIDE
+  size_t head;
+  size_t count;
+};
+
+struct SampleHistory {
+  HistoryRing rings[HISTORY_CHANNELS];
+  size_t capacity = 0;
+  SampleRollup* rollup = nullptr;  // where overwritten records go, see sample_rollup.h
+};
+
+// historyBegin() takes HISTORY_CHANNELS * capacity records and
+// HISTORY_CHANNELS * historyIndexSize(capacity) index entries. The capacity
+// is rounded down to a multiple of the stride; 0 (or null storage) gives a
+// history that stays empty.
+size_t historyIndexSize(size_t capacity);
+void historyBegin(SampleHistory& history, HistoryRecord* records, uint32_t* index, size_t capacity);
+
+// How far back a full ring reaches with a record every sampleIntervalMs,
+// at most HISTORY_MAX_SPAN_MS.
+uint32_t historyRawSpanMs(const SampleHistory& history, uint32_t sampleIntervalMs);
+
+// Records each channel the sample has a fresh value for: zone 2 only when
+// the DHT read succeeded, since its values are otherwise the sticky last ones.
+void historyAppendSample(SampleHistory& history, const SensorSample& sample, uint32_t nowMs);
+// Times must not go backwards within a channel.
+void historyAppend(SampleHistory& history, HistoryChannel channel, uint32_t timeMs, int16_t value, uint16_t flags);
+
+// A run of records in time order, viewed in place. The ring may wrap, so a
+// range is up to two contiguous segments; it stays valid until the next
+// append to its channel.
+struct HistoryRange {
+  const HistoryRecord* first;
+  size_t firstCount;
+  const HistoryRecord* second;
+  size_t secondCount;
+
+  size_t size() const { return firstCount + secondCount; }
+  const HistoryRecord& operator[](size_t i) const { return i < firstCount ? first[i] : second[i - firstCount]; }
+};
+
+// Every record of the channel at or after sinceMs.
+HistoryRange historySince(const SampleHistory& history, HistoryChannel channel, uint32_t sinceMs);
+// The last windowMs before nowMs.
+HistoryRange historyLast(const SampleHistory& history, HistoryChannel channel, uint32_t nowMs, uint32_t windowMs);
+
+struct HistoryStats {
+  size_t count;
+  size_t alerts;
+  float min;
+  float max;
+  float mean;
+};
+
+// min, max and mean are in channel units and 0 for an empty range.
+HistoryStats historyStats(HistoryChannel channel, const HistoryRange& range);
+float historyValue(HistoryChannel channel, int16_t value);
@@ -0,0 +1,132 @@
+#include "sample_rollup.h"
+
+static bool before(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+void rollupBegin(SampleRollup& rollup, RollupBucket* const storage[ROLLUP_LEVELS],
+                 const size_t capacity[ROLLUP_LEVELS]) {
+  for (int level = 0; level < ROLLUP_LEVELS; level++) {
+    rollup.capacity[level] = storage[level] ? capacity[level] : 0;
+    for (int c = 0; c < HISTORY_CHANNELS; c++) {
+      RollupRing& ring = rollup.rings[level][c];
+      ring.buckets = rollup.capacity[level] ? storage[level] + c * capacity[level] : nullptr;
+      ring.head = 0;
+      ring.count = 0;
+      ring.open.count = 0;
+    }
+  }
+}
+
+void historyAttachRollup(SampleHistory& history, SampleRollup* rollup) {
+  history.rollup = rollup;
+}
+
+static void merge(RollupBucket& into, const RollupBucket& from) {
+  if (from.min < into.min) into.min = from.min;
+  if (from.max > into.max) into.max = from.max;
+  into.sum += from.sum;
+  into.count += from.count;
+  into.alerts += from.alerts;
+}
+
+// Adds a record or a closed bucket from the level below. It joins the open
+// bucket when it falls in the same slot; otherwise the open bucket is closed
+// into the ring, pushing the ring's oldest bucket up a level if it is full.
+static void fold(SampleRollup& rollup, int level, HistoryChannel channel, const RollupBucket& item) {
+  if (level == ROLLUP_LEVELS) return;
+  if (rollup.capacity[level] == 0) {
+    fold(rollup, level + 1, channel, item);
+    return;
+  }
+
+  RollupRing& ring = rollup.rings[level][channel];
+  uint32_t start = item.startMs - item.startMs % ROLLUP_WIDTH_MS[level];
+  if (ring.open.count > 0 && ring.open.startMs == start) {
+    merge(ring.open, item);
+    return;
+  }
+
+  if (ring.open.count > 0) {
+    size_t capacity = rollup.capacity[level];
+    if (ring.count == capacity) fold(rollup, level + 1, channel, ring.buckets[ring.head]);
+    ring.buckets[ring.head] = ring.open;
+    ring.head = ring.head + 1 == capacity ? 0 : ring.head + 1;
+    if (ring.count < capacity) ring.count++;
+  }
+  ring.open = item;
+  ring.open.startMs = start;
+}
+
+void rollupAdd(SampleRollup& rollup, HistoryChannel channel, const HistoryRecord& record) {
+  RollupBucket item = {record.timeMs, record.value, record.value, record.value, 1,
+                       (uint16_t)((record.flags & HISTORY_ALERT) ? 1 : 0)};
+  fold(rollup, 0, channel, item);
+}
+
+uint32_t historySpanMs(const SampleHistory& history, uint32_t sampleIntervalMs) {
+  uint64_t span = historyRawSpanMs(history, sampleIntervalMs);
+  if (history.rollup) {
+    for (int level = 0; level < ROLLUP_LEVELS; level++) {
+      span += (uint64_t)history.rollup->capacity[level] * ROLLUP_WIDTH_MS[level];
+    }
+  }
+  return span < HISTORY_MAX_SPAN_MS ? (uint32_t)span : HISTORY_MAX_SPAN_MS;
+}
+
+// Window totals, wider than a bucket: a week of buckets can hold more
+// samples than a bucket's own count does.
+struct WindowTotals {
+  int16_t min;
+  int16_t max;
+  int64_t sum;
+  size_t count;
+  size_t alerts;
+};
+
+static void addToTotals(WindowTotals& totals, int16_t min, int16_t max, int64_t sum, size_t count, size_t alerts) {
+  if (totals.count == 0 || min < totals.min) totals.min = min;
+  if (totals.count == 0 || max > totals.max) totals.max = max;
+  totals.sum += sum;
+  totals.count += count;
+  totals.alerts += alerts;
+}
+
+static void addBucket(WindowTotals& totals, const RollupBucket& bucket, uint32_t sinceMs, uint32_t widthMs) {
+  if (bucket.count == 0 || before(bucket.startMs + (widthMs - 1), sinceMs)) return;
+  addToTotals(totals, bucket.min, bucket.max, bucket.sum, bucket.count, bucket.alerts);
+}
+
+HistoryStats historyWindowStats(const SampleHistory& history, HistoryChannel channel, uint32_t nowMs,
+                                uint32_t windowMs) {
+  uint32_t sinceMs = nowMs - windowMs;
+  WindowTotals totals = {0, 0, 0, 0, 0};
+
+  HistoryRange range = historyLast(history, channel, nowMs, windowMs);
+  for (size_t i = 0; i < range.size(); i++) {
+    const HistoryRecord& record = range[i];
+    addToTotals(totals, record.value, record.value, record.value, 1, (record.flags & HISTORY_ALERT) ? 1 : 0);
+  }
+
+  // Newest first, so each ring stops at the first bucket that ends before
+  // the window.
+  const SampleRollup* rollup = history.rollup;
+  for (int level = 0; rollup && level < ROLLUP_LEVELS; level++) {
+    const RollupRing& ring = rollup->rings[level][channel];
+    uint32_t width = ROLLUP_WIDTH_MS[level];
+    addBucket(totals, ring.open, sinceMs, width);
+    size_t capacity = rollup->capacity[level];
+    for (size_t i = 0; i < ring.count; i++) {
+      const RollupBucket& bucket = ring.buckets[(ring.head + capacity - 1 - i) % capacity];
+      if (before(bucket.startMs + (width - 1), sinceMs)) break;
+      addBucket(totals, bucket, sinceMs, width);
+    }
+  }
+
+  HistoryStats stats = {totals.count, totals.alerts, 0, 0, 0};
+  if (totals.count == 0) return stats;
+  stats.min = historyValue(channel, totals.min);
+  stats.max = historyValue(channel, totals.max);
+  stats.mean = (float)totals.sum / (float)totals.count / HISTORY_CHANNEL_INFO[channel].scale;
+  return stats;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sample_history.h"
+
+// Older history at falling resolution, so a day or a week of high/low fits
+// next to the raw rings. A record that is about to be overwritten in its
+// raw ring is folded into a 1-minute bucket; once the minute ring is full,
+// its oldest bucket folds into a 15-minute one in the same way. Each item
+// lives in exactly one level, so a window query adds up the raw records and
+// the buckets without counting anything twice.
+//
+// Buckets are aligned to halMillis(), not the wall clock; the one that spans
+// the millis() rollover is cut short. Windows that reach past the raw ring
+// are resolved to whole buckets: a bucket counts if any part of it is inside.
+
+const int ROLLUP_LEVELS = 2;
+const uint32_t ROLLUP_WIDTH_MS[ROLLUP_LEVELS] = {60000, 900000};
+
+// 16 bytes. The sum keeps the mean exact as buckets merge.
+struct RollupBucket {
+  uint32_t startMs;
+  int16_t min;
+  int16_t max;
+  int32_t sum;
+  uint16_t count;
+  uint16_t alerts;
+};
+
+struct RollupRing {
+  RollupBucket* buckets;
+  size_t head;
+  size_t count;
+  RollupBucket open;  // still filling; count 0 when there is none
+};
+
+struct SampleRollup {
+  RollupRing rings[ROLLUP_LEVELS][HISTORY_CHANNELS];
+  size_t capacity[ROLLUP_LEVELS] = {0, 0};
+};
+
+// Each level takes HISTORY_CHANNELS * capacity[level] buckets. A level with
+// no storage passes what it is given straight on; the last level drops its
+// oldest bucket when full. Attaching the rollup makes historyAppend() feed it
+// (every record, when the history itself has no storage).
+void rollupBegin(SampleRollup& rollup, RollupBucket* const storage[ROLLUP_LEVELS],
+                 const size_t capacity[ROLLUP_LEVELS]);
+void historyAttachRollup(SampleHistory& history, SampleRollup* rollup);
+
+void rollupAdd(SampleRollup& rollup, HistoryChannel channel, const HistoryRecord& record);
+
+// historyRawSpanMs() plus every level's full ring of buckets: the longest
+// window historyWindowStats() can answer.
+uint32_t historySpanMs(const SampleHistory& history, uint32_t sampleIntervalMs);
+
+// Raw records and buckets of the channel within the last windowMs before
+// nowMs, as historyStats() reports them.
+HistoryStats historyWindowStats(const SampleHistory& history, HistoryChannel channel, uint32_t nowMs,
+                                uint32_t windowMs);
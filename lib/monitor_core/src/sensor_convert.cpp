@@ -0,0 +1,62 @@
+#include "sensor_convert.h"
+
+#include <math.h>
+
+#include "device_config.h"
+
+static NtcReading ntcFault(NtcStatus status, float detail) {
+  NtcReading r = {TEMP_INVALID, status, detail};
+  return r;
+}
+
+NtcReading ntcCelsiusFromAdc(int analogValue) {
+  const DeviceConfig& config = deviceConfig;
+  if (analogValue <= 0 || analogValue >= config.adcMax) {
+      return ntcFault(NTC_INVALID_ADC, (float)analogValue);
+  }
+
+  // The divider gives series / R_ntc; the beta equation wants R_ntc / R0.
+  float term1 = config.adcMax / (float)analogValue - 1.0;
+  if (term1 <= 0) {
+       return ntcFault(NTC_TERM1_INVALID, term1);
+  }
+
+  float term2 = log((double)(config.ntcSeriesOhm / config.ntcNominalOhm) / term1);
+  float term3 = term2 / config.ntcBeta;
+  float term4 = term3 + (1.0 / config.ntcT0Kelvin);
+  if (fabs(term4) < 1e-9) {
+      return ntcFault(NTC_TERM4_ZERO, term4);
+  }
+
+  float kelvin = 1.0 / term4;
+  float celsius = kelvin - 273.15;
+
+  if (!isfinite(celsius)) {
+      return ntcFault(NTC_NOT_FINITE, celsius);
+  }
+  NtcReading r = {celsius, NTC_OK, 0};
+  return r;
+}
+
+float ldrLuxFromAdc(int analogValue) {
+  const DeviceConfig& config = deviceConfig;
+  float voltage = (float)analogValue / config.adcMax * config.adcRefVoltage;
+
+  if (voltage <= 0.01) {
+       return LUX_DARK;
+  }
+  if (voltage >= (config.adcRefVoltage - 0.01)) {
+      return LUX_BRIGHT;
+  }
+
+  float resistance = config.ldrSeriesOhm * voltage / (config.adcRefVoltage - voltage);
+  if (resistance <=0) return LUX_BRIGHT;
+
+  float lux = pow(config.ldrRl10KOhm * 1e3 * pow(10, config.ldrGamma) / resistance, (1.0 / config.ldrGamma));
+
+  if (!isfinite(lux)) {
+      return LUX_DARK;
+  }
+
+  return lux;
+}
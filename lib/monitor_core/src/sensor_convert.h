@@ -0,0 +1,15 @@
+#pragma once
+
+#include "sensor_sample.h"
+
+// Pure ADC-code conversions, kept free of I/O so they can be benchmarked and
+// replayed on the host.
+
+struct NtcReading {
+  float celsius;
+  NtcStatus status;
+  float detail;
+};
+
+NtcReading ntcCelsiusFromAdc(int analogValue);
+float ldrLuxFromAdc(int analogValue);
@@ -0,0 +1,39 @@
+#pragma once
+
+// One reading of both zones plus the derived alert state.
+//
+// Sentinels follow the original firmware: a zone 1 temperature of -999 is a
+// failed NTC conversion; lux of -1 means too dark to measure and 0 means
+// saturated bright. Zone 2 values are sticky across DHT read failures and
+// read -999 before the first good reading (-998 once a read has failed).
+
+const float TEMP_INVALID = -999.0;
+const float DHT_NEVER_READ = -999.0;
+const float DHT_READ_FAILED = -998.0;
+const float LUX_DARK = -1.0;
+const float LUX_BRIGHT = 0.0;
+
+enum NtcStatus {
+  NTC_OK,
+  NTC_INVALID_ADC,
+  NTC_TERM1_INVALID,
+  NTC_TERM4_ZERO,
+  NTC_NOT_FINITE
+};
+
+struct SensorSample {
+  float temperatureCZ1 = TEMP_INVALID;
+  float luxZ1 = LUX_DARK;
+  float temperatureCZ2 = DHT_NEVER_READ;
+  float humidityZ2 = DHT_NEVER_READ;
+
+  bool zone1Alert = false;
+  bool zone2Alert = false;
+  bool highTempAlert = false;
+
+  int ntcRaw = 0;
+  NtcStatus ntcStatus = NTC_OK;
+  float ntcDetail = 0;
+  bool climateOk = false;
+  int climateStatus = 0;
+};
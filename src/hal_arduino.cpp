@@ -0,0 +1,248 @@
+#include <Arduino.h>
+#include <DHTesp.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <esp_system.h>
+#include <mbedtls/md.h>
+#include <time.h>
+
+#include "hal.h"
+#include "device_config.h"
+#include "hal_arduino.h"
+#include "loop_profiler.h"
+#include "payload.h"
+#include "trace_buffer.h"
+
+static DHTesp dht;
+static char serverHost[CONFIG_HOST_SIZE];
+static const uint16_t SERVER_PORT = 443;
+static const char PREFS_NAMESPACE[] = "monitor";
+static const char PREFS_SEQUENCE_KEY[] = "seq_next";
+static const char PREFS_SIGNING_KEY[] = "sign_key";
+static const char PREFS_CONFIG_KEY[] = "config";
+
+// Uploads are signed as in supabase/functions/log-sensor-data:
+// HMAC-SHA256 over "<unix time>.<nonce>." and the body. mbedtls runs SHA-256
+// on the ESP32's SHA accelerator, and the key's inner and outer pads are
+// computed once when it is loaded, so signing a payload costs a few blocks
+// of hardware hashing per cycle.
+static const size_t SIGNING_KEY_SIZE = 32;
+static const size_t NONCE_SIZE = 16;
+// Any earlier time means SNTP has not set the clock since boot.
+static const time_t CLOCK_VALID_AFTER = 1700000000;
+static const char* signingDeviceId = "";
+static mbedtls_md_context_t hmac;
+static bool signingKeyLoaded = false;
+
+static void extractHost(const char* url, char* host, size_t hostSize) {
+  const char* start = strstr(url, "://");
+  start = start ? start + 3 : url;
+  size_t len = strcspn(start, ":/");
+  if (len >= hostSize) len = hostSize - 1;
+  memcpy(host, start, len);
+  host[len] = '\0';
+}
+
+static void toHex(const uint8_t* bytes, size_t length, char* out) {
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+  for (size_t i = 0; i < length; i++) {
+    out[2 * i] = HEX_DIGITS[bytes[i] >> 4];
+    out[2 * i + 1] = HEX_DIGITS[bytes[i] & 0x0F];
+  }
+  out[2 * length] = '\0';
+}
+
+static bool loadSigningKey(const uint8_t* key, size_t length) {
+  signingKeyLoaded = length == SIGNING_KEY_SIZE && mbedtls_md_hmac_starts(&hmac, key, length) == 0;
+  return signingKeyLoaded;
+}
+
+void halArduinoBegin(const char* deviceId) {
+  extractHost(deviceConfig.serverUrl, serverHost, sizeof(serverHost));
+  dht.setup(deviceConfig.dhtPinZ2, DHTesp::DHT22);
+
+  signingDeviceId = deviceId;
+  mbedtls_md_init(&hmac);
+  if (mbedtls_md_setup(&hmac, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1) != 0) return;
+  uint8_t key[SIGNING_KEY_SIZE];
+  Preferences prefs;
+  prefs.begin(PREFS_NAMESPACE, true);
+  size_t length = prefs.getBytes(PREFS_SIGNING_KEY, key, sizeof(key));
+  prefs.end();
+  loadSigningKey(key, length);
+  memset(key, 0, sizeof(key));
+}
+
+bool halSetSigningKey(const uint8_t* key, size_t length) {
+  if (length != SIGNING_KEY_SIZE) return false;
+  Preferences prefs;
+  prefs.begin(PREFS_NAMESPACE, false);
+  bool stored = prefs.putBytes(PREFS_SIGNING_KEY, key, length) == length;
+  prefs.end();
+  return stored && loadSigningKey(key, length);
+}
+
+bool halHasSigningKey() {
+  return signingKeyLoaded;
+}
+
+// Fills header with the X-Signature value for body, or returns false (and
+// traces why) when the request has to go out unsigned.
+static bool signBody(const char* body, size_t length, char* header, size_t headerSize) {
+  if (!signingKeyLoaded) {
+    trace(TRACE_UPLINK_UNSIGNED, 0, 0);
+    return false;
+  }
+  time_t now = time(nullptr);
+  if (now < CLOCK_VALID_AFTER) {
+    trace(TRACE_UPLINK_UNSIGNED, 0, 1);
+    return false;
+  }
+
+  profileBegin(PHASE_SIGN);
+  uint8_t nonceBytes[NONCE_SIZE];
+  esp_fill_random(nonceBytes, sizeof(nonceBytes));
+  char nonce[2 * NONCE_SIZE + 1];
+  toHex(nonceBytes, sizeof(nonceBytes), nonce);
+  char prefix[48];
+  int prefixLength = snprintf(prefix, sizeof(prefix), "%ld.%s.", (long)now, nonce);
+
+  uint8_t mac[32];
+  bool ok = mbedtls_md_hmac_reset(&hmac) == 0 &&
+            mbedtls_md_hmac_update(&hmac, (const uint8_t*)prefix, prefixLength) == 0 &&
+            mbedtls_md_hmac_update(&hmac, (const uint8_t*)body, length) == 0 &&
+            mbedtls_md_hmac_finish(&hmac, mac) == 0;
+  char macHex[2 * sizeof(mac) + 1];
+  toHex(mac, sizeof(mac), macHex);
+  snprintf(header, headerSize, "t=%ld,n=%s,v1=%s", (long)now, nonce, macHex);
+  profileEnd(PHASE_SIGN);
+  return ok;
+}
+
+void halPinModeOutput(int pin) {
+  pinMode(pin, OUTPUT);
+}
+
+void halDigitalWrite(int pin, bool high) {
+  digitalWrite(pin, high ? HIGH : LOW);
+}
+
+int halAnalogRead(int pin) {
+  return analogRead(pin);
+}
+
+uint32_t halMillis() {
+  return millis();
+}
+
+uint32_t halMicros() {
+  return micros();
+}
+
+void halDelay(uint32_t ms) {
+  delay(ms);
+}
+
+bool halReadClimate(float& temperatureC, float& humidity, int& status) {
+  TempAndHumidity values = dht.getTempAndHumidity();
+  status = dht.getStatus();
+  if (status != DHTesp::ERROR_NONE) return false;
+  temperatureC = values.temperature;
+  humidity = values.humidity;
+  return true;
+}
+
+uint32_t halLoadSequence() {
+  Preferences prefs;
+  prefs.begin(PREFS_NAMESPACE, true);
+  uint32_t next = prefs.getUInt(PREFS_SEQUENCE_KEY, 0);
+  prefs.end();
+  return next;
+}
+
+void halStoreSequence(uint32_t next) {
+  Preferences prefs;
+  prefs.begin(PREFS_NAMESPACE, false);
+  prefs.putUInt(PREFS_SEQUENCE_KEY, next);
+  prefs.end();
+}
+
+// getBytes() refuses a buffer smaller than the blob, so the length comes
+// first; a longer blob is left for configLoad() to reject by its length.
+size_t halLoadConfig(void* data, size_t capacity) {
+  Preferences prefs;
+  prefs.begin(PREFS_NAMESPACE, true);
+  size_t length = prefs.getBytesLength(PREFS_CONFIG_KEY);
+  if (length > 0 && length <= capacity) length = prefs.getBytes(PREFS_CONFIG_KEY, data, capacity);
+  prefs.end();
+  return length;
+}
+
+bool halStoreConfig(const void* data, size_t length) {
+  Preferences prefs;
+  prefs.begin(PREFS_NAMESPACE, false);
+  bool stored = prefs.putBytes(PREFS_CONFIG_KEY, data, length) == length;
+  prefs.end();
+  return stored;
+}
+
+int halHttpPost(const char* body, size_t length) {
+    if (WiFi.status() != WL_CONNECTED) {
+        trace(TRACE_WIFI_NOT_CONNECTED);
+        return HTTPC_ERROR_NOT_CONNECTED;
+    }
+
+    WiFiClientSecure client;
+    client.setInsecure();
+
+    HTTPClient http;
+
+    trace(TRACE_UPLINK_BEGIN, 0, length);
+
+    // Connect explicitly so the TLS handshake is timed on its own;
+    // HTTPClient reuses an already-connected client for the POST.
+    profileBegin(PHASE_TLS_CONNECT);
+    bool connected = client.connect(serverHost, SERVER_PORT);
+    profileEnd(PHASE_TLS_CONNECT);
+    if (!connected) {
+        trace(TRACE_TLS_CONNECT_FAILED, SERVER_PORT);
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    http.setTimeout(10000);
+
+    http.begin(client, deviceConfig.serverUrl);
+
+    http.addHeader("Content-Type", "application/json");
+    // The function answers 204 with no body instead of echoing the stored row.
+    http.addHeader("Prefer", "return=minimal");
+    char signature[128];
+    if (signBody(body, length, signature, sizeof(signature))) {
+        http.addHeader("X-Device-Id", signingDeviceId);
+        http.addHeader("X-Signature", signature);
+    }
+
+    profileBegin(PHASE_POST);
+    int httpResponseCode = http.POST((uint8_t*)body, length);
+    profileEnd(PHASE_POST);
+
+    if (httpResponseCode == HTTP_CODE_NO_CONTENT) {
+        // Nothing to read: skip getString() and the String it allocates.
+        trace(TRACE_HTTP_RESPONSE, 0, httpResponseCode);
+    } else if (httpResponseCode > 0) {
+        profileBegin(PHASE_RESPONSE);
+        String response = http.getString();
+        profileEnd(PHASE_RESPONSE);
+        trace(TRACE_HTTP_RESPONSE, response.length() > UINT16_MAX ? UINT16_MAX : response.length(), httpResponseCode);
+         if (!uplinkAccepted(httpResponseCode)) {
+             trace(TRACE_HTTP_UNEXPECTED_STATUS, 0, httpResponseCode);
+         }
+    } else {
+        trace(TRACE_HTTP_ERROR, 0, httpResponseCode);
+    }
+
+    http.end();
+    return httpResponseCode;
+}
@@ -0,0 +1,160 @@
+#include "heap_monitor.h"
+
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+struct WatchedTask {
+  const char* name;
+  TaskHandle_t handle;
+};
+
+static TaskHandle_t countedTask = NULL;
+static volatile uint32_t allocCount = 0;
+static volatile uint32_t allocBytes = 0;
+static volatile uint32_t freeCount = 0;
+
+static WatchedTask watchedTasks[HEAP_MONITOR_MAX_TASKS];
+static int watchedTaskCount = 0;
+
+static HeapCycleStats stats;
+static AllocCounters cycleStart;
+static AllocCounters uplinkStart;
+
+#ifdef HEAP_MONITOR_WRAP_MALLOC
+// Only the loop task is counted: Wi-Fi and lwIP tasks allocate on their own
+// schedule and would hide whether the sampling loop itself is allocation-free.
+static inline bool shouldCount() {
+  return countedTask != NULL && xTaskGetCurrentTaskHandle() == countedTask;
+}
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size) {
+  if (shouldCount()) {
+    allocCount++;
+    allocBytes += size;
+  }
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+  if (shouldCount()) {
+    allocCount++;
+    allocBytes += n * size;
+  }
+  return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  if (shouldCount() && size > 0) {
+    allocCount++;
+    allocBytes += size;
+  }
+  return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+  if (ptr != NULL && shouldCount()) freeCount++;
+  __real_free(ptr);
+}
+}
+#endif
+
+void heapMonitorBegin() {
+  countedTask = xTaskGetCurrentTaskHandle();
+  watchedTasks[0].name = pcTaskGetName(countedTask);
+  watchedTasks[0].handle = countedTask;
+  watchedTaskCount = 1;
+}
+
+void heapMonitorWatchTask(const char* name) {
+  if (watchedTaskCount >= HEAP_MONITOR_MAX_TASKS) return;
+  TaskHandle_t handle = xTaskGetHandle(name);
+  if (handle == NULL) return;
+  watchedTasks[watchedTaskCount].name = name;
+  watchedTasks[watchedTaskCount].handle = handle;
+  watchedTaskCount++;
+}
+
+AllocCounters allocCounters() {
+  AllocCounters now = {allocCount, allocBytes, freeCount};
+  return now;
+}
+
+AllocCounters allocDelta(const AllocCounters& since) {
+  AllocCounters now = allocCounters();
+  AllocCounters delta = {now.allocs - since.allocs, now.bytes - since.bytes, now.frees - since.frees};
+  return delta;
+}
+
+void heapMonitorCycleStart() {
+  cycleStart = allocCounters();
+}
+
+void heapMonitorCycleEnd() {
+  stats.cycle = allocDelta(cycleStart);
+  stats.freeHeap = esp_get_free_heap_size();
+  stats.largestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  stats.minFreeEver = esp_get_minimum_free_heap_size();
+  stats.cycles++;
+  if (stats.cycle.allocs > 0) stats.allocatingCycles++;
+}
+
+void heapMonitorUplinkStart() {
+  uplinkStart = allocCounters();
+}
+
+void heapMonitorUplinkEnd() {
+  stats.uplink = allocDelta(uplinkStart);
+}
+
+const HeapCycleStats& heapMonitorStats() {
+  return stats;
+}
+
+// ESP-IDF reports stack high-water marks in bytes, not words.
+void heapMonitorPrint(Print& out) {
+  out.printf("heap free=%lu largest=%lu min_ever=%lu\n", (unsigned long)stats.freeHeap,
+             (unsigned long)stats.largestFreeBlock, (unsigned long)stats.minFreeEver);
+  out.printf("last cycle: %lu allocs / %lu bytes / %lu frees\n", (unsigned long)stats.cycle.allocs,
+             (unsigned long)stats.cycle.bytes, (unsigned long)stats.cycle.frees);
+  out.printf("last uplink: %lu allocs / %lu bytes / %lu frees\n", (unsigned long)stats.uplink.allocs,
+             (unsigned long)stats.uplink.bytes, (unsigned long)stats.uplink.frees);
+  out.printf("allocating cycles: %lu of %lu\n", (unsigned long)stats.allocatingCycles, (unsigned long)stats.cycles);
+  for (int i = 0; i < watchedTaskCount; i++) {
+    out.printf("stack %-10s min free=%lu\n", watchedTasks[i].name,
+               (unsigned long)uxTaskGetStackHighWaterMark(watchedTasks[i].handle));
+  }
+}
+
+// Appends ,"heap":{...} for the telemetry payload.
+void heapMonitorAppendJson(JsonWriter& json) {
+  json.raw(",\"heap\":{\"free\":");
+  json.unsignedInteger(stats.freeHeap);
+  json.raw(",\"largest\":");
+  json.unsignedInteger(stats.largestFreeBlock);
+  json.raw(",\"min\":");
+  json.unsignedInteger(stats.minFreeEver);
+  json.raw(",\"cyc_allocs\":");
+  json.unsignedInteger(stats.cycle.allocs);
+  json.raw(",\"cyc_bytes\":");
+  json.unsignedInteger(stats.cycle.bytes);
+  json.raw(",\"up_allocs\":");
+  json.unsignedInteger(stats.uplink.allocs);
+  json.raw(",\"up_bytes\":");
+  json.unsignedInteger(stats.uplink.bytes);
+  json.raw(",\"stack\":{");
+  for (int i = 0; i < watchedTaskCount; i++) {
+    if (i > 0) json.raw(',');
+    json.quoted(watchedTasks[i].name);
+    json.raw(':');
+    json.unsignedInteger(uxTaskGetStackHighWaterMark(watchedTasks[i].handle));
+  }
+  json.raw("}}");
+}
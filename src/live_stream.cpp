@@ -0,0 +1,436 @@
+#include "live_stream.h"
+
+#include <WiFi.h>
+#include <lwip/sockets.h>
+
+#include "device_config.h"
+#include "json_writer.h"
+#include "sample_rollup.h"
+
+enum SubscriberState {
+  SUBSCRIBER_FREE,
+  SUBSCRIBER_READING_REQUEST,
+  SUBSCRIBER_STREAMING,
+  SUBSCRIBER_HISTORY
+};
+
+// Where a /history reply has got to. It is written a chunk at a time, only
+// when the socket can take it, so a slow client holds its slot rather than
+// the loop.
+enum HistoryPart {
+  HISTORY_OPEN,
+  HISTORY_CHANNEL_STATS,  // every channel; historyIndex is the next one
+  HISTORY_STATS,          // one channel
+  HISTORY_POINTS,         // historyIndex points sent, historySinceMs the next
+  HISTORY_DONE
+};
+
+struct Subscriber {
+  WiFiClient client;
+  SubscriberState state;
+  unsigned long acceptedAt;
+  unsigned long lastWriteAt;
+  char request[64];
+  uint8_t requestLen;
+  bool requestLineDone;
+  uint8_t headerMatch;
+  uint8_t head;
+  uint8_t count;
+  uint16_t eventLen[LIVE_STREAM_QUEUE_DEPTH];
+  char events[LIVE_STREAM_QUEUE_DEPTH][LIVE_STREAM_EVENT_MAX];
+  uint32_t dropped;
+  // GET /history. The queue is idle meanwhile and events[0] holds the chunk.
+  HistoryPart historyPart;
+  int8_t historyChannel;  // -1 for every channel
+  uint32_t historyMinutes;
+  uint32_t historyMaxMinutes;
+  uint32_t historyRequestedMinutes;
+  uint32_t historyNow;
+  uint32_t historySinceMs;
+  uint32_t historyIndex;
+};
+
+static WiFiServer server(LIVE_STREAM_PORT);
+static Subscriber subscribers[LIVE_STREAM_MAX_CLIENTS];
+static bool serverStarted = false;
+static uint32_t nextEventId = 1;
+static const SampleHistory* sampleHistory = nullptr;
+
+static const unsigned long REQUEST_TIMEOUT_MS = 2000;
+static const uint32_t HISTORY_DEFAULT_MINUTES = 60;
+static const size_t HISTORY_PIECE_MAX = 128;  // a channel's stats or a run of points
+static const int HISTORY_CHUNKS_PER_SERVICE = 4;
+static const unsigned long HISTORY_STALL_MS = 10000;
+
+static void closeSubscriber(Subscriber& sub) {
+  sub.client.stop();
+  sub.state = SUBSCRIBER_FREE;
+  sub.head = 0;
+  sub.count = 0;
+  sub.requestLen = 0;
+  sub.requestLineDone = false;
+  sub.headerMatch = 0;
+}
+
+static void acceptClients() {
+  WiFiClient incoming = server.available();
+  if (!incoming) return;
+
+  for (int i = 0; i < LIVE_STREAM_MAX_CLIENTS; i++) {
+    Subscriber& sub = subscribers[i];
+    if (sub.state != SUBSCRIBER_FREE) continue;
+    sub.client = incoming;
+    sub.client.setNoDelay(true);
+    sub.state = SUBSCRIBER_READING_REQUEST;
+    sub.acceptedAt = millis();
+    sub.requestLen = 0;
+    sub.requestLineDone = false;
+    sub.headerMatch = 0;
+    sub.head = 0;
+    sub.count = 0;
+    sub.dropped = 0;
+    return;
+  }
+
+  incoming.print("HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+  incoming.stop();
+}
+
+// Copies the value of name= from the request line's query string.
+static bool queryParam(const char* request, const char* name, char* out, size_t size) {
+  const char* p = strchr(request, '?');
+  if (!p) return false;
+  const char* end = strchr(p, ' ');
+  if (!end) end = request + strlen(request);
+  size_t nameLen = strlen(name);
+  for (p++; p < end;) {
+    const char* next = (const char*)memchr(p, '&', end - p);
+    if (!next) next = end;
+    if ((size_t)(next - p) > nameLen && strncmp(p, name, nameLen) == 0 && p[nameLen] == '=') {
+      size_t len = next - p - nameLen - 1;
+      if (len >= size) return false;
+      memcpy(out, p + nameLen + 1, len);
+      out[len] = '\0';
+      return true;
+    }
+    p = next + 1;
+  }
+  return false;
+}
+
+static bool writeAll(Subscriber& sub, const char* data, size_t len) {
+  return sub.client.write((const uint8_t*)data, len) == len;
+}
+
+static void appendStats(JsonWriter& json, HistoryChannel channel, const HistoryStats& stats) {
+  uint8_t decimals = HISTORY_CHANNEL_INFO[channel].decimals;
+  json.raw("\"count\":");
+  json.unsignedInteger(stats.count);
+  json.raw(",\"min\":");
+  if (stats.count) json.fixed(stats.min, decimals); else json.null();
+  json.raw(",\"max\":");
+  if (stats.count) json.fixed(stats.max, decimals); else json.null();
+  json.raw(",\"mean\":");
+  if (stats.count) json.fixed(stats.mean, decimals + 1); else json.null();
+  json.raw(",\"alerts\":");
+  json.unsignedInteger(stats.alerts);
+}
+
+// Zero-timeout writability probe so a stalled client never blocks the loop;
+// its queue keeps absorbing events and overflows drop the oldest instead.
+static bool canWrite(Subscriber& sub) {
+  int fd = sub.client.fd();
+  if (fd < 0) return false;
+  fd_set writeSet;
+  FD_ZERO(&writeSet);
+  FD_SET(fd, &writeSet);
+  struct timeval noWait = {0, 0};
+  return select(fd + 1, NULL, &writeSet, NULL, &noWait) > 0;
+}
+
+// Parses the query and sends the headers; the body follows from
+// writeHistory(). Returns false when the request was answered already.
+static bool startHistory(Subscriber& sub) {
+  char value[16];
+  int channel = -1;
+  if (queryParam(sub.request, "channel", value, sizeof(value))) {
+    for (int c = 0; c < HISTORY_CHANNELS; c++) {
+      if (strcmp(value, HISTORY_CHANNEL_INFO[c].name) == 0) channel = c;
+    }
+    if (channel < 0) {
+      sub.client.print("HTTP/1.1 404 Not Found\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+      return false;
+    }
+  }
+  // As far back as the rings reach at the current cycle interval: the raw
+  // ring alone for one channel's points, the rollups too for the summary.
+  uint32_t spanMs = channel < 0 ? historySpanMs(*sampleHistory, deviceConfig.cycleIntervalMs)
+                                : historyRawSpanMs(*sampleHistory, deviceConfig.cycleIntervalMs);
+  uint32_t maxMinutes = spanMs / 60000;
+  if (maxMinutes < 1) maxMinutes = 1;
+  uint32_t requested = HISTORY_DEFAULT_MINUTES;
+  if (queryParam(sub.request, "minutes", value, sizeof(value))) {
+    requested = strtoul(value, NULL, 10);
+    if (requested < 1) requested = 1;
+  }
+
+  sub.client.print("HTTP/1.1 200 OK\r\n"
+                   "Content-Type: application/json\r\n"
+                   "Cache-Control: no-cache\r\n"
+                   "Connection: close\r\n"
+                   "Access-Control-Allow-Origin: *\r\n\r\n");
+  sub.historyPart = HISTORY_OPEN;
+  sub.historyChannel = (int8_t)channel;
+  sub.historyMinutes = requested < maxMinutes ? requested : maxMinutes;
+  sub.historyMaxMinutes = maxMinutes;
+  sub.historyRequestedMinutes = requested;
+  sub.historyNow = millis();
+  sub.historySinceMs = sub.historyNow - sub.historyMinutes * 60000;
+  sub.historyIndex = 0;
+  return true;
+}
+
+// Appends the next pieces of the reply until the chunk is nearly full or the
+// reply is complete. Points are found again by time on every chunk, as
+// appends move them in the ring; any overwritten meanwhile are skipped, and
+// the reply ends at the time it was requested.
+static void fillHistoryChunk(Subscriber& sub, JsonWriter& json) {
+  while (sub.historyPart != HISTORY_DONE && json.length() + HISTORY_PIECE_MAX <= LIVE_STREAM_EVENT_MAX) {
+    uint32_t windowMs = sub.historyMinutes * 60000;
+    switch (sub.historyPart) {
+      case HISTORY_OPEN:
+        json.raw("{\"now\":");
+        json.unsignedInteger(sub.historyNow);
+        json.raw(",\"minutes\":");
+        json.unsignedInteger(sub.historyMinutes);
+        json.raw(",\"max_minutes\":");
+        json.unsignedInteger(sub.historyMaxMinutes);
+        if (sub.historyRequestedMinutes > sub.historyMinutes) {
+          json.raw(",\"requested_minutes\":");
+          json.unsignedInteger(sub.historyRequestedMinutes);
+        }
+        if (sub.historyChannel < 0) {
+          json.raw(",\"channels\":{");
+          sub.historyPart = HISTORY_CHANNEL_STATS;
+        } else {
+          sub.historyPart = HISTORY_STATS;
+        }
+        break;
+
+      case HISTORY_CHANNEL_STATS: {
+        HistoryChannel ch = (HistoryChannel)sub.historyIndex;
+        if (sub.historyIndex > 0) json.raw(',');
+        json.quoted(HISTORY_CHANNEL_INFO[ch].name);
+        json.raw(":{");
+        appendStats(json, ch, historyWindowStats(*sampleHistory, ch, sub.historyNow, windowMs));
+        json.raw('}');
+        if (++sub.historyIndex == HISTORY_CHANNELS) {
+          json.raw("}}");
+          sub.historyPart = HISTORY_DONE;
+        }
+        break;
+      }
+
+      case HISTORY_STATS: {
+        HistoryChannel ch = (HistoryChannel)sub.historyChannel;
+        json.raw(",\"channel\":");
+        json.quoted(HISTORY_CHANNEL_INFO[ch].name);
+        json.raw(',');
+        appendStats(json, ch, historyStats(ch, historyLast(*sampleHistory, ch, sub.historyNow, windowMs)));
+        json.raw(",\"points\":[");
+        sub.historyPart = HISTORY_POINTS;
+        break;
+      }
+
+      case HISTORY_POINTS: {
+        HistoryChannel ch = (HistoryChannel)sub.historyChannel;
+        uint8_t decimals = HISTORY_CHANNEL_INFO[ch].decimals;
+        HistoryRange range = historySince(*sampleHistory, ch, sub.historySinceMs);
+        size_t i = 0;
+        for (; i < range.size() && json.length() + HISTORY_PIECE_MAX <= LIVE_STREAM_EVENT_MAX; i++) {
+          const HistoryRecord& record = range[i];
+          if ((int32_t)(record.timeMs - sub.historyNow) > 0) break;
+          if (sub.historyIndex++ > 0) json.raw(',');
+          json.raw('[');
+          json.unsignedInteger(sub.historyNow - record.timeMs);
+          json.raw(',');
+          json.fixed(historyValue(ch, record.value), decimals);
+          json.raw(',');
+          json.unsignedInteger(record.flags);
+          json.raw(']');
+          sub.historySinceMs = record.timeMs + 1;
+        }
+        if (i < range.size() && (int32_t)(range[i].timeMs - sub.historyNow) <= 0) return;
+        json.raw("]}");
+        sub.historyPart = HISTORY_DONE;
+        break;
+      }
+
+      case HISTORY_DONE:
+        break;
+    }
+  }
+}
+
+// A few chunks per call while the socket takes them without blocking; a
+// client that takes nothing for HISTORY_STALL_MS is dropped.
+static void writeHistory(Subscriber& sub) {
+  if (!sub.client.connected()) {
+    closeSubscriber(sub);
+    return;
+  }
+
+  for (int chunk = 0; chunk < HISTORY_CHUNKS_PER_SERVICE && canWrite(sub); chunk++) {
+    JsonWriter json(sub.events[0], LIVE_STREAM_EVENT_MAX);
+    fillHistoryChunk(sub, json);
+    if (!json.ok() || !writeAll(sub, json.c_str(), json.length())) {
+      closeSubscriber(sub);
+      return;
+    }
+    sub.lastWriteAt = millis();
+    if (sub.historyPart == HISTORY_DONE) {
+      closeSubscriber(sub);
+      return;
+    }
+  }
+
+  if (millis() - sub.lastWriteAt > HISTORY_STALL_MS) closeSubscriber(sub);
+}
+
+// Reads the request without blocking: the first line is kept for routing and
+// the rest is skipped until the blank line that ends the headers.
+static void readRequest(Subscriber& sub) {
+  static const char HEADER_END[] = "\r\n\r\n";
+
+  while (sub.client.available() > 0) {
+    char c = (char)sub.client.read();
+    if (c == '\r' || c == '\n') {
+      sub.requestLineDone = true;
+    } else if (!sub.requestLineDone && sub.requestLen < sizeof(sub.request) - 1) {
+      sub.request[sub.requestLen++] = c;
+    }
+    if (c == HEADER_END[sub.headerMatch]) {
+      sub.headerMatch++;
+    } else {
+      sub.headerMatch = (c == '\r') ? 1 : 0;
+    }
+    if (sub.headerMatch == 4) break;
+  }
+  sub.request[sub.requestLen] = '\0';
+
+  if (sub.headerMatch < 4) {
+    if (millis() - sub.acceptedAt > REQUEST_TIMEOUT_MS || !sub.client.connected()) {
+      closeSubscriber(sub);
+    }
+    return;
+  }
+
+  if (strncmp(sub.request, "GET /history", 12) == 0 && sampleHistory) {
+    if (startHistory(sub)) {
+      sub.state = SUBSCRIBER_HISTORY;
+      sub.lastWriteAt = millis();
+    } else {
+      closeSubscriber(sub);
+    }
+    return;
+  }
+
+  if (strncmp(sub.request, "GET /events", 11) != 0) {
+    sub.client.print("HTTP/1.1 404 Not Found\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+    closeSubscriber(sub);
+    return;
+  }
+
+  sub.client.print("HTTP/1.1 200 OK\r\n"
+                   "Content-Type: text/event-stream\r\n"
+                   "Cache-Control: no-cache\r\n"
+                   "Connection: keep-alive\r\n"
+                   "Access-Control-Allow-Origin: *\r\n\r\n"
+                   "retry: 2000\n\n");
+  sub.state = SUBSCRIBER_STREAMING;
+  sub.lastWriteAt = millis();
+}
+
+static void flushQueue(Subscriber& sub) {
+  if (!sub.client.connected()) {
+    closeSubscriber(sub);
+    return;
+  }
+
+  while (sub.count > 0 && canWrite(sub)) {
+    if (!writeAll(sub, sub.events[sub.head], sub.eventLen[sub.head])) {
+      closeSubscriber(sub);
+      return;
+    }
+    sub.head = (sub.head + 1) % LIVE_STREAM_QUEUE_DEPTH;
+    sub.count--;
+    sub.lastWriteAt = millis();
+  }
+
+  if (sub.count == 0 && millis() - sub.lastWriteAt > LIVE_STREAM_KEEPALIVE_MS && canWrite(sub)) {
+    if (!writeAll(sub, ": ping\n\n", 8)) {
+      closeSubscriber(sub);
+      return;
+    }
+    sub.lastWriteAt = millis();
+  }
+}
+
+void liveStreamBegin(const SampleHistory* history) {
+  sampleHistory = history;
+  for (int i = 0; i < LIVE_STREAM_MAX_CLIENTS; i++) {
+    subscribers[i].state = SUBSCRIBER_FREE;
+  }
+  server.begin();
+  server.setNoDelay(true);
+  serverStarted = true;
+}
+
+void liveStreamService() {
+  if (!serverStarted || WiFi.status() != WL_CONNECTED) return;
+
+  acceptClients();
+
+  for (int i = 0; i < LIVE_STREAM_MAX_CLIENTS; i++) {
+    Subscriber& sub = subscribers[i];
+    if (sub.state == SUBSCRIBER_READING_REQUEST) {
+      readRequest(sub);
+    } else if (sub.state == SUBSCRIBER_STREAMING) {
+      flushQueue(sub);
+    } else if (sub.state == SUBSCRIBER_HISTORY) {
+      writeHistory(sub);
+    }
+  }
+}
+
+void liveStreamPublish(const char* json, size_t length) {
+  if (!serverStarted) return;
+
+  char event[LIVE_STREAM_EVENT_MAX];
+  int len = snprintf(event, sizeof(event), "id: %lu\ndata: %.*s\n\n", (unsigned long)nextEventId, (int)length, json);
+  if (len <= 0 || len >= (int)sizeof(event)) return;
+  nextEventId++;
+
+  for (int i = 0; i < LIVE_STREAM_MAX_CLIENTS; i++) {
+    Subscriber& sub = subscribers[i];
+    if (sub.state != SUBSCRIBER_STREAMING) continue;
+
+    if (sub.count == LIVE_STREAM_QUEUE_DEPTH) {
+      sub.head = (sub.head + 1) % LIVE_STREAM_QUEUE_DEPTH;
+      sub.count--;
+      sub.dropped++;
+    }
+    uint8_t tail = (sub.head + sub.count) % LIVE_STREAM_QUEUE_DEPTH;
+    memcpy(sub.events[tail], event, len);
+    sub.eventLen[tail] = (uint16_t)len;
+    sub.count++;
+  }
+}
+
+int liveStreamClientCount() {
+  int active = 0;
+  for (int i = 0; i < LIVE_STREAM_MAX_CLIENTS; i++) {
+    if (subscribers[i].state == SUBSCRIBER_STREAMING) active++;
+  }
+  return active;
+}
@@ -0,0 +1,123 @@
+#include "loop_profiler.h"
+
+#include <esp_timer.h>
+#include "trace_buffer.h"
+
+// Cycle counts wrap after ~17 s at 240 MHz, so longer spans (a stalled TLS
+// handshake) fall back to the microsecond esp_timer.
+static const int64_t CYCLE_COUNTER_SAFE_US = 10000000;
+
+static PhaseStats stats[PHASE_COUNT];
+static uint32_t startCycles[PHASE_COUNT];
+static int64_t startUs[PHASE_COUNT];
+
+static int bucketFor(uint32_t us) {
+  int bucket = 0;
+  while (us > 0 && bucket < PROFILE_BUCKETS - 1) {
+    us >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+static uint32_t bucketUpperUs(int bucket) {
+  return bucket == 0 ? 1 : (1UL << bucket);
+}
+
+void profileBegin(ProfilePhase phase) {
+  trace(TRACE_PHASE_BEGIN, phase);
+  startUs[phase] = esp_timer_get_time();
+  startCycles[phase] = ESP.getCycleCount();
+}
+
+void profileEnd(ProfilePhase phase) {
+  uint32_t endCycles = ESP.getCycleCount();
+  int64_t elapsedUs = esp_timer_get_time() - startUs[phase];
+
+  uint32_t us;
+  if (elapsedUs < CYCLE_COUNTER_SAFE_US) {
+    us = (endCycles - startCycles[phase]) / ESP.getCpuFreqMHz();
+  } else {
+    us = elapsedUs > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsedUs;
+  }
+
+  PhaseStats& s = stats[phase];
+  if (s.count == 0 || us < s.minUs) s.minUs = us;
+  if (us > s.maxUs) s.maxUs = us;
+  s.lastUs = us;
+  s.totalUs += us;
+  s.count++;
+  s.buckets[bucketFor(us)]++;
+  trace(TRACE_PHASE_END, phase, (int32_t)us);
+}
+
+void profileReset() {
+  memset(stats, 0, sizeof(stats));
+}
+
+const PhaseStats& profileStats(ProfilePhase phase) {
+  return stats[phase];
+}
+
+// Upper edge of the bucket holding the requested rank, clamped to the
+// observed max so a single sample doesn't report a power-of-two ceiling.
+uint32_t profilePercentileUs(ProfilePhase phase, float percentile) {
+  const PhaseStats& s = stats[phase];
+  if (s.count == 0) return 0;
+
+  uint32_t rank = (uint32_t)ceilf(percentile / 100.0f * s.count);
+  if (rank == 0) rank = 1;
+  uint32_t seen = 0;
+  for (int b = 0; b < PROFILE_BUCKETS; b++) {
+    seen += s.buckets[b];
+    if (seen >= rank) {
+      uint32_t upper = bucketUpperUs(b);
+      return upper < s.maxUs ? upper : s.maxUs;
+    }
+  }
+  return s.maxUs;
+}
+
+void profilePrint(Print& out) {
+  out.println("phase    count      min      p50      p99      max     mean  (us)");
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    ProfilePhase phase = (ProfilePhase)p;
+    const PhaseStats& s = stats[p];
+    uint32_t mean = s.count ? (uint32_t)(s.totalUs / s.count) : 0;
+    out.printf("%-6s %7lu %8lu %8lu %8lu %8lu %8lu\n", profilePhaseName(p),
+               (unsigned long)s.count, (unsigned long)s.minUs,
+               (unsigned long)profilePercentileUs(phase, 50), (unsigned long)profilePercentileUs(phase, 99),
+               (unsigned long)s.maxUs, (unsigned long)mean);
+  }
+  out.println("histogram (bucket k = [2^(k-1), 2^k) us):");
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    const PhaseStats& s = stats[p];
+    if (s.count == 0) continue;
+    out.printf("%-6s", profilePhaseName(p));
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+      if (s.buckets[b]) out.printf(" %d:%lu", b, (unsigned long)s.buckets[b]);
+    }
+    out.println();
+  }
+}
+
+// Appends ,"prof":{"adc":[count,p50,p99,max],...} for the telemetry payload.
+void profileAppendJson(JsonWriter& json) {
+  json.raw(",\"prof\":{");
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    ProfilePhase phase = (ProfilePhase)p;
+    const PhaseStats& s = stats[p];
+    if (p > 0) json.raw(',');
+    json.quoted(profilePhaseName(p));
+    json.raw(":[");
+    json.unsignedInteger(s.count);
+    json.raw(',');
+    json.unsignedInteger(profilePercentileUs(phase, 50));
+    json.raw(',');
+    json.unsignedInteger(profilePercentileUs(phase, 99));
+    json.raw(',');
+    json.unsignedInteger(s.maxUs);
+    json.raw(']');
+  }
+  json.raw('}');
+}
@@ -1,360 +1,452 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
-#include <math.h>
 #include <WiFi.h>
-#include <HTTPClient.h>
-#include <WiFiClientSecure.h>
-#include <DHTesp.h>
-
-const char* ssid = "Wokwi-GUEST";
-const char* password = "";
-const char* serverUrl = "https://elxrhewruujmwthlhhni.supabase.co/functions/v1/log-sensor-data";
-
-LiquidCrystal_I2C lcd1(0x27, 16, 2);
-LiquidCrystal_I2C lcd2(0x3F, 20, 4);
-
-const int TEMP_PIN_Z1 = 34;
-const int LIGHT_PIN_Z1 = 35;
-const int DHT_PIN_Z2 = 25;
-const int GREEN_LED_PIN = 19;
-const int YELLOW_LED_PIN = 18;
-const int RED_LED_PIN = 5;
-const int BUZZER_PIN = 17;
-const int FAN_LED_PIN = 16;
-
-const float ADC_MAX_VALUE = 4095.0;
-const float ADC_REF_VOLTAGE = 3.3;
-
-const float BETA = 3950;
-const float R_KNOWN = 10000;
-const float T0_KELVIN = 298.15;
-
-const float LDR_GAMMA = 0.7;
-const float LDR_RL10 = 50;
-const float LDR_SERIES_RESISTOR = 10000;
-
-const float TEMP_HIGH_THRESHOLD = 30.0;
-const float LIGHT_LOW_THRESHOLD = 100;
-const float HUMIDITY_HIGH_THRESHOLD = 70.0;
-
-bool zone1_alert = false;
-bool zone2_alert = false;
-bool high_temp_alert = false;
-
-DHTesp dht;
-float humidityZ2 = -999.0;
-float temperatureCZ2 = -999.0;
-
-float readNtcTemperature(int pin) {
-  int analogValue = analogRead(pin);
-  if (analogValue <= 0 || analogValue >= ADC_MAX_VALUE) {
-      Serial.printf("NTC Pin %d: Invalid ADC reading: %d\n", pin, analogValue);
-      return -999.0;
-  }
-
-  float term1 = ADC_MAX_VALUE / (float)analogValue - 1.0;
-  if (term1 <= 0) {
-       Serial.printf("NTC Pin %d: Calculation term1 invalid (<=0): %.2f\n", pin, term1);
-       return -999.0;
-  }
-
-  float term2 = log(1.0 / term1);
-  float term3 = term2 / BETA;
-  float term4 = term3 + (1.0 / T0_KELVIN);
-  if (abs(term4) < 1e-9) {
-      Serial.printf("NTC Pin %d: Calculation term4 near zero: %.6f\n", pin, term4);
-      return -999.0;
-  }
-
-  float kelvin = 1.0 / term4;
-  float celsius = kelvin - 273.15;
-
-  if (!isfinite(celsius)) {
-      Serial.printf("NTC Pin %d: Calculated temperature is not finite: %.2f\n", pin, celsius);
-      return -999.0;
-  }
-  return celsius;
-}
-
-float readLdrLux(int pin) {
-  int analogValue = analogRead(pin);
-  float voltage = (float)analogValue / ADC_MAX_VALUE * ADC_REF_VOLTAGE;
-
-  if (voltage <= 0.01) {
-       return -1.0;
-  }
-  if (voltage >= (ADC_REF_VOLTAGE - 0.01)) {
-      return 0.0;
-  }
-
-  float resistance = LDR_SERIES_RESISTOR * voltage / (ADC_REF_VOLTAGE - voltage);
-  if (resistance <=0) return 0.0;
-
-  float lux = pow(LDR_RL10 * 1e3 * pow(10, LDR_GAMMA) / resistance, (1.0 / LDR_GAMMA));
-
-  if (!isfinite(lux)) {
-      return -1.0;
-  }
-
-  return lux;
-}
+#include <esp_heap_caps.h>
+#include "alerts.h"
+#include "device_config.h"
+#include "device_identity.h"
+#include "hal.h"
+#include "hal_arduino.h"
+#include "lcd_format.h"
+#include "monitor_cycle.h"
+#include "payload.h"
+#include "sample_history.h"
+#include "sample_rollup.h"
+#include "live_stream.h"
+#include "loop_profiler.h"
+#include "trace_buffer.h"
+#include "heap_monitor.h"
+
+// Created in setup(), once the configuration has their I2C addresses.
+LiquidCrystal_I2C* lcd1;
+LiquidCrystal_I2C* lcd2;
+
+const unsigned long LIVE_SAMPLE_INTERVAL_MS = 2000;
+const unsigned long SERVICE_POLL_MS = 10;
+const unsigned long PROFILE_REPORT_EVERY_CYCLES = 10;
+
+// Per-channel history of cycle samples: 24 h in PSRAM when the board has
+// it, otherwise 4 h, which is what internal RAM can spare next to Wi-Fi
+// and TLS (4 channels x 480 x 8 bytes).
+const size_t HISTORY_CAPACITY_PSRAM = 2880;
+const size_t HISTORY_CAPACITY_INTERNAL = 480;
+const uint32_t HISTORY_SUMMARY_MS = 3600000;
+// Older samples roll up into 30 minutes of 1-minute buckets, then 15-minute
+// buckets: 7 days in PSRAM, otherwise 20 h, which with the 4 h raw ring still
+// covers the LCD's 24 h high/low (4 channels x 110 x 16 bytes, about 7 KB).
+const size_t ROLLUP_MINUTE_BUCKETS = 30;
+const size_t ROLLUP_QUARTER_BUCKETS_PSRAM = 672;
+const size_t ROLLUP_QUARTER_BUCKETS_INTERNAL = 80;
+const uint32_t HIGH_LOW_WINDOW_MS = 24 * 3600000UL;
+const unsigned long LCD2_HIGH_LOW_EVERY_CYCLES = 2;
+
+SensorSample sample;
+unsigned long cycleCount = 0;
+char deviceId[DEVICE_ID_SIZE];
+SequenceCounter sequence;
+SampleHistory history;
+SampleRollup rollup;
+
+char payloadBuffer[PAYLOAD_BUFFER_SIZE];
+char livePayloadBuffer[PAYLOAD_BUFFER_SIZE];
+char lcd1Lines[LCD1_ROWS][LCD_LINE_BUFFER];
+char lcd2Lines[LCD2_ROWS][LCD_LINE_BUFFER];
+
+char commandBuffer[160];
+size_t commandLength = 0;
 
 void setupWiFi() {
   delay(10);
-  Serial.println();
-  Serial.print("Connecting to ");
-  Serial.println(ssid);
-  Serial.print("ESP32 MAC Address: ");
-  Serial.println(WiFi.macAddress());
-  lcd2.clear();
-  lcd2.setCursor(0,0);
-  lcd2.print("Connecting WiFi...");
-
-  WiFi.begin(ssid, password, 6);
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  formatDeviceId(mac, deviceId);
+  Serial.printf("Device ID: %s\n", deviceId);
+  trace(TRACE_WIFI_CONNECTING, deviceConfig.wifiChannel);
+  trace(TRACE_WIFI_MAC, (mac[0] << 8) | mac[1],
+        (int32_t)(((uint32_t)mac[2] << 24) | ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5]));
+  lcd2->clear();
+  lcd2->setCursor(0,0);
+  lcd2->print("Connecting WiFi...");
+
+  WiFi.begin(deviceConfig.wifiSsid, deviceConfig.wifiPassword, deviceConfig.wifiChannel);
 
   int retries = 0;
   while (WiFi.status() != WL_CONNECTED && retries < 30) {
     wl_status_t status = WiFi.status();
-    Serial.print(".");
-    Serial.print(status);
+    trace(TRACE_WIFI_RETRY, retries, status);
     delay(250);
     retries++;
   }
 
   if (WiFi.status() == WL_CONNECTED) {
-      Serial.println("");
-      Serial.println("WiFi connected");
-      Serial.print("IP address: ");
-      Serial.println(WiFi.localIP());
-      lcd2.setCursor(0,0);
-      lcd2.print("WiFi Connected      ");
-      lcd2.setCursor(0,1);
-      lcd2.print("IP: ");
-      lcd2.print(WiFi.localIP());
+      trace(TRACE_WIFI_CONNECTED, 0, (int32_t)(uint32_t)WiFi.localIP());
+      // Signed uploads carry the time; SNTP sets it in the background and
+      // uploads go out unsigned until it has.
+      configTime(0, 0, "pool.ntp.org", "time.google.com");
+      lcd2->setCursor(0,0);
+      lcd2->print("WiFi Connected      ");
+      lcd2->setCursor(0,1);
+      lcd2->print("IP: ");
+      lcd2->print(WiFi.localIP());
       delay(2500);
-      lcd2.setCursor(0,0);
-      lcd2.print("                    ");
-      lcd2.setCursor(0,1);
-      lcd2.print("                    ");
+      lcd2->setCursor(0,0);
+      lcd2->print("                    ");
+      lcd2->setCursor(0,1);
+      lcd2->print("                    ");
 
   } else {
-      Serial.println("");
-      Serial.println("WiFi connection failed!");
-      lcd2.setCursor(0,0);
-      lcd2.print("WiFi Failed!        ");
+      trace(TRACE_WIFI_FAILED, retries);
+      lcd2->setCursor(0,0);
+      lcd2->print("WiFi Failed!        ");
   }
 }
 
-void sendDataToBackend(String jsonData) {
-    if (WiFi.status() == WL_CONNECTED) {
-
-        WiFiClientSecure client;
-        client.setInsecure();
-
-        HTTPClient http;
-
-        Serial.print("Sending data to backend: ");
-        Serial.println(serverUrl);
-
-        http.setTimeout(10000);
-
-        http.begin(client, serverUrl);
-
-        http.addHeader("Content-Type", "application/json");
-     
-        int httpResponseCode = http.POST(jsonData);
-
-        if (httpResponseCode > 0) {
-            String response = http.getString();
-            Serial.print("HTTP Response code: ");
-            Serial.println(httpResponseCode);
-            Serial.print("Response: ");
-            Serial.println(response);
-             if (httpResponseCode != 200 && httpResponseCode != 201) {
-                 Serial.println("Note: HTTP response code was not 200 or 201.");
-             }
-        } else {
-            Serial.print("Error sending POST: ");
-            Serial.println(httpResponseCode);
-            Serial.printf("HTTP POST failed, error: %s\n", http.errorToString(httpResponseCode).c_str());
-        }
-
-        http.end();
-    } else {
-        Serial.println("WiFi not connected. Cannot send data.");
-
-    }
+void setupHistory() {
+  size_t capacity = HISTORY_CAPACITY_PSRAM;
+  HistoryRecord* records = nullptr;
+  if (psramFound()) {
+    records = (HistoryRecord*)heap_caps_malloc(HISTORY_CHANNELS * capacity * sizeof(HistoryRecord), MALLOC_CAP_SPIRAM);
+  }
+  if (!records) {
+    capacity = HISTORY_CAPACITY_INTERNAL;
+    records = (HistoryRecord*)heap_caps_malloc(HISTORY_CHANNELS * capacity * sizeof(HistoryRecord),
+                                               MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  uint32_t* index = (uint32_t*)heap_caps_malloc(HISTORY_CHANNELS * historyIndexSize(capacity) * sizeof(uint32_t),
+                                                MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  historyBegin(history, records, index, capacity);
+
+  size_t rollupCapacity[ROLLUP_LEVELS] = {ROLLUP_MINUTE_BUCKETS, ROLLUP_QUARTER_BUCKETS_PSRAM};
+  RollupBucket* rollupStorage[ROLLUP_LEVELS] = {nullptr, nullptr};
+  rollupStorage[0] = (RollupBucket*)heap_caps_malloc(HISTORY_CHANNELS * rollupCapacity[0] * sizeof(RollupBucket),
+                                                     MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (psramFound()) {
+    rollupStorage[1] = (RollupBucket*)heap_caps_malloc(HISTORY_CHANNELS * rollupCapacity[1] * sizeof(RollupBucket),
+                                                       MALLOC_CAP_SPIRAM);
+  }
+  if (!rollupStorage[1]) {
+    rollupCapacity[1] = ROLLUP_QUARTER_BUCKETS_INTERNAL;
+    rollupStorage[1] = (RollupBucket*)heap_caps_malloc(HISTORY_CHANNELS * rollupCapacity[1] * sizeof(RollupBucket),
+                                                       MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  rollupBegin(rollup, rollupStorage, rollupCapacity);
+  historyAttachRollup(history, &rollup);
+  Serial.printf("History: %u samples per channel, then %u x 1 min and %u x 15 min\n", (unsigned)history.capacity,
+                (unsigned)rollup.capacity[0], (unsigned)rollup.capacity[1]);
 }
 
 void setup() {
   Serial.begin(115200);
   Serial.println("Multi-Zone Environmental Monitor Initializing...");
+  trace(TRACE_BOOT);
+  heapMonitorBegin();
 
-  Wire.begin();
+  static const char* const SOURCE_NAMES[] = {"defaults", "stored", "migrated", "rejected, using defaults"};
+  Serial.printf("Configuration: %s\n", SOURCE_NAMES[configLoad()]);
 
-  lcd1.init();
-  lcd1.backlight();
-  lcd1.print("Initializing Z1");
+  Wire.begin();
+  lcd1 = new LiquidCrystal_I2C(deviceConfig.lcd1Address, 16, 2);
+  lcd2 = new LiquidCrystal_I2C(deviceConfig.lcd2Address, 20, 4);
 
-  lcd2.init();
-  lcd2.backlight();
-  lcd2.setCursor(0,0);
-  lcd2.print("Initializing Sys...");
+  lcd1->init();
+  lcd1->backlight();
+  lcd1->print("Initializing Z1");
 
-  pinMode(GREEN_LED_PIN, OUTPUT);
-  pinMode(YELLOW_LED_PIN, OUTPUT);
-  pinMode(RED_LED_PIN, OUTPUT);
-  pinMode(BUZZER_PIN, OUTPUT);
-  pinMode(FAN_LED_PIN, OUTPUT);
+  lcd2->init();
+  lcd2->backlight();
+  lcd2->setCursor(0,0);
+  lcd2->print("Initializing Sys...");
 
-  digitalWrite(GREEN_LED_PIN, HIGH);
-  digitalWrite(YELLOW_LED_PIN, LOW);
-  digitalWrite(RED_LED_PIN, LOW);
-  digitalWrite(BUZZER_PIN, LOW);
-  digitalWrite(FAN_LED_PIN, LOW);
+  setupIndicators();
+  setupHistory();
 
   setupWiFi();
+  liveStreamBegin(&history);
+  heapMonitorWatchTask("tiT");
+  heapMonitorWatchTask("wifi");
 
-  dht.setup(DHT_PIN_Z2, DHTesp::DHT22);
+  halArduinoBegin(deviceId);
   Serial.println("DHT22 Initialized");
+  sequenceBegin(sequence);
 
   delay(1000);
-  lcd1.clear(); 
+  lcd1->clear(); 
 }
 
-void loop() {
-  unsigned long loopStartTime = millis();
+void traceNtcFault() {
+  switch (sample.ntcStatus) {
+    case NTC_OK: break;
+    case NTC_INVALID_ADC: trace(TRACE_NTC_INVALID_ADC, deviceConfig.tempPinZ1, sample.ntcRaw); break;
+    case NTC_TERM1_INVALID: traceFloat(TRACE_NTC_TERM1_INVALID, deviceConfig.tempPinZ1, sample.ntcDetail); break;
+    case NTC_TERM4_ZERO: traceFloat(TRACE_NTC_TERM4_ZERO, deviceConfig.tempPinZ1, sample.ntcDetail); break;
+    case NTC_NOT_FINITE: traceFloat(TRACE_NTC_NOT_FINITE, deviceConfig.tempPinZ1, sample.ntcDetail); break;
+  }
+}
 
-  float temperatureCZ1 = readNtcTemperature(TEMP_PIN_Z1);
-  float luxZ1 = readLdrLux(LIGHT_PIN_Z1);
-  TempAndHumidity newValues = dht.getTempAndHumidity();
-  if (dht.getStatus() == DHTesp::ERROR_NONE) {
-    temperatureCZ2 = newValues.temperature;
-    humidityZ2 = newValues.humidity;
-  } else {
-    Serial.print("Error reading DHT22: ");
-    Serial.println(dht.getStatusString());
-    if (temperatureCZ2 == -999.0) temperatureCZ2 = -998.0;
-    if (humidityZ2 == -999.0) humidityZ2 = -998.0;
+void readSensors() {
+  profileBegin(PHASE_ADC);
+  sampleAnalogZone(sample);
+  profileEnd(PHASE_ADC);
+  traceNtcFault();
+
+  profileBegin(PHASE_DHT);
+  sampleClimateZone(sample);
+  profileEnd(PHASE_DHT);
+  if (!sample.climateOk) {
+    trace(TRACE_DHT_ERROR, deviceConfig.dhtPinZ2, sample.climateStatus);
   }
+}
+
+void updateAlerts() {
+  profileBegin(PHASE_ALERTS);
+  evaluateAlerts(sample);
+  profileEnd(PHASE_ALERTS);
+}
 
-  zone1_alert = false;
-  zone2_alert = false;
-  high_temp_alert = false;
+// Only uplink payloads carry a sequence number; live stream frames pass none.
+size_t buildJsonPayload(char* buffer, size_t capacity, bool includeDiagnostics = false, const uint32_t* seq = nullptr) {
+   profileBegin(PHASE_JSON);
+   JsonWriter json(buffer, capacity);
+   beginPayload(json, sample);
+   if (seq) appendIdentity(json, deviceId, *seq);
+   if (includeDiagnostics) {
+     profileAppendJson(json);
+     heapMonitorAppendJson(json);
+   }
+   endPayload(json);
+   profileEnd(PHASE_JSON);
+   return json.ok() ? json.length() : 0;
+}
 
-  bool z1_temp_alert = (temperatureCZ1 != -999.0 && temperatureCZ1 > TEMP_HIGH_THRESHOLD);
-  bool z1_lux_alert = (luxZ1 != -1.0 && luxZ1 < LIGHT_LOW_THRESHOLD && luxZ1 != 0.0);
-  if (z1_temp_alert || z1_lux_alert) {
-    zone1_alert = true;
+void renderLcd1() {
+  profileBegin(PHASE_LCD1);
+  formatLcd1(sample, lcd1Lines);
+  lcd1->clear();
+  for (int row = 0; row < LCD1_ROWS; row++) {
+    lcd1->setCursor(0, row);
+    lcd1->print(lcd1Lines[row]);
   }
+  profileEnd(PHASE_LCD1);
+}
 
-  bool z2_temp_alert = (temperatureCZ2 != -999.0 && temperatureCZ2 != -998.0 && temperatureCZ2 > TEMP_HIGH_THRESHOLD);
-  bool z2_humidity_alert = (humidityZ2 != -999.0 && humidityZ2 != -998.0 && humidityZ2 > HUMIDITY_HIGH_THRESHOLD);
-  if (z2_temp_alert || z2_humidity_alert) {
-    zone2_alert = true;
+// Every other cycle the two zone rows show the 24 h temperature range.
+void renderLcd2() {
+  profileBegin(PHASE_LCD2);
+  formatLcd2(sample, WiFi.status() == WL_CONNECTED, lcd2Lines);
+  if (cycleCount % LCD2_HIGH_LOW_EVERY_CYCLES == 1) {
+    uint32_t now = millis();
+    formatHighLowLine(historyWindowStats(history, HISTORY_TEMP_Z1, now, HIGH_LOW_WINDOW_MS), 1, "24h", lcd2Lines[1]);
+    formatHighLowLine(historyWindowStats(history, HISTORY_TEMP_Z2, now, HIGH_LOW_WINDOW_MS), 2, "24h", lcd2Lines[2]);
   }
+  lcd2->clear();
+  for (int row = 0; row < LCD2_ROWS; row++) {
+    lcd2->setCursor(0, row);
+    lcd2->print(lcd2Lines[row]);
+  }
+  profileEnd(PHASE_LCD2);
+}
 
-  if (z1_temp_alert || z2_temp_alert) {
-    high_temp_alert = true;
+// "key <64 hex digits>": this device's signing key, as printed by the
+// provisioning command in the README. The key itself is never echoed.
+void handleKeyCommand(const char* hex) {
+  uint8_t key[32];
+  bool valid = strlen(hex) == 2 * sizeof(key);
+  for (size_t i = 0; valid && i < sizeof(key); i++) {
+    char pair[3] = {hex[2 * i], hex[2 * i + 1], '\0'};
+    char* end;
+    key[i] = (uint8_t)strtoul(pair, &end, 16);
+    valid = end == pair + 2;
   }
+  if (!valid) {
+    Serial.println("Usage: key <64 hex digits>");
+  } else if (halSetSigningKey(key, sizeof(key))) {
+    Serial.println("Signing key stored");
+  } else {
+    Serial.println("Could not store signing key");
+  }
+  memset(key, 0, sizeof(key));
+}
 
-  bool yellowState = zone1_alert;
-  bool redState = zone2_alert;
-  bool greenState = !(zone1_alert || zone2_alert);
+// Stored samples per channel, their last hour and the last 24 h.
+void printHistory() {
+  uint32_t now = millis();
+  Serial.printf("History: %u samples per channel, then %u x 1 min and %u x 15 min\n", (unsigned)history.capacity,
+                (unsigned)rollup.capacity[0], (unsigned)rollup.capacity[1]);
+  for (int c = 0; c < HISTORY_CHANNELS; c++) {
+    HistoryChannel channel = (HistoryChannel)c;
+    HistoryStats hour = historyStats(channel, historyLast(history, channel, now, HISTORY_SUMMARY_MS));
+    HistoryStats day = historyWindowStats(history, channel, now, HIGH_LOW_WINDOW_MS);
+    int decimals = HISTORY_CHANNEL_INFO[c].decimals;
+    Serial.printf("  %-12s %4u stored; last hour %4u, min %.*f max %.*f mean %.*f, %u in alert; "
+                  "24 h %5u, low %.*f high %.*f\n",
+                  HISTORY_CHANNEL_INFO[c].name, (unsigned)history.rings[c].count, (unsigned)hour.count,
+                  decimals, hour.min, decimals, hour.max, decimals + 1, hour.mean, (unsigned)hour.alerts,
+                  (unsigned)day.count, decimals, day.min, decimals, day.max);
+  }
+}
 
-  digitalWrite(YELLOW_LED_PIN, yellowState);
-  digitalWrite(RED_LED_PIN, redState);
-  digitalWrite(GREEN_LED_PIN, greenState);
+// Every field as "key = value"; a stored change to a boot-only field shows
+// the running value and the one the next boot will use.
+void printConfig() {
+  const DeviceConfig& stored = configStored();
+  char value[160];
+  char next[160];
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+    const ConfigField& field = CONFIG_FIELDS[i];
+    configFormatField(deviceConfig, field, value, sizeof(value));
+    configFormatField(stored, field, next, sizeof(next));
+    bool pending = memcmp((const uint8_t*)&deviceConfig + field.offset, (const uint8_t*)&stored + field.offset,
+                          field.size) != 0;
+    if (pending) {
+      Serial.printf("  %-18s = %s (%s after restart)\n", field.key, value, next);
+    } else {
+      Serial.printf("  %-18s = %s\n", field.key, value);
+    }
+  }
+}
 
-  int buzzerDelay = 0;
-  if (zone1_alert || zone2_alert) {
-    digitalWrite(BUZZER_PIN, HIGH);
-    delay(100);
-    digitalWrite(BUZZER_PIN, LOW);
-    buzzerDelay = 100;
-  } else {
-    digitalWrite(BUZZER_PIN, LOW);
+void reportConfigUpdate(ConfigUpdate result) {
+  switch (result) {
+    case CONFIG_APPLIED: Serial.println("Configuration stored and applied"); break;
+    case CONFIG_PENDING_RESTART: Serial.println("Configuration stored; restart to apply"); break;
+    case CONFIG_INVALID: Serial.println("Configuration not stored: invalid values"); break;
+    case CONFIG_STORE_FAILED: Serial.println("Could not store configuration"); break;
   }
+}
 
-  digitalWrite(FAN_LED_PIN, high_temp_alert);
-
-  lcd1.clear();
-  lcd1.setCursor(0, 0);
-  lcd1.print("Z1:");
-  if (temperatureCZ1 == -999.0) lcd1.print("ERR"); else lcd1.print(temperatureCZ1, 1);
-  lcd1.print("C ");
-  if (luxZ1 == -1.0) lcd1.print("DARK"); else if (luxZ1 == 0.0) lcd1.print(">BRT"); else lcd1.print((int)luxZ1);
-  lcd1.print("lx");
-  if (zone1_alert) lcd1.print("!");
-
-  lcd1.setCursor(0, 1);
-  lcd1.print("Z2:");
-  if (temperatureCZ2 <= -998.0) lcd1.print("ERR"); else lcd1.print(temperatureCZ2, 1);
-  lcd1.print("C ");
-  if (humidityZ2 <= -998.0) lcd1.print("H:ERR"); else { lcd1.print("H:"); lcd1.print((int)humidityZ2); lcd1.print("%"); }
-  if (zone2_alert) lcd1.print("!");
-
-  lcd2.clear();
-  lcd2.setCursor(0, 0);
-  if (zone1_alert || zone2_alert) {
-      lcd2.print("SYSTEM ALERT ACTIVE!");
-  } else {
-      lcd2.print("System Status: OK");
+// "config set <key> <value>": the value is the rest of the line, so Wi-Fi
+// names and passwords may contain spaces.
+void handleConfigSet(const char* args) {
+  const char* space = strchr(args, ' ');
+  char key[24];
+  size_t keyLength = space ? (size_t)(space - args) : 0;
+  if (keyLength == 0 || keyLength >= sizeof(key)) {
+    Serial.println("Usage: config set <key> <value>");
+    return;
+  }
+  memcpy(key, args, keyLength);
+  key[keyLength] = '\0';
+  const ConfigField* field = configFindField(key);
+  if (!field) {
+    Serial.printf("Unknown configuration key: %s\n", key);
+    return;
   }
+  DeviceConfig next = configStored();
+  if (!configParseField(next, *field, space + 1)) {
+    Serial.printf("Invalid value for %s\n", key);
+    return;
+  }
+  const char* invalid = configValidate(next);
+  if (invalid) {
+    Serial.printf("Not stored: %s out of range with this change\n", invalid);
+    return;
+  }
+  reportConfigUpdate(configUpdate(next));
+}
+
+void handleCommand(const char* command) {
+  if (strcmp(command, "prof") == 0) {
+    profilePrint(Serial);
+  } else if (strcmp(command, "prof reset") == 0) {
+    profileReset();
+    Serial.println("Profiler reset");
+  } else if (strcmp(command, "heap") == 0) {
+    heapMonitorPrint(Serial);
+  } else if (strcmp(command, "trace") == 0) {
+    traceDump(Serial);
+  } else if (strcmp(command, "trace clear") == 0) {
+    traceClear();
+    Serial.println("Trace cleared");
+  } else if (strcmp(command, "history") == 0) {
+    printHistory();
+  } else if (strcmp(command, "key") == 0) {
+    Serial.printf("Signing key: %s\n", halHasSigningKey() ? "set" : "not set");
+  } else if (strncmp(command, "key ", 4) == 0) {
+    handleKeyCommand(command + 4);
+  } else if (strcmp(command, "config") == 0) {
+    printConfig();
+  } else if (strncmp(command, "config set ", 11) == 0) {
+    handleConfigSet(command + 11);
+  } else if (strcmp(command, "config reset") == 0) {
+    DeviceConfig defaults;
+    configDefaults(defaults);
+    reportConfigUpdate(configUpdate(defaults));
+  } else if (command[0] != '\0') {
+    Serial.printf("Unknown command: %s (try: prof, prof reset, heap, trace, trace clear, history, key, config)\n",
+                  command);
+  }
+}
 
-  lcd2.setCursor(0, 1);
-  lcd2.print("Z1: ");
-  if (temperatureCZ1 == -999.0) lcd2.print("T:ERR "); else { lcd2.print("T:"); lcd2.print(temperatureCZ1, 1); lcd2.print("C "); }
-  if (luxZ1 == -1.0) lcd2.print("L:DARK"); else if (luxZ1 == 0.0) lcd2.print("L:>BRT"); else { lcd2.print("L:"); lcd2.print((int)luxZ1); lcd2.print("lx"); }
-  if (zone1_alert) lcd2.print(" !");
-
-  lcd2.setCursor(0, 2);
-  lcd2.print("Z2: ");
-  if (temperatureCZ2 <= -998.0) lcd2.print("T:ERR "); else { lcd2.print("T:"); lcd2.print(temperatureCZ2, 1); lcd2.print("C "); }
-  if (humidityZ2 <= -998.0) lcd2.print("H:ERR"); else { lcd2.print("H:"); lcd2.print((int)humidityZ2); lcd2.print("%"); }
-  if (zone2_alert) lcd2.print(" !");
-
-  lcd2.setCursor(0, 3);
-  lcd2.print("Fan Status: ");
-  lcd2.print(high_temp_alert ? "ON" : "OFF");
-  if (WiFi.status() != WL_CONNECTED) {
-      lcd2.setCursor(18, 3);
-      lcd2.print("WF!");
+void serviceSerialCommands() {
+  while (Serial.available() > 0) {
+    char c = (char)Serial.read();
+    if (c == '\r' || c == '\n') {
+      commandBuffer[commandLength] = '\0';
+      handleCommand(commandBuffer);
+      commandLength = 0;
+    } else if (commandLength < sizeof(commandBuffer) - 1) {
+      commandBuffer[commandLength++] = c;
+    }
+  }
+}
+
+// Waits out the rest of the cycle while keeping the live stream responsive.
+// Intermediate samples are only taken while someone is subscribed; the DHT22
+// cannot be polled faster than every 2 s, which bounds the live rate.
+void serviceUntil(unsigned long deadline) {
+  unsigned long lastLiveSample = millis();
+  while ((long)(deadline - millis()) > 0) {
+    liveStreamService();
+    serviceSerialCommands();
+    if (liveStreamClientCount() > 0 && millis() - lastLiveSample >= LIVE_SAMPLE_INTERVAL_MS) {
+      lastLiveSample = millis();
+      readSensors();
+      updateAlerts();
+      size_t length = buildJsonPayload(livePayloadBuffer, sizeof(livePayloadBuffer));
+      if (length > 0) liveStreamPublish(livePayloadBuffer, length);
+    }
+    long remaining = (long)(deadline - millis());
+    if (remaining > 0) delay(remaining < (long)SERVICE_POLL_MS ? remaining : SERVICE_POLL_MS);
   }
+}
+
+void loop() {
+  unsigned long loopStartTime = millis();
+  heapMonitorCycleStart();
+
+  readSensors();
+  updateAlerts();
+  historyAppendSample(history, sample, millis());
+
+  uint32_t buzzerDelay = driveIndicators(sample);
+
+  renderLcd1();
+  renderLcd2();
+
+   heapMonitorUplinkStart();
+   cycleCount++;
+   bool reportDiagnostics = (cycleCount % PROFILE_REPORT_EVERY_CYCLES == 0);
+   uint32_t seq = sequenceNext(sequence);
+   size_t length = buildJsonPayload(payloadBuffer, sizeof(payloadBuffer), reportDiagnostics, &seq);
+   trace(TRACE_PAYLOAD_BUILT, 0, length);
+
+   if (reportDiagnostics) {
+     size_t liveLength = buildJsonPayload(livePayloadBuffer, sizeof(livePayloadBuffer));
+     if (liveLength > 0) liveStreamPublish(livePayloadBuffer, liveLength);
+   } else if (length > 0) {
+     liveStreamPublish(payloadBuffer, length);
+   }
+   if (length > 0) halHttpPost(payloadBuffer, length);
+   heapMonitorUplinkEnd();
 
-   String jsonData = "{";
-   jsonData += "\"zone1\":{";
-   jsonData += "\"tempC\":";
-   if (temperatureCZ1 == -999.0) jsonData += "null"; else jsonData += String(temperatureCZ1, 1);
-   jsonData += ",\"lux\":";
-   if (luxZ1 == -1.0) jsonData += "\"DARK\""; else if (luxZ1 == 0.0) jsonData += "\"BRIGHT\""; else jsonData += String((int)luxZ1);
-   jsonData += ",\"alert\":";
-   jsonData += zone1_alert ? "true" : "false";
-   jsonData += "},";
-   jsonData += "\"zone2\":{\"dhtTempC\":";
-   if (temperatureCZ2 <= -998.0) jsonData += "null"; else jsonData += String(temperatureCZ2, 1);
-   jsonData += ",\"humidity\":";
-   if (humidityZ2 <= -998.0) jsonData += "null"; else jsonData += String(humidityZ2, 1);
-   jsonData += ",\"alert\":";
-   jsonData += zone2_alert ? "true" : "false";
-   jsonData += "},";
-   jsonData += "\"fan_on\":";
-   jsonData += high_temp_alert ? "true" : "false";
-   jsonData += "}";
-
-   Serial.println(jsonData);
-
-   sendDataToBackend(jsonData);
-
-   unsigned long loopEndTime = millis();
-   long loopDuration = loopEndTime - loopStartTime;
-   long delayTime = 30000 - loopDuration - buzzerDelay;
-
-   if (delayTime < 0) {
-       delayTime = 100;
-       Serial.println("Warning: Loop duration exceeded target interval!");
+   CycleDelay next = cycleDelay(loopStartTime, millis(), buzzerDelay, deviceConfig.cycleIntervalMs);
+   if (next.overrun) {
+       trace(TRACE_CYCLE_OVERRUN, 0, millis() - loopStartTime);
    }
 
-   delay(delayTime);
+   serviceUntil(millis() + next.delayMs);
+   // The live stream and serial console run in the service window, so their
+   // allocations count towards the cycle too.
+   heapMonitorCycleEnd();
 }
@@ -0,0 +1,46 @@
+#include "trace_buffer.h"
+
+static TraceRecord records[TRACE_CAPACITY];
+static uint32_t written = 0;
+
+void trace(TraceEvent event, uint16_t aux, int32_t arg) {
+  TraceRecord& r = records[written % TRACE_CAPACITY];
+  r.timestampUs = micros();
+  r.event = event;
+  r.aux = aux;
+  r.arg = arg;
+  written++;
+}
+
+void traceFloat(TraceEvent event, uint16_t aux, float value) {
+  int32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  trace(event, aux, bits);
+}
+
+void traceClear() {
+  written = 0;
+}
+
+// Hex keeps the dump intact through the serial monitor; the decoder skips
+// any surrounding log lines, so a whole captured session can be fed to it.
+void traceDump(Print& out) {
+  uint32_t count = written < TRACE_CAPACITY ? written : TRACE_CAPACITY;
+  uint32_t first = written - count;
+
+  out.printf("#TRACE v%u records=%lu overwritten=%lu cpu_mhz=%lu\n", TRACE_FORMAT_VERSION,
+             (unsigned long)count, (unsigned long)first, (unsigned long)ESP.getCpuFreqMHz());
+
+  char line[sizeof(TraceRecord) * 2 + 1];
+  for (uint32_t i = first; i < written; i++) {
+    const uint8_t* bytes = (const uint8_t*)&records[i % TRACE_CAPACITY];
+    for (size_t b = 0; b < sizeof(TraceRecord); b++) {
+      static const char HEX_DIGITS[] = "0123456789abcdef";
+      line[b * 2] = HEX_DIGITS[bytes[b] >> 4];
+      line[b * 2 + 1] = HEX_DIGITS[bytes[b] & 0x0F];
+    }
+    line[sizeof(line) - 1] = '\0';
+    out.println(line);
+  }
+  out.println("#END");
+}
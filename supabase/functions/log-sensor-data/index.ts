@@ -1,9 +1,187 @@
 import { createClient } from 'https://esm.sh/@supabase/supabase-js@2'
 import { serve } from 'https://deno.land/std@0.177.0/http/server.ts'
 
-const NTFY_TOPIC_URL = "https://ntfy.sh/h1VF9Rm48A4LmvAb"
-const NTFY_ACCESS_TOKEN = "tk_zedxf4l8nuqhcpbwlo5wd661n2pb0"
-const SEND_NOTIFICATIONS = true
+// Pushes follow alert transitions per (device, zone) instead of every
+// alerting reading; the state is kept by note_alert_states() in the database
+// (supabase/migrations). A zone's raise/clear pushes are at least the
+// cooldown apart, and a zone that stays in alert is repeated hourly. Due
+// pushes are queued in notification_outbox and sent by notify-drain, so
+// this function never waits on ntfy.
+const ALERT_COOLDOWN_S = 10 * 60
+const ALERT_REPEAT_S = 60 * 60
+
+// Zones this isolate has seen settled (out of alert, nothing pending). A
+// quiet reading for such a zone skips the state call; entries expire so a
+// change recorded by another isolate is picked up within a few minutes.
+const QUIET_ZONE_TTL_MS = 5 * 60 * 1000
+const quietZones = new Map<string, number>()
+
+// Supabase's background-task hook; the state call runs after the response is sent.
+declare const EdgeRuntime: { waitUntil(promise: Promise<unknown>): void } | undefined
+
+// Batch uploads: {"device": "...", "readings": [{"ts": ..., "zone1": ..., ...}, ...]}
+// or a bare array of readings. Each reading may carry its own "device".
+const MAX_BATCH_ROWS = 500
+const MAX_CLOCK_SKEW_MS = 5 * 60 * 1000
+// As long as sensor_log_seqs remembers a (device, seq); sensor_series()
+// relies on it to bound the partitions its raw path scans.
+const MAX_READING_AGE_MS = 7 * 24 * 60 * 60 * 1000
+
+// Signed uploads carry
+//
+//   X-Device-Id: esp32-...
+//   X-Signature: t=<unix seconds>,n=<hex nonce>,v1=<hex HMAC-SHA256>
+//
+// where the MAC is over `${t}.${n}.` followed by the body bytes, keyed with
+// the device's key: HMAC-SHA256(INGEST_SIGNING_KEY, device id), so keys are
+// derived here instead of looked up. t must be within the window of the
+// server clock and a nonce is refused the second time this isolate sees it;
+// a replay that reaches another isolate inside the window is still dropped
+// by the (device_id, seq) dedup. With INGEST_REQUIRE_SIGNATURE=true unsigned
+// uploads are refused; until then they are accepted as before.
+const SIGNATURE_WINDOW_S = 5 * 60
+const MAX_CACHED_KEYS = 10000
+const MAX_SEEN_NONCES = 100000
+const deviceKeys = new Map<string, CryptoKey>()
+const seenNonces = new Map<string, number>()
+let masterKey: CryptoKey | null = null
+const textEncoder = new TextEncoder()
+
+// The client and the config it was built from live at module scope, so warm
+// invocations in the same isolate skip the env lookups and createClient().
+// Built on first use; dropped after a transport-level failure so the next
+// request starts from a fresh client.
+let supabaseClient: any = null
+
+function getSupabaseClient() {
+  if (supabaseClient) return supabaseClient
+
+  const supabaseUrl = Deno.env.get('MY_SUPABASE_URL')
+  const supabaseServiceKey = Deno.env.get('MY_SUPABASE_SERVICE_KEY')
+  if (!supabaseUrl || !supabaseServiceKey) {
+    // Not cached, so fixing the secrets takes effect without a redeploy.
+    return null
+  }
+  supabaseClient = createClient(supabaseUrl, supabaseServiceKey, {
+    auth: { persistSession: false, autoRefreshToken: false, detectSessionInUrl: false }
+  })
+  return supabaseClient
+}
+
+export function resetSupabaseClient() {
+  supabaseClient = null
+}
+
+// Postgres and PostgREST errors carry a code; a failed fetch (DNS, reset
+// connection, timeout) comes back from supabase-js without one.
+function checkClientHealth(dbError: any) {
+  if (!dbError?.code) {
+    console.error('Supabase request failed without a status; recreating the client')
+    resetSupabaseClient()
+  }
+}
+
+function hexBytes(hex: string): Uint8Array | null {
+  if (hex.length % 2 !== 0 || !/^[0-9a-fA-F]*$/.test(hex)) return null
+  const bytes = new Uint8Array(hex.length / 2)
+  for (let i = 0; i < bytes.length; i++) bytes[i] = parseInt(hex.slice(i * 2, i * 2 + 2), 16)
+  return bytes
+}
+
+// Compares every byte whatever the first difference, so the time taken says
+// nothing about how much of a forged MAC was right.
+function timingSafeEqual(a: Uint8Array, b: Uint8Array): boolean {
+  if (a.length !== b.length) return false
+  let diff = 0
+  for (let i = 0; i < a.length; i++) diff |= a[i] ^ b[i]
+  return diff === 0
+}
+
+async function hmacKey(raw: Uint8Array, usage: string): Promise<CryptoKey> {
+  return await crypto.subtle.importKey('raw', raw, { name: 'HMAC', hash: 'SHA-256' }, false, [usage])
+}
+
+// Null when INGEST_SIGNING_KEY is unset; like the client config it is not
+// cached until it is there.
+async function getDeviceKey(device: string): Promise<CryptoKey | null> {
+  const cached = deviceKeys.get(device)
+  if (cached) return cached
+  if (!masterKey) {
+    const master = hexBytes(Deno.env.get('INGEST_SIGNING_KEY') ?? '')
+    if (!master || master.length < 16) return null
+    masterKey = await hmacKey(master, 'sign')
+  }
+  const derived = await crypto.subtle.sign('HMAC', masterKey, textEncoder.encode(device))
+  const key = await hmacKey(new Uint8Array(derived), 'sign')
+  if (deviceKeys.size >= MAX_CACHED_KEYS) deviceKeys.clear()
+  deviceKeys.set(device, key)
+  return key
+}
+
+// First sighting of a nonce within the window. Expired entries are swept
+// when the map fills up.
+function freshNonce(device: string, nonce: string, nowS: number): boolean {
+  const key = `${device}/${nonce}`
+  if ((seenNonces.get(key) ?? 0) > nowS) return false
+  if (seenNonces.size >= MAX_SEEN_NONCES) {
+    for (const [k, expiry] of seenNonces) if (expiry <= nowS) seenNonces.delete(k)
+    if (seenNonces.size >= MAX_SEEN_NONCES) seenNonces.clear()
+  }
+  seenNonces.set(key, nowS + 2 * SIGNATURE_WINDOW_S)
+  return true
+}
+
+// The signing device's id, null for an accepted unsigned upload, or the
+// response refusing the request.
+async function verifySignature(req: Request, body: Uint8Array): Promise<{ device: string | null } | Response> {
+  const header = req.headers.get('x-signature')
+  const device = req.headers.get('x-device-id')
+  if (header === null) {
+    if (Deno.env.get('INGEST_REQUIRE_SIGNATURE') === 'true') return jsonResponse({ error: 'Signature required' }, 401)
+    return { device: null }
+  }
+  const fields = new Map<string, string>()
+  for (const part of header.split(',')) {
+    const eq = part.indexOf('=')
+    if (eq > 0) fields.set(part.slice(0, eq).trim(), part.slice(eq + 1).trim())
+  }
+  const t = fields.get('t') ?? ''
+  const nonce = fields.get('n') ?? ''
+  const mac = hexBytes(fields.get('v1') ?? '')
+  if (!device || !/^\d{1,12}$/.test(t) || !/^[0-9a-f]{16,64}$/.test(nonce) || !mac || mac.length !== 32) {
+    return jsonResponse({ error: 'Malformed signature' }, 401)
+  }
+  const nowS = Math.floor(Date.now() / 1000)
+  if (Math.abs(nowS - Number(t)) > SIGNATURE_WINDOW_S) {
+    return jsonResponse({ error: 'Signature expired' }, 401)
+  }
+
+  const key = await getDeviceKey(device)
+  if (!key) {
+    console.error('Signed upload but INGEST_SIGNING_KEY is not set')
+    return jsonResponse({ error: 'Internal configuration error' }, 500)
+  }
+  const prefix = textEncoder.encode(`${t}.${nonce}.`)
+  const message = new Uint8Array(prefix.length + body.length)
+  message.set(prefix)
+  message.set(body, prefix.length)
+  const expected = new Uint8Array(await crypto.subtle.sign('HMAC', key, message))
+  if (!timingSafeEqual(expected, mac)) {
+    return jsonResponse({ error: 'Invalid signature' }, 401)
+  }
+  if (!freshNonce(device, nonce, nowS)) {
+    return jsonResponse({ error: 'Replayed request' }, 401)
+  }
+  return { device }
+}
+
+// A signed upload may only carry readings for the device that signed it.
+function namesOtherDevice(data: any, signer: string): boolean {
+  const names = (value: any) => value != null && String(value) !== signer
+  if (Array.isArray(data)) return data.some((reading) => names(reading?.device))
+  if (names(data?.device)) return true
+  return Array.isArray(data?.readings) && data.readings.some((reading: any) => names(reading?.device))
+}
 
 function parseSensorValue(value: any): number | null {
   if (typeof value === 'number' && isFinite(value)) {
@@ -12,36 +190,195 @@ function parseSensorValue(value: any): number | null {
   return null
 }
 
-async function sendNtfyNotification(title: string, message: string, priority: number = 4) {
-  if (!SEND_NOTIFICATIONS || !NTFY_TOPIC_URL.includes('/') || !NTFY_ACCESS_TOKEN) {
-      console.log("Notifications disabled, topic URL invalid, or access token missing.")
-      return
+// Readings carry the device's sequence number; the database drops a
+// (device_id, seq) pair it has already stored, so retries are idempotent.
+function parseSeq(value: any): number | null {
+  return Number.isSafeInteger(value) && value >= 0 ? value : null
+}
+
+// Lux is numeric; at either end of the LDR's range it is null and the state
+// says which end. Firmware from before "luxState" sent the strings "DARK"
+// and "BRIGHT" in place of the number.
+function parseLux(zone: any): { lux: number | null, state: string | null } {
+  if (zone.luxState === 'dark' || zone.luxState === 'bright') {
+    return { lux: null, state: zone.luxState }
   }
-  console.log(`Sending notification: ${title} - ${message}`)
-  try {
-    const response = await fetch(NTFY_TOPIC_URL, {
-      method: 'POST',
-      headers: {
-        'Title': title,
-        'Priority': String(priority),
-        'Tags': 'warning,thermometer,droplet',
-        'Authorization': `Bearer ${NTFY_ACCESS_TOKEN}`
-      },
-      body: message
-    })
-    if (!response.ok) {
-      console.error(`ntfy notification failed: ${response.status} ${response.statusText}`)
-      const errorBody = await response.text()
-      console.error(`ntfy error body: ${errorBody}`)
-    } else {
-        console.log("ntfy notification sent successfully.")
+  if (zone.lux === 'DARK') return { lux: null, state: 'dark' }
+  if (zone.lux === 'BRIGHT') return { lux: null, state: 'bright' }
+  const lux = parseSensorValue(zone.lux)
+  return { lux, state: lux === null ? null : 'ok' }
+}
+
+function buildLogEntry(data: any) {
+  const z1_data = data.zone1 || {}
+  const z2_data = data.zone2 || {}
+  const z1_lux = parseLux(z1_data)
+
+  return {
+    z1_temp: parseSensorValue(z1_data.tempC),
+    z1_lux: z1_lux.lux,
+    z1_lux_state: z1_lux.state,
+    z1_alert: Boolean(z1_data.alert ?? false),
+    z2_temp: parseSensorValue(z2_data.dhtTempC),
+    z2_humidity: parseSensorValue(z2_data.humidity),
+    z2_alert: Boolean(z2_data.alert ?? false),
+    fan_on: Boolean(data.fan_on ?? false),
+    seq: parseSeq(data.seq)
+  }
+}
+
+// Epoch milliseconds (seconds are accepted too) or an ISO-8601 string, not
+// more than the allowed skew ahead of the server clock nor older than
+// MAX_READING_AGE_MS.
+function parseReadingTime(value: any, nowMs: number): { iso?: string, error?: string } {
+  if (value === undefined || value === null) {
+    return { iso: new Date(nowMs).toISOString() }
+  }
+  let ms = NaN
+  if (typeof value === 'number' && isFinite(value)) {
+    ms = value < 1e12 ? value * 1000 : value
+  } else if (typeof value === 'string') {
+    ms = Date.parse(value)
+  }
+  if (!isFinite(ms) || ms < 0) return { error: 'invalid ts' }
+  if (ms > nowMs + MAX_CLOCK_SKEW_MS) return { error: 'ts in the future' }
+  if (ms < nowMs - MAX_READING_AGE_MS) return { error: 'ts too old' }
+  return { iso: new Date(ms).toISOString() }
+}
+
+// The zone's values as the push message quotes them.
+function zoneReading(zone: number, entry: any) {
+  return zone === 1
+    ? { temp: entry.z1_temp, lux: entry.z1_lux, lux_state: entry.z1_lux_state }
+    : { temp: entry.z2_temp, humidity: entry.z2_humidity }
+}
+
+// entries: the newest stored row per device ('' when the request names none).
+async function recordAlertStates(supabase: any, entries: Map<string, any>) {
+  const now = Date.now()
+  const states: { device_id: string, zone: number, alerting: boolean, reading: any }[] = []
+  for (const [device, entry] of entries) {
+    for (const zone of [1, 2]) {
+      const alerting = zone === 1 ? entry.z1_alert : entry.z2_alert
+      if (!alerting && (quietZones.get(`${device}/${zone}`) ?? 0) > now) continue
+      states.push({ device_id: device, zone, alerting, reading: zoneReading(zone, entry) })
+    }
+  }
+  if (states.length === 0) return
+
+  const { data, error } = await supabase.rpc('note_alert_states', {
+    p_states: states, p_cooldown_s: ALERT_COOLDOWN_S, p_repeat_s: ALERT_REPEAT_S
+  })
+  if (error) {
+    // Without the state, queue a push for each zone in alert, stamped with
+    // the start of the current repeat interval: the outbox's unique
+    // (device_id, zone, event, created_at) then keeps one per zone and
+    // interval however many readings, and isolates, arrive meanwhile. The
+    // drain's next cron run sends them.
+    console.error('Alert state error:', error)
+    const interval = new Date(Math.floor(now / (ALERT_REPEAT_S * 1000)) * ALERT_REPEAT_S * 1000).toISOString()
+    const raised = states
+      .filter((st) => st.alerting)
+      .map((st) => ({ device_id: st.device_id, zone: st.zone, event: 'raised', reading: st.reading, created_at: interval }))
+    if (raised.length === 0) return
+    const { error: queueError } = await supabase.from('notification_outbox')
+      .upsert(raised, { onConflict: 'device_id,zone,event,created_at', ignoreDuplicates: true })
+    if (queueError) console.error('Fallback push queue error:', queueError)
+    return
+  }
+  for (const row of data ?? []) {
+    const key = `${row.device_id}/${row.zone}`
+    if (row.settled) quietZones.set(key, now + QUIET_ZONE_TTL_MS); else quietZones.delete(key)
+    if (row.event) console.log(`Queued ${row.event} push for ${row.device_id || 'device'} zone ${row.zone}`)
+  }
+}
+
+function runInBackground(task: Promise<unknown>) {
+  if (typeof EdgeRuntime !== 'undefined') {
+    EdgeRuntime.waitUntil(task)
+  } else {
+    task.catch((error) => console.error('Background task failed:', error))
+  }
+}
+
+// Devices that send "Prefer: return=minimal" only need to know the reading
+// was stored: the insert skips the RETURNING read-back and the answer is a
+// 204 with no body.
+function wantsMinimalAck(req: Request): boolean {
+  const prefer = req.headers.get('prefer') ?? ''
+  return prefer.split(',').some((p) => p.trim() === 'return=minimal')
+}
+
+function jsonResponse(body: unknown, status: number) {
+  return new Response(JSON.stringify(body), { status, headers: { 'Content-Type': 'application/json' } })
+}
+
+// Validates every reading in one pass and writes the good ones with a single
+// multi-row INSERT. Rejected rows are reported by index; the rest share one
+// statement, so they are stored together or not at all.
+async function handleBatch(supabase: any, body: any, minimal: boolean, signer: string | null) {
+  const readings: any[] = Array.isArray(body) ? body : body.readings
+  const defaultDevice = (Array.isArray(body) ? null : body.device) ?? signer
+
+  if (readings.length === 0) {
+    return jsonResponse({ error: 'Empty batch' }, 400)
+  }
+  if (readings.length > MAX_BATCH_ROWS) {
+    return jsonResponse({ error: `Batch too large (max ${MAX_BATCH_ROWS} readings)` }, 413)
+  }
+
+  const nowMs = Date.now()
+  const rows: any[] = []
+  const errors: [number, string][] = []
+  const latestByDevice = new Map<string, { ms: number, row: any }>()
+
+  readings.forEach((reading, index) => {
+    if (reading === null || typeof reading !== 'object' || Array.isArray(reading)) {
+      errors.push([index, 'not an object'])
+      return
+    }
+    const time = parseReadingTime(reading.ts, nowMs)
+    if (time.error) {
+      errors.push([index, time.error])
+      return
     }
-  } catch (error) {
-    console.error('Error sending ntfy notification:', error)
+    const device = reading.device ?? defaultDevice
+    const row = { ...buildLogEntry(reading), device_id: device === null ? null : String(device), recorded_at: time.iso }
+    rows.push(row)
+
+    const key = row.device_id ?? ''
+    const ms = Date.parse(time.iso!)
+    const latest = latestByDevice.get(key)
+    if (!latest || ms >= latest.ms) latestByDevice.set(key, { ms, row })
+  })
+
+  // Nothing to store: answered as a client error so a sender doesn't count
+  // the batch as delivered.
+  if (rows.length === 0) {
+    return jsonResponse({ error: 'No valid readings', accepted: 0, rejected: errors.length, errors }, 422)
+  }
+
+  // The count is what the database kept once duplicates were dropped.
+  const { error: dbError, count } = await supabase.from('sensor_logs').insert(rows, { count: 'exact' })
+  const duplicates = rows.length - (count ?? rows.length)
+  if (dbError) {
+    console.error('Database Batch Insert Error:', dbError)
+    checkClientHealth(dbError)
+    return jsonResponse({ error: 'Database error', details: dbError.message, accepted: 0, rejected: readings.length }, 500)
+  }
+
+  // Alert state follows each device's newest reading.
+  const newest = new Map<string, any>()
+  for (const [device, latest] of latestByDevice) newest.set(device, latest.row)
+  runInBackground(recordAlertStates(supabase, newest))
+
+  if (minimal && errors.length === 0) {
+    return new Response(null, { status: 204 })
   }
+  return jsonResponse({ status: errors.length === 0 ? 'success' : 'partial', accepted: rows.length, rejected: errors.length, duplicates, errors }, 201)
 }
 
-serve(async (req: Request) => {
+export async function handleRequest(req: Request): Promise<Response> {
   if (req.method !== 'POST') {
     return new Response(JSON.stringify({ error: 'Method Not Allowed' }), { status: 405, headers: { 'Content-Type': 'application/json' } })
   }
@@ -50,66 +387,53 @@ serve(async (req: Request) => {
   }
 
   try {
-    const data = await req.json()
-
-    const z1_data = data.zone1 || {}
-    const z2_data = data.zone2 || {}
-
-    const logEntry = {
-      z1_temp: parseSensorValue(z1_data.tempC),
-      z1_lux: String(z1_data.lux ?? ''),
-      z1_alert: Boolean(z1_data.alert ?? false),
-      z2_temp: parseSensorValue(z2_data.dhtTempC),
-      z2_humidity: parseSensorValue(z2_data.humidity),
-      z2_alert: Boolean(z2_data.alert ?? false),
-      fan_on: Boolean(data.fan_on ?? false)
+    // The signature covers the bytes as sent, so they are read before parsing.
+    const raw = new Uint8Array(await req.arrayBuffer())
+    const signature = await verifySignature(req, raw)
+    if (signature instanceof Response) return signature
+    const signer = signature.device
+
+    const data = JSON.parse(new TextDecoder().decode(raw))
+    if (signer !== null && namesOtherDevice(data, signer)) {
+      return jsonResponse({ error: 'Readings name a device other than the signer' }, 403)
     }
+    const isBatch = Array.isArray(data) || Array.isArray(data?.readings)
+    const minimal = wantsMinimalAck(req)
+    const device = data?.device == null ? signer : String(data.device)
+    const logEntry = isBatch ? null : { ...buildLogEntry(data), device_id: device }
 
-    const supabaseUrl = Deno.env.get('MY_SUPABASE_URL')
-    const supabaseServiceKey = Deno.env.get('MY_SUPABASE_SERVICE_KEY')
-    if (!supabaseUrl || !supabaseServiceKey) {
+    const supabase = getSupabaseClient()
+    if (!supabase) {
         console.error('Missing MY_SUPABASE_URL or MY_SUPABASE_SERVICE_KEY env vars')
         return new Response(JSON.stringify({ error: 'Internal configuration error' }), { status: 500, headers: { 'Content-Type': 'application/json' } })
     }
-    const supabase = createClient(supabaseUrl, supabaseServiceKey, {
-       auth: { persistSession: false, autoRefreshToken: false, detectSessionInUrl: false }
-    })
 
-    const { data: insertData, error: dbError } = await supabase
-      .from('sensor_logs')
-      .insert(logEntry)
-      .select()
-      .single()
+    if (isBatch) {
+      return await handleBatch(supabase, data, minimal, signer)
+    }
+
+    const insert = supabase.from('sensor_logs').insert(logEntry)
+    const { data: insertData, error: dbError } = minimal ? await insert : await insert.select().maybeSingle()
 
     if (dbError) {
       console.error('Database Insert Error:', dbError)
       console.error('Data causing error:', JSON.stringify(logEntry))
+      checkClientHealth(dbError)
       return new Response(JSON.stringify({ error: 'Database error', details: dbError.message }), { status: 500, headers: { 'Content-Type': 'application/json' } })
     }
 
-    const currentData = insertData || logEntry
-    let notificationTitle = ""
-    let notificationMessage = ""
-    let shouldNotify = false
-
-    if (currentData.z1_alert && currentData.z2_alert) {
-        notificationTitle = "ALERT: Zone 1 & Zone 2"
-        notificationMessage = `Multiple alerts! Z1(T:${currentData.z1_temp ?? 'N/A'}C L:${currentData.z1_lux}) Z2(T:${currentData.z2_temp ?? 'N/A'}C H:${currentData.z2_humidity ?? 'N/A'}%)`
-        shouldNotify = true
-    } else if (currentData.z1_alert) {
-        notificationTitle = "ALERT: Zone 1"
-        notificationMessage = `Alert in Zone 1. Temp: ${currentData.z1_temp ?? 'N/A'}C, Lux: ${currentData.z1_lux}.`
-        shouldNotify = true
-    } else if (currentData.z2_alert) {
-        notificationTitle = "ALERT: Zone 2"
-        notificationMessage = `Alert in Zone 2. Temp: ${currentData.z2_temp ?? 'N/A'}C, Humidity: ${currentData.z2_humidity ?? 'N/A'}%.`
-        shouldNotify = true
-    }
+    // Alerts come from the parsed input; the stored row holds the same values.
+    runInBackground(recordAlertStates(supabase, new Map([[device ?? '', logEntry]])))
 
-    if (shouldNotify) {
-        sendNtfyNotification(notificationTitle, notificationMessage)
+    if (minimal) {
+      return new Response(null, { status: 204 })
+    }
+    if (!insertData && logEntry.seq !== null && device !== null) {
+      return jsonResponse({ status: 'duplicate' }, 200)
     }
 
+    const currentData = insertData || logEntry
+
     return new Response(JSON.stringify({ status: 'success', data_inserted: currentData }), {
       status: 201,
       headers: { 'Content-Type': 'application/json' }
@@ -117,6 +441,7 @@ serve(async (req: Request) => {
 
   } catch (e) {
     console.error('Error processing request:', e)
+    if (!(e instanceof SyntaxError)) resetSupabaseClient()
      let errorMessage = 'Internal Server Error'
      if (e instanceof SyntaxError) { errorMessage = 'Invalid JSON payload' }
      else if (e instanceof Error) { errorMessage = e.message }
@@ -125,4 +450,6 @@ serve(async (req: Request) => {
       headers: { 'Content-Type': 'application/json' }
     })
   }
-})
+}
+
+serve(handleRequest)
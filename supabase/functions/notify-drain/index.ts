@@ -0,0 +1,183 @@
+import { createClient } from 'https://esm.sh/@supabase/supabase-js@2'
+import { serve } from 'https://deno.land/std@0.177.0/http/server.ts'
+
+const SEND_NOTIFICATIONS = Deno.env.get('SEND_NOTIFICATIONS') !== 'false'
+
+// Delivers notification_outbox (filled by note_alert_states(), see
+// supabase/migrations). Run by pg_cron every minute and kicked through
+// pg_net whenever a push is queued. Each pass leases a batch, sends it as
+// digests of up to MAX_DIGEST_LINES zones and settles every row as sent or
+// for retry; the database applies the backoff and the attempt limit.
+const BATCH_SIZE = 50
+const LEASE_S = 60
+const MAX_ATTEMPTS = 12
+const MAX_DIGEST_LINES = 20
+const NTFY_TIMEOUT_MS = 10000
+const RUN_BUDGET_MS = 25000
+
+let supabaseClient: any = null
+
+function getSupabaseClient() {
+  if (supabaseClient) return supabaseClient
+  const supabaseUrl = Deno.env.get('MY_SUPABASE_URL')
+  const supabaseServiceKey = Deno.env.get('MY_SUPABASE_SERVICE_KEY')
+  if (!supabaseUrl || !supabaseServiceKey) return null
+  supabaseClient = createClient(supabaseUrl, supabaseServiceKey, {
+    auth: { persistSession: false, autoRefreshToken: false, detectSessionInUrl: false }
+  })
+  return supabaseClient
+}
+
+function jsonResponse(body: unknown, status: number) {
+  return new Response(JSON.stringify(body), { status, headers: { 'Content-Type': 'application/json' } })
+}
+
+// Rows queued before lux became numeric carry the old text ("DARK", "412").
+function luxText(reading: any): string {
+  if (reading.lux_state === 'dark') return 'DARK'
+  if (reading.lux_state === 'bright') return 'BRIGHT'
+  return String(reading.lux ?? '')
+}
+
+function zoneMessage(row: any): string {
+  const zone = row.zone
+  if (row.event === 'cleared') return `Zone ${zone} back to normal.`
+  const prefix = row.event === 'repeat' ? `Zone ${zone} still in alert` : `Alert in Zone ${zone}`
+  const reading = row.reading ?? {}
+  if (zone === 1) {
+    return `${prefix}. Temp: ${reading.temp ?? 'N/A'}C, Lux: ${luxText(reading)}.`
+  }
+  return `${prefix}. Temp: ${reading.temp ?? 'N/A'}C, Humidity: ${reading.humidity ?? 'N/A'}%.`
+}
+
+const EVENT_PRIORITY: Record<string, number> = { raised: 4, repeat: 3, cleared: 2 }
+
+// Queued pushes coalesced into a single message.
+function buildDigest(rows: any[]) {
+  const lines = rows.map((row) => {
+    const device = row.device_id ? `[${row.device_id}] ` : ''
+    const extra = row.suppressed > 0 ? ` (${row.suppressed} more changes since the last push)` : ''
+    return device + zoneMessage(row) + extra
+  })
+  const alerting = rows.filter((row) => row.event !== 'cleared')
+  let title: string
+  if (rows.length === 1) {
+    const row = rows[0]
+    title = row.event === 'cleared' ? `Cleared: Zone ${row.zone}` : `ALERT: Zone ${row.zone}`
+    if (row.device_id) title += ` (${row.device_id})`
+  } else if (alerting.length > 0) {
+    title = `ALERT: ${alerting.length} zone${alerting.length > 1 ? 's' : ''}`
+  } else {
+    title = `Cleared: ${rows.length} zones`
+  }
+  const priority = Math.max(...rows.map((row) => EVENT_PRIORITY[row.event] ?? 3))
+  return { title, message: lines.join('\n'), priority }
+}
+
+interface NtfyTarget {
+  topicUrl: string
+  accessToken: string
+}
+
+// Function secrets, as INGEST_SIGNING_KEY in log-sensor-data.
+function ntfyTarget(): NtfyTarget | null {
+  const topicUrl = Deno.env.get('NTFY_TOPIC_URL') ?? ''
+  const accessToken = Deno.env.get('NTFY_ACCESS_TOKEN') ?? ''
+  if (!SEND_NOTIFICATIONS || !topicUrl.includes('/') || !accessToken) return null
+  return { topicUrl, accessToken }
+}
+
+// Returns null once ntfy accepted the message, otherwise what went wrong.
+async function sendNtfyNotification(ntfy: NtfyTarget, title: string, message: string,
+                                    priority: number): Promise<string | null> {
+  console.log(`Sending notification: ${title} - ${message}`)
+  try {
+    const response = await fetch(ntfy.topicUrl, {
+      method: 'POST',
+      headers: {
+        'Title': title,
+        'Priority': String(priority),
+        'Tags': 'warning,thermometer,droplet',
+        'Authorization': `Bearer ${ntfy.accessToken}`
+      },
+      body: message,
+      signal: AbortSignal.timeout(NTFY_TIMEOUT_MS)
+    })
+    const body = await response.text()
+    if (!response.ok) {
+      console.error(`ntfy notification failed: ${response.status} ${response.statusText} ${body}`)
+      return `ntfy ${response.status}: ${body.slice(0, 200)}`
+    }
+    return null
+  } catch (error) {
+    console.error('Error sending ntfy notification:', error)
+    return error instanceof Error ? error.message : String(error)
+  }
+}
+
+export async function handleRequest(req: Request): Promise<Response> {
+  if (req.method !== 'POST') {
+    return jsonResponse({ error: 'Method Not Allowed' }, 405)
+  }
+  const ntfy = ntfyTarget()
+  if (!ntfy) {
+    console.log("Notifications disabled, NTFY_TOPIC_URL invalid, or NTFY_ACCESS_TOKEN missing.")
+    return jsonResponse({ status: 'disabled' }, 200)
+  }
+  const supabase = getSupabaseClient()
+  if (!supabase) {
+    console.error('Missing MY_SUPABASE_URL or MY_SUPABASE_SERVICE_KEY env vars')
+    return jsonResponse({ error: 'Internal configuration error' }, 500)
+  }
+
+  const started = Date.now()
+  let sent = 0
+  let failed = 0
+  while (Date.now() - started < RUN_BUDGET_MS) {
+    const token = crypto.randomUUID()
+    const { data: rows, error: claimError } = await supabase.rpc('claim_notifications', {
+      p_token: token, p_limit: BATCH_SIZE, p_lease_s: LEASE_S, p_max_attempts: MAX_ATTEMPTS
+    })
+    if (claimError) {
+      console.error('Outbox claim error:', claimError)
+      return jsonResponse({ error: 'Database error', details: claimError.message, sent, failed }, 500)
+    }
+    if (!rows || rows.length === 0) break
+
+    const sentIds: number[] = []
+    const failedIds: number[] = []
+    let lastError: string | null = null
+    for (let i = 0; i < rows.length; i += MAX_DIGEST_LINES) {
+      const chunk = rows.slice(i, i + MAX_DIGEST_LINES)
+      const ids = chunk.map((row: any) => row.id)
+      // Once ntfy fails, the rest of the batch goes back for retry unsent.
+      let error = lastError
+      if (!error) {
+        const digest = buildDigest(chunk)
+        error = await sendNtfyNotification(ntfy, digest.title, digest.message, digest.priority)
+      }
+      if (error) {
+        lastError = error
+        failedIds.push(...ids)
+      } else {
+        sentIds.push(...ids)
+      }
+    }
+
+    const { error: finishError } = await supabase.rpc('finish_notifications', {
+      p_token: token, p_sent: sentIds, p_failed: failedIds, p_error: lastError, p_max_attempts: MAX_ATTEMPTS
+    })
+    if (finishError) {
+      // The lease runs out and the rows are claimed again: at-least-once.
+      console.error('Outbox finish error:', finishError)
+      return jsonResponse({ error: 'Database error', details: finishError.message, sent, failed }, 500)
+    }
+    sent += sentIds.length
+    failed += failedIds.length
+    if (lastError || rows.length < BATCH_SIZE) break
+  }
+
+  return jsonResponse({ status: 'success', sent, failed }, 200)
+}
+
+serve(handleRequest)
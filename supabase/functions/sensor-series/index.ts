@@ -0,0 +1,203 @@
+import { createClient } from 'https://esm.sh/@supabase/supabase-js@2'
+import { serve } from 'https://deno.land/std@0.177.0/http/server.ts'
+
+// Downsampled history for charts:
+//
+//   GET /sensor-series?device=<id>&zones=1,2&from=<ts>&to=<ts>&points=500&method=minmax
+//
+// from/to are ISO-8601 strings or epoch milliseconds (default: the last 24 h);
+// without device every device the caller may read is returned. The answer is NDJSON, streamed as
+// it is read, and its size follows points, not the length of the range:
+//
+//   minmax  one line per bucket of at most `points` per device and zone, with
+//           min/max/mean of temperature and lux or humidity (sensor_series()
+//           in supabase/migrations)
+//   lttb    one line per device, zone and metric with `points` [ms, value]
+//           pairs picked by Largest-Triangle-Three-Buckets from bucket means
+//           at LTTB_OVERSAMPLE times that resolution
+const DEFAULT_POINTS = 500
+const MAX_POINTS = 5000
+const DEFAULT_RANGE_MS = 24 * 60 * 60 * 1000
+const LTTB_OVERSAMPLE = 4
+// Rows per sensor_series() call; PostgREST returns at most 1000 by default.
+const PAGE_ROWS = 1000
+
+type Point = [number, number]
+
+// The caller's own JWT goes to the database, so row level security limits
+// the answer to the devices granted to that user (device_access, see
+// 20261017150000_sensor_series.sql). The client is therefore built per
+// request, unlike the service-role clients of the write path.
+function getCallerClient(authorization: string) {
+  const supabaseUrl = Deno.env.get('MY_SUPABASE_URL')
+  const supabaseAnonKey = Deno.env.get('MY_SUPABASE_ANON_KEY')
+  if (!supabaseUrl || !supabaseAnonKey) return null
+  return createClient(supabaseUrl, supabaseAnonKey, {
+    global: { headers: { Authorization: authorization } },
+    auth: { persistSession: false, autoRefreshToken: false, detectSessionInUrl: false }
+  })
+}
+
+function jsonResponse(body: unknown, status: number) {
+  return new Response(JSON.stringify(body), { status, headers: { 'Content-Type': 'application/json' } })
+}
+
+function parseTime(value: string | null, fallbackMs: number): number {
+  if (value === null || value === '') return fallbackMs
+  return /^\d+$/.test(value) ? Number(value) : Date.parse(value)
+}
+
+// Largest-Triangle-Three-Buckets: keeps the first and last point and, from
+// each of threshold - 2 equal buckets between them, the point that forms the
+// largest triangle with the last point kept and the next bucket's average.
+export function lttb(points: Point[], threshold: number): Point[] {
+  if (threshold >= points.length || threshold < 3) return points
+  const out: Point[] = [points[0]]
+  const every = (points.length - 2) / (threshold - 2)
+  let a = 0
+  for (let i = 0; i < threshold - 2; i++) {
+    const start = Math.floor(i * every) + 1
+    const end = Math.floor((i + 1) * every) + 1
+    const nextEnd = Math.min(Math.floor((i + 2) * every) + 1, points.length)
+    let avgX = 0
+    let avgY = 0
+    for (let j = end; j < nextEnd; j++) {
+      avgX += points[j][0]
+      avgY += points[j][1]
+    }
+    avgX /= nextEnd - end
+    avgY /= nextEnd - end
+
+    const [ax, ay] = points[a]
+    let best = start
+    let bestArea = -1
+    for (let j = start; j < end; j++) {
+      const area = Math.abs((ax - avgX) * (points[j][1] - ay) - (ax - points[j][0]) * (avgY - ay))
+      if (area > bestArea) {
+        bestArea = area
+        best = j
+      }
+    }
+    out.push(points[best])
+    a = best
+  }
+  out.push(points[points.length - 1])
+  return out
+}
+
+// One device and zone's buckets as LTTB lines, one per metric.
+function lttbSeries(rows: any[], points: number) {
+  const zone = rows[0].zone
+  const metrics: [string, string][] = [['temp', 'temp_mean'], [zone === 1 ? 'lux' : 'humidity', 'aux_mean']]
+  return metrics.map(([metric, column]) => {
+    const series: Point[] = []
+    for (const row of rows) {
+      if (row[column] !== null) series.push([Date.parse(row.bucket), row[column]])
+    }
+    return { device_id: rows[0].device_id, zone, metric, bucket_s: rows[0].bucket_s, points: lttb(series, points) }
+  })
+}
+
+// The rows come back ordered by device, zone and bucket. Each further page
+// asks sensor_series() for the rows after the last one seen, so it only
+// aggregates what is left; the first page is read before the response
+// starts so a database error can still be a 500.
+async function* seriesLines(supabase: any, args: any, firstPage: any[], method: string, points: number) {
+  let page = firstPage
+  let group: any[] = []
+  while (true) {
+    for (const row of page) {
+      if (method === 'minmax') {
+        yield row
+        continue
+      }
+      if (group.length > 0 && (row.device_id !== group[0].device_id || row.zone !== group[0].zone)) {
+        yield* lttbSeries(group, points)
+        group = []
+      }
+      group.push(row)
+    }
+    if (page.length < PAGE_ROWS) break
+    const last = page[page.length - 1]
+    const { data, error } = await supabase.rpc('sensor_series', {
+      ...args, p_after_device: last.device_id, p_after_zone: last.zone, p_after_bucket: last.bucket
+    })
+    if (error) {
+      console.error('Series page error:', error)
+      yield { error: 'Database error', details: error.message }
+      return
+    }
+    page = data ?? []
+  }
+  if (group.length > 0) yield* lttbSeries(group, points)
+}
+
+function ndjsonStream(lines: AsyncGenerator<unknown>): ReadableStream<Uint8Array> {
+  const encoder = new TextEncoder()
+  return new ReadableStream({
+    async pull(controller) {
+      const { value, done } = await lines.next()
+      if (done) controller.close()
+      else controller.enqueue(encoder.encode(JSON.stringify(value) + '\n'))
+    },
+    async cancel() {
+      await lines.return(undefined)
+    }
+  })
+}
+
+export async function handleRequest(req: Request): Promise<Response> {
+  if (req.method !== 'GET') {
+    return jsonResponse({ error: 'Method Not Allowed' }, 405)
+  }
+
+  const params = new URL(req.url).searchParams
+  const method = params.get('method') ?? 'minmax'
+  if (method !== 'minmax' && method !== 'lttb') {
+    return jsonResponse({ error: 'method must be minmax or lttb' }, 400)
+  }
+  const points = params.has('points') ? Number(params.get('points')) : DEFAULT_POINTS
+  if (!Number.isInteger(points) || points < 3 || points > MAX_POINTS) {
+    return jsonResponse({ error: `points must be an integer from 3 to ${MAX_POINTS}` }, 400)
+  }
+  const zones = (params.get('zones') ?? '1,2').split(',').map(Number)
+  if (zones.some((zone) => zone !== 1 && zone !== 2)) {
+    return jsonResponse({ error: 'zones must list 1 and/or 2' }, 400)
+  }
+  const toMs = parseTime(params.get('to'), Date.now())
+  const fromMs = parseTime(params.get('from'), toMs - DEFAULT_RANGE_MS)
+  if (!isFinite(fromMs) || !isFinite(toMs) || fromMs >= toMs) {
+    return jsonResponse({ error: 'from and to must be timestamps with from before to' }, 400)
+  }
+
+  const authorization = req.headers.get('authorization') ?? ''
+  if (!/^Bearer \S+$/.test(authorization)) {
+    return jsonResponse({ error: 'Authorization required' }, 401)
+  }
+  const supabase = getCallerClient(authorization)
+  if (!supabase) {
+    console.error('Missing MY_SUPABASE_URL or MY_SUPABASE_ANON_KEY env vars')
+    return jsonResponse({ error: 'Internal configuration error' }, 500)
+  }
+
+  const args = {
+    p_device_id: params.get('device'),
+    p_zones: zones,
+    p_from: new Date(fromMs).toISOString(),
+    p_to: new Date(toMs).toISOString(),
+    p_buckets: method === 'lttb' ? points * LTTB_OVERSAMPLE : points,
+    p_limit: PAGE_ROWS
+  }
+  const { data, error } = await supabase.rpc('sensor_series', args)
+  if (error) {
+    console.error('Series query error:', error)
+    return jsonResponse({ error: 'Database error', details: error.message }, 500)
+  }
+
+  return new Response(ndjsonStream(seriesLines(supabase, args, data ?? [], method, points)), {
+    status: 200,
+    headers: { 'Content-Type': 'application/x-ndjson', 'Cache-Control': 'no-store' }
+  })
+}
+
+serve(handleRequest)
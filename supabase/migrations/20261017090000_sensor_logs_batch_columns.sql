@@ -0,0 +1,7 @@
+-- Columns for batch uploads to log-sensor-data: which device sent a reading
+-- and when it was taken (created_at stays the insert time). Single-reading
+-- requests leave both null.
+
+alter table public.sensor_logs
+  add column if not exists device_id text,
+  add column if not exists recorded_at timestamptz;
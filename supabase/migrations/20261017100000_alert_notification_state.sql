@@ -0,0 +1,99 @@
+-- Per device and zone alert state for log-sensor-data's ntfy pushes, so a
+-- zone that stays hot notifies once instead of on every reading, and the
+-- state survives cold starts and is shared by every isolate.
+--
+-- note_alert_states() takes the current alert flag of each (device, zone) in
+-- a request and returns one row per zone, with the push that is due in
+-- "event" (null when none):
+--   raised   zone went into alert, at most once per cooldown
+--   cleared  zone left alert, at most once per cooldown
+--   repeat   zone still in alert, at most once per repeat interval
+-- Raises and clears that land inside the cooldown are counted in
+-- "suppressed" and reported with the next push for that zone; a zone that
+-- flapped and came to rest out of alert gets its "cleared" once the cooldown
+-- is over. "settled" is true for a zone out of alert with nothing pending,
+-- which the caller may stop reporting for a while.
+
+create table if not exists public.alert_notification_state (
+  device_id text not null,
+  zone smallint not null,
+  alerting boolean not null default false,
+  last_notified_at timestamptz,
+  suppressed integer not null default 0,
+  updated_at timestamptz not null default now(),
+  primary key (device_id, zone)
+);
+
+alter table public.alert_notification_state enable row level security;
+
+create or replace function public.note_alert_states(p_states jsonb, p_cooldown_s integer, p_repeat_s integer)
+returns table (device_id text, zone smallint, event text, suppressed integer, settled boolean)
+language plpgsql
+as $$
+#variable_conflict use_column
+declare
+  s jsonb;
+  cur public.alert_notification_state%rowtype;
+  v_device text;
+  v_zone smallint;
+  v_alerting boolean;
+  v_event text;
+  v_gap interval;
+begin
+  for s in select value from jsonb_array_elements(p_states) loop
+    v_device := coalesce(s->>'device_id', '');
+    v_zone := (s->>'zone')::smallint;
+    v_alerting := coalesce((s->>'alerting')::boolean, false);
+
+    insert into public.alert_notification_state (device_id, zone)
+    values (v_device, v_zone)
+    on conflict (device_id, zone) do nothing;
+
+    select * into cur
+      from public.alert_notification_state t
+     where t.device_id = v_device and t.zone = v_zone
+       for update;
+
+    v_event := null;
+    -- "alerting" is the live state, so a raise held back by the cooldown has
+    -- already set it; with changes pending the zone is still owed its
+    -- "raised" after the cooldown, not a repeat after the repeat interval.
+    if v_alerting and (not cur.alerting or cur.suppressed > 0) then
+      v_event := 'raised';
+      v_gap := make_interval(secs => p_cooldown_s);
+    elsif v_alerting then
+      v_event := 'repeat';
+      v_gap := make_interval(secs => p_repeat_s);
+    elsif cur.alerting or cur.suppressed > 0 then
+      v_event := 'cleared';
+      v_gap := make_interval(secs => p_cooldown_s);
+    end if;
+
+    device_id := v_device;
+    zone := v_zone;
+    if v_event is not null and (cur.last_notified_at is null or now() - cur.last_notified_at >= v_gap) then
+      update public.alert_notification_state t
+         set alerting = v_alerting, last_notified_at = now(), suppressed = 0, updated_at = now()
+       where t.device_id = v_device and t.zone = v_zone;
+      event := v_event;
+      suppressed := cur.suppressed;
+      settled := not v_alerting;
+    elsif v_alerting <> cur.alerting then
+      update public.alert_notification_state t
+         set alerting = v_alerting, suppressed = t.suppressed + 1, updated_at = now()
+       where t.device_id = v_device and t.zone = v_zone;
+      event := null;
+      suppressed := cur.suppressed + 1;
+      settled := false;
+    else
+      event := null;
+      suppressed := cur.suppressed;
+      settled := not v_alerting and cur.suppressed = 0;
+    end if;
+    return next;
+  end loop;
+end
+$$;
+
+revoke execute on function public.note_alert_states(jsonb, integer, integer) from public, anon, authenticated;
+grant execute on function public.note_alert_states(jsonb, integer, integer) to service_role;
@@ -0,0 +1,222 @@
+-- Durable outbox for ntfy pushes. note_alert_states() now queues each due
+-- push here in the same transaction that records it as sent, and the
+-- notify-drain function delivers the queue: log-sensor-data no longer calls
+-- ntfy at all, and a push survives the isolate that decided on it.
+--
+-- Delivery is at least once. claim_notifications() leases a batch under a
+-- claim token; finish_notifications() only settles rows still held by that
+-- token, so a drain run whose lease ran out cannot overwrite a newer one.
+-- Failed pushes come back after an exponential backoff (15 s doubling to
+-- 1 h, jittered) and are marked dead after the drain's attempt limit, as
+-- are rows whose run died before settling them.
+--
+-- pg_cron runs the drain every minute to pick up retries; new pushes kick
+-- it straight away through pg_net. Both read the function URL and key from
+-- Vault:
+--   select vault.create_secret('https://<ref>.supabase.co', 'project_url');
+--   select vault.create_secret('<service role key>', 'service_role_key');
+
+create extension if not exists pg_net;
+create extension if not exists pg_cron;
+
+create table if not exists public.notification_outbox (
+  id bigint generated always as identity primary key,
+  device_id text not null,
+  zone smallint not null,
+  event text not null,
+  suppressed integer not null default 0,
+  reading jsonb,
+  created_at timestamptz not null default now(),
+  attempts integer not null default 0,
+  next_attempt_at timestamptz not null default now(),
+  claim_token uuid,
+  locked_until timestamptz,
+  last_error text,
+  sent_at timestamptz,
+  dead_at timestamptz,
+  -- One row per push decision; a replayed transaction cannot queue it twice.
+  unique (device_id, zone, event, created_at)
+);
+
+create index if not exists notification_outbox_pending_idx
+  on public.notification_outbox (next_attempt_at)
+  where sent_at is null and dead_at is null;
+
+alter table public.notification_outbox enable row level security;
+
+-- Asks notify-drain to run now. pg_net sends the request after commit and
+-- never blocks the caller; without the Vault secrets this does nothing and
+-- the cron job picks the rows up once configured.
+create or replace function public.kick_notify_drain()
+returns void
+language plpgsql
+security definer
+set search_path = public
+as $$
+declare
+  v_url text;
+  v_key text;
+begin
+  select decrypted_secret into v_url from vault.decrypted_secrets where name = 'project_url';
+  select decrypted_secret into v_key from vault.decrypted_secrets where name = 'service_role_key';
+  if v_url is null or v_key is null then
+    return;
+  end if;
+  perform net.http_post(
+    url := v_url || '/functions/v1/notify-drain',
+    headers := jsonb_build_object('Authorization', 'Bearer ' || v_key, 'Content-Type', 'application/json'),
+    body := '{}'::jsonb
+  );
+end
+$$;
+
+-- As in 20261017100000_alert_notification_state.sql, with each due push
+-- queued in notification_outbox. p_states entries may carry a "reading"
+-- object (the zone's values) for the message text.
+create or replace function public.note_alert_states(p_states jsonb, p_cooldown_s integer, p_repeat_s integer)
+returns table (device_id text, zone smallint, event text, suppressed integer, settled boolean)
+language plpgsql
+as $$
+#variable_conflict use_column
+declare
+  s jsonb;
+  cur public.alert_notification_state%rowtype;
+  v_device text;
+  v_zone smallint;
+  v_alerting boolean;
+  v_event text;
+  v_gap interval;
+  v_queued integer := 0;
+begin
+  for s in select value from jsonb_array_elements(p_states) loop
+    v_device := coalesce(s->>'device_id', '');
+    v_zone := (s->>'zone')::smallint;
+    v_alerting := coalesce((s->>'alerting')::boolean, false);
+
+    insert into public.alert_notification_state (device_id, zone)
+    values (v_device, v_zone)
+    on conflict (device_id, zone) do nothing;
+
+    select * into cur
+      from public.alert_notification_state t
+     where t.device_id = v_device and t.zone = v_zone
+       for update;
+
+    v_event := null;
+    -- "alerting" is the live state, so a raise held back by the cooldown has
+    -- already set it; with changes pending the zone is still owed its
+    -- "raised" after the cooldown, not a repeat after the repeat interval.
+    if v_alerting and (not cur.alerting or cur.suppressed > 0) then
+      v_event := 'raised';
+      v_gap := make_interval(secs => p_cooldown_s);
+    elsif v_alerting then
+      v_event := 'repeat';
+      v_gap := make_interval(secs => p_repeat_s);
+    elsif cur.alerting or cur.suppressed > 0 then
+      v_event := 'cleared';
+      v_gap := make_interval(secs => p_cooldown_s);
+    end if;
+
+    device_id := v_device;
+    zone := v_zone;
+    if v_event is not null and (cur.last_notified_at is null or now() - cur.last_notified_at >= v_gap) then
+      update public.alert_notification_state t
+         set alerting = v_alerting, last_notified_at = now(), suppressed = 0, updated_at = now()
+       where t.device_id = v_device and t.zone = v_zone;
+      insert into public.notification_outbox (device_id, zone, event, suppressed, reading)
+      values (v_device, v_zone, v_event, cur.suppressed, s->'reading')
+      on conflict do nothing;
+      v_queued := v_queued + 1;
+      event := v_event;
+      suppressed := cur.suppressed;
+      settled := not v_alerting;
+    elsif v_alerting <> cur.alerting then
+      update public.alert_notification_state t
+         set alerting = v_alerting, suppressed = t.suppressed + 1, updated_at = now()
+       where t.device_id = v_device and t.zone = v_zone;
+      event := null;
+      suppressed := cur.suppressed + 1;
+      settled := false;
+    else
+      event := null;
+      suppressed := cur.suppressed;
+      settled := not v_alerting and cur.suppressed = 0;
+    end if;
+    return next;
+  end loop;
+
+  if v_queued > 0 then
+    perform public.kick_notify_drain();
+  end if;
+end
+$$;
+
+-- Leases up to p_limit due rows for p_lease_s seconds. Rows held by another
+-- run are skipped rather than waited on. A row whose drain run died after
+-- claiming it was never settled by finish_notifications(), so the attempt
+-- limit is also applied here: rows that have used up p_max_attempts are
+-- marked dead instead of being claimed again.
+create or replace function public.claim_notifications(p_token uuid, p_limit integer, p_lease_s integer,
+                                                      p_max_attempts integer)
+returns setof public.notification_outbox
+language sql
+as $$
+  update public.notification_outbox o
+     set dead_at = now(),
+         claim_token = null,
+         locked_until = null,
+         last_error = coalesce(o.last_error, 'lease expired without a result')
+   where o.id in (
+     select id
+       from public.notification_outbox
+      where sent_at is null and dead_at is null
+        and attempts >= p_max_attempts
+        and (locked_until is null or locked_until < now())
+        for update skip locked);
+
+  update public.notification_outbox o
+     set claim_token = p_token,
+         locked_until = now() + make_interval(secs => p_lease_s),
+         attempts = o.attempts + 1
+   where o.id in (
+     select id
+       from public.notification_outbox
+      where sent_at is null and dead_at is null
+        and attempts < p_max_attempts
+        and next_attempt_at <= now()
+        and (locked_until is null or locked_until < now())
+      order by id
+      limit p_limit
+        for update skip locked)
+  returning o.*;
+$$;
+
+-- Settles a claimed batch: p_sent as delivered, p_failed for retry with
+-- backoff, or dead once p_max_attempts is reached.
+create or replace function public.finish_notifications(p_token uuid, p_sent bigint[], p_failed bigint[],
+                                                       p_error text, p_max_attempts integer)
+returns void
+language sql
+as $$
+  update public.notification_outbox
+     set sent_at = now(), claim_token = null, locked_until = null, last_error = null
+   where id = any(p_sent) and claim_token = p_token;
+
+  update public.notification_outbox
+     set claim_token = null,
+         locked_until = null,
+         last_error = p_error,
+         dead_at = case when attempts >= p_max_attempts then now() end,
+         next_attempt_at = now() + least(interval '1 hour', interval '15 seconds' * power(2, attempts - 1))
+                                   * (0.75 + random() * 0.5)
+   where id = any(p_failed) and claim_token = p_token;
+$$;
+
+revoke execute on function public.kick_notify_drain() from public, anon, authenticated;
+revoke execute on function public.claim_notifications(uuid, integer, integer, integer) from public, anon, authenticated;
+revoke execute on function public.finish_notifications(uuid, bigint[], bigint[], text, integer) from public, anon, authenticated;
+grant execute on function public.kick_notify_drain() to service_role;
+grant execute on function public.claim_notifications(uuid, integer, integer, integer) to service_role;
+grant execute on function public.finish_notifications(uuid, bigint[], bigint[], text, integer) to service_role;
+
+select cron.schedule('notify-drain', '* * * * *', 'select public.kick_notify_drain()');
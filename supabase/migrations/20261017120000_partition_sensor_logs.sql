@@ -0,0 +1,179 @@
+-- Rebuilds sensor_logs as a table range-partitioned by calendar month (UTC)
+-- on created_at, so range queries only touch the months they cover and
+-- retention drops whole partitions instead of DELETEing rows.
+--
+-- * Partitions are named sensor_logs_pYYYY_MM. A default partition catches
+--   anything outside them; create_sensor_log_partition() moves such rows into
+--   the month's partition when it is created. Each partition has row level
+--   security on and no grants for anon or authenticated, so clients only
+--   reach the rows through sensor_logs and its policies.
+-- * BRIN indexes on created_at and recorded_at: both grow with insert order,
+--   so a few pages of summaries per partition replace a large B-tree.
+-- * maintain_sensor_log_partitions() runs daily from pg_cron: it keeps three
+--   months of partitions ahead and drops those older than twelve months.
+--
+-- Existing rows are copied over and the old heap is dropped. The primary key
+-- becomes (id, created_at), as partitioning requires; ids keep counting from
+-- the old maximum. Column defaults and CHECK constraints are kept. Row level
+-- security is carried over if it was enabled, but any policies on the old
+-- table have to be recreated.
+
+alter table public.sensor_logs rename to sensor_logs_unpartitioned;
+
+-- Column defaults, CHECK constraints and generated columns come along, so
+-- inserts that rely on them behave as before. Identity and indexes do not:
+-- id gets its own sequence below and the indexes are rebuilt for the
+-- partitioned layout.
+create table public.sensor_logs (
+  like public.sensor_logs_unpartitioned including defaults including constraints including generated
+) partition by range (created_at);
+
+create sequence public.sensor_logs_row_id_seq as bigint owned by public.sensor_logs.id;
+select setval('public.sensor_logs_row_id_seq',
+              coalesce((select max(id) from public.sensor_logs_unpartitioned), 0) + 1, false);
+
+alter table public.sensor_logs
+  alter column id set default nextval('public.sensor_logs_row_id_seq'),
+  alter column created_at set default now(),
+  alter column created_at set not null;
+
+create table public.sensor_logs_default partition of public.sensor_logs default;
+alter table public.sensor_logs_default enable row level security;
+revoke all on table public.sensor_logs_default from anon, authenticated;
+
+-- The columns an INSERT may name: every column but the generated ones,
+-- which Postgres computes itself. Used when rows are moved between tables.
+create or replace function public.sensor_log_insert_columns()
+returns text
+language sql
+stable
+as $$
+  select string_agg(quote_ident(attname), ', ' order by attnum)
+    from pg_attribute
+   where attrelid = 'public.sensor_logs'::regclass and attnum > 0 and not attisdropped and attgenerated = '';
+$$;
+
+-- Creates the partition for the month containing p_month, if missing.
+create or replace function public.create_sensor_log_partition(p_month date)
+returns text
+language plpgsql
+as $$
+declare
+  v_first date := date_trunc('month', p_month)::date;
+  v_from timestamptz := make_timestamptz(extract(year from v_first)::int, extract(month from v_first)::int, 1, 0, 0, 0, 'UTC');
+  v_to timestamptz := v_from + interval '1 month';
+  v_name text := 'sensor_logs_p' || to_char(v_first, 'YYYY_MM');
+  v_stray boolean;
+begin
+  if to_regclass('public.' || v_name) is not null then
+    return v_name;
+  end if;
+
+  -- Postgres refuses the new partition while the default one holds rows in
+  -- its range (partition maintenance did not run in time), so park them.
+  select exists (select 1 from public.sensor_logs_default where created_at >= v_from and created_at < v_to)
+    into v_stray;
+  if v_stray then
+    create temp table sensor_logs_stray (like public.sensor_logs) on commit drop;
+    with moved as (
+      delete from public.sensor_logs_default where created_at >= v_from and created_at < v_to returning *
+    )
+    insert into sensor_logs_stray select * from moved;
+  end if;
+
+  execute format('create table public.%I partition of public.sensor_logs for values from (%L) to (%L)',
+                 v_name, v_from, v_to);
+  -- Reached only through the parent, whose policies apply there.
+  execute format('alter table public.%I enable row level security', v_name);
+  execute format('revoke all on table public.%I from anon, authenticated', v_name);
+
+  if v_stray then
+    execute format('insert into public.sensor_logs (%1$s) select %1$s from sensor_logs_stray',
+                   public.sensor_log_insert_columns());
+    drop table sensor_logs_stray;
+  end if;
+  return v_name;
+end
+$$;
+
+-- Keeps the current month and p_months_ahead more partitioned, and drops
+-- partitions (and default-partition rows) older than p_keep_months full
+-- months. A null p_keep_months keeps everything.
+create or replace function public.maintain_sensor_log_partitions(p_months_ahead integer default 3,
+                                                                 p_keep_months integer default 12)
+returns void
+language plpgsql
+as $$
+declare
+  v_month date := date_trunc('month', now() at time zone 'UTC')::date;
+  v_cutoff date;
+  r record;
+begin
+  for i in 0..p_months_ahead loop
+    perform public.create_sensor_log_partition((v_month + make_interval(months => i))::date);
+  end loop;
+
+  if p_keep_months is null then
+    return;
+  end if;
+  v_cutoff := (v_month - make_interval(months => p_keep_months))::date;
+
+  for r in
+    select c.relname
+      from pg_inherits i
+      join pg_class c on c.oid = i.inhrelid
+     where i.inhparent = 'public.sensor_logs'::regclass
+       and c.relname ~ '^sensor_logs_p[0-9]{4}_[0-9]{2}$'
+  loop
+    if to_date(substring(r.relname from 14), 'YYYY_MM') < v_cutoff then
+      execute format('alter table public.sensor_logs detach partition public.%I', r.relname);
+      execute format('drop table public.%I', r.relname);
+    end if;
+  end loop;
+
+  delete from public.sensor_logs_default
+   where created_at < make_timestamptz(extract(year from v_cutoff)::int, extract(month from v_cutoff)::int, 1, 0, 0, 0, 'UTC');
+end
+$$;
+
+-- Partitions for every month that has data, then the copy.
+do $$
+declare
+  v_month date := coalesce(date_trunc('month', (select min(created_at) from public.sensor_logs_unpartitioned) at time zone 'UTC')::date,
+                           date_trunc('month', now() at time zone 'UTC')::date);
+begin
+  while v_month <= date_trunc('month', now() at time zone 'UTC')::date loop
+    perform public.create_sensor_log_partition(v_month);
+    v_month := (v_month + interval '1 month')::date;
+  end loop;
+  perform public.maintain_sensor_log_partitions(3, null);
+end
+$$;
+
+do $$
+begin
+  execute format('insert into public.sensor_logs (%1$s) select %1$s from public.sensor_logs_unpartitioned',
+                 public.sensor_log_insert_columns());
+end
+$$;
+
+-- Indexes after the copy: cheaper than maintaining them row by row.
+alter table public.sensor_logs add primary key (id, created_at);
+create index sensor_logs_created_at_brin on public.sensor_logs using brin (created_at) with (pages_per_range = 32);
+create index sensor_logs_recorded_at_brin on public.sensor_logs using brin (recorded_at) with (pages_per_range = 32);
+
+do $$
+begin
+  if (select relrowsecurity from pg_class where oid = 'public.sensor_logs_unpartitioned'::regclass) then
+    alter table public.sensor_logs enable row level security;
+  end if;
+end
+$$;
+
+drop table public.sensor_logs_unpartitioned;
+
+revoke execute on function public.sensor_log_insert_columns() from public, anon, authenticated;
+revoke execute on function public.create_sensor_log_partition(date) from public, anon, authenticated;
+revoke execute on function public.maintain_sensor_log_partitions(integer, integer) from public, anon, authenticated;
+
+select cron.schedule('sensor-logs-partitions', '5 0 * * *', 'select public.maintain_sensor_log_partitions()');
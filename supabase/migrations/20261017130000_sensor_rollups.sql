@@ -0,0 +1,162 @@
+-- Per device, zone and bucket rollups of sensor_logs at 1 minute, 1 hour
+-- and 1 day, so history reads cost O(buckets) instead of O(rows).
+--
+-- Each row holds the sample count, min/max/sum/count of the zone's
+-- temperature and of its second quantity (lux for zone 1, humidity for
+-- zone 2), and alert-seconds. A reading stands for the time since the
+-- device's previous one (reading_seconds()), since the cycle is set per
+-- device and batches arrive together; an alerting reading adds that time.
+-- Means are sum / count at read time, which keeps every column mergeable.
+--
+-- A statement-level trigger folds each INSERT into the three resolutions
+-- with one upsert per bucket touched (a 500-reading batch touches a handful).
+-- Readings are bucketed by recorded_at when present, else created_at, and
+-- buckets are aligned to the UTC epoch. 1 minute rollups are kept for 31
+-- days; hourly and daily ones are kept as long as sensor_logs is not. They
+-- are read through sensor_series() (20261017150000_sensor_series.sql).
+
+create table if not exists public.sensor_rollups (
+  bucket_s integer not null,
+  device_id text not null,
+  zone smallint not null,
+  bucket timestamptz not null,
+  samples integer not null,
+  temp_min double precision,
+  temp_max double precision,
+  temp_sum double precision not null default 0,
+  temp_count integer not null default 0,
+  aux_min double precision,
+  aux_max double precision,
+  aux_sum double precision not null default 0,
+  aux_count integer not null default 0,
+  alert_seconds integer not null default 0,
+  primary key (bucket_s, device_id, zone, bucket)
+);
+
+alter table public.sensor_rollups enable row level security;
+
+-- The newest reading time folded in per device, where the next batch's
+-- first reading measures its gap from.
+create table if not exists public.sensor_rollup_devices (
+  device_id text primary key,
+  last_at timestamptz
+);
+
+alter table public.sensor_rollup_devices enable row level security;
+
+-- Seconds a reading stands for: the gap since the device's previous reading,
+-- capped at an hour (the longest cycle a device can be set to) so an outage
+-- is not counted as time in the last state. A reading with no earlier one,
+-- or out of order, counts 0.
+create or replace function public.reading_seconds(p_gap interval)
+returns double precision
+language sql
+immutable
+as $$
+  select least(greatest(coalesce(extract(epoch from p_gap)::double precision, 0), 0), 3600);
+$$;
+
+-- z1_lux is stored as text ("DARK"/"BRIGHT" at the ends of the LDR's range);
+-- only plain numbers take part in the lux statistics.
+create or replace function public.lux_value(p_lux text)
+returns double precision
+language sql
+immutable
+as $$
+  select case when p_lux ~ '^\s*-?[0-9]+(\.[0-9]+)?([eE][-+]?[0-9]+)?\s*$' then p_lux::double precision end;
+$$;
+
+create or replace function public.upsert_sensor_rollups(p_rows public.sensor_logs[])
+returns void
+language sql
+as $$
+  -- Locks the devices' rows, in a fixed order, so two batches from one
+  -- device take turns and the second sees where the first ended.
+  insert into public.sensor_rollup_devices as d (device_id)
+  select distinct coalesce(n.device_id, '') from unnest(p_rows) n order by 1
+  on conflict (device_id) do update set last_at = d.last_at;
+
+  insert into public.sensor_rollups as r
+         (bucket_s, device_id, zone, bucket, samples, temp_min, temp_max, temp_sum, temp_count,
+          aux_min, aux_max, aux_sum, aux_count, alert_seconds)
+  select res.bucket_s,
+         z.device_id,
+         z.zone,
+         to_timestamp(floor(extract(epoch from z.at) / res.bucket_s) * res.bucket_s),
+         count(*),
+         min(z.temp), max(z.temp), coalesce(sum(z.temp), 0), count(z.temp),
+         min(z.aux), max(z.aux), coalesce(sum(z.aux), 0), count(z.aux),
+         round(sum(case when z.alert then z.seconds else 0 end))
+    from (select t.device_id, t.at, t.seconds, v.zone, v.temp, v.aux, v.alert
+            from (select b.device_id, b.at, b.n,
+                         public.reading_seconds(b.at - coalesce(lag(b.at) over (partition by b.device_id order by b.at),
+                                                                d.last_at)) as seconds
+                    from (select coalesce(n.device_id, '') as device_id,
+                                 coalesce(n.recorded_at, n.created_at) as at,
+                                 n
+                            from unnest(p_rows) n) b
+                    left join public.sensor_rollup_devices d on d.device_id = b.device_id) t
+           cross join lateral (values
+             (1::smallint, (t.n).z1_temp::double precision, public.lux_value((t.n).z1_lux::text), coalesce((t.n).z1_alert, false)),
+             (2::smallint, (t.n).z2_temp::double precision, (t.n).z2_humidity::double precision, coalesce((t.n).z2_alert, false))
+           ) v(zone, temp, aux, alert)) z
+   cross join (values (60), (3600), (86400)) res(bucket_s)
+   where res.bucket_s <> 60 or z.at >= now() - interval '31 days'
+   group by 1, 2, 3, 4
+  on conflict (bucket_s, device_id, zone, bucket) do update set
+    samples = r.samples + excluded.samples,
+    temp_min = least(r.temp_min, excluded.temp_min),
+    temp_max = greatest(r.temp_max, excluded.temp_max),
+    temp_sum = r.temp_sum + excluded.temp_sum,
+    temp_count = r.temp_count + excluded.temp_count,
+    aux_min = least(r.aux_min, excluded.aux_min),
+    aux_max = greatest(r.aux_max, excluded.aux_max),
+    aux_sum = r.aux_sum + excluded.aux_sum,
+    aux_count = r.aux_count + excluded.aux_count,
+    alert_seconds = r.alert_seconds + excluded.alert_seconds;
+
+  update public.sensor_rollup_devices d
+     set last_at = greatest(d.last_at, b.at)
+    from (select coalesce(n.device_id, '') as device_id, max(coalesce(n.recorded_at, n.created_at)) as at
+            from unnest(p_rows) n
+           group by 1) b
+   where d.device_id = b.device_id;
+$$;
+
+create or replace function public.rollup_sensor_logs()
+returns trigger
+language plpgsql
+as $$
+begin
+  perform public.upsert_sensor_rollups(array(select n from new_rows n));
+  return null;
+end
+$$;
+
+create trigger sensor_logs_rollup
+  after insert on public.sensor_logs
+  referencing new table as new_rows
+  for each statement
+  execute function public.rollup_sensor_logs();
+
+-- Backfill, a month at a time and in order, so each month's first readings
+-- measure their gap from the month before.
+do $$
+declare
+  v_month timestamptz;
+begin
+  for v_month in
+    select distinct date_trunc('month', created_at) from public.sensor_logs order by 1
+  loop
+    perform public.upsert_sensor_rollups(array(
+      select s from public.sensor_logs s
+       where s.created_at >= v_month and s.created_at < v_month + interval '1 month'));
+  end loop;
+end
+$$;
+
+revoke execute on function public.upsert_sensor_rollups(public.sensor_logs[]) from public, anon, authenticated;
+grant execute on function public.upsert_sensor_rollups(public.sensor_logs[]) to service_role;
+
+select cron.schedule('sensor-rollups-1m-retention', '15 0 * * *',
+                     $$delete from public.sensor_rollups where bucket_s = 60 and bucket < now() - interval '31 days'$$);
@@ -0,0 +1,83 @@
+-- z1_lux becomes a number and gets a saturation flag next to it. It used to
+-- be text holding a whole number or "DARK"/"BRIGHT" (the LDR past either end
+-- of its range), so light could not be indexed, aggregated or compared.
+--
+--   z1_lux        double precision; null when saturated or not reported
+--   z1_lux_state  lux_state: 'ok' with a number, 'dark' or 'bright' without
+--
+-- Existing rows are converted in place. Both columns change in one ALTER
+-- TABLE, so every partition is rewritten once; each USING expression reads
+-- the row as it was before the statement. Text that is neither a number nor
+-- one of the two words (an empty string from a missing value) becomes null.
+
+create type public.lux_state as enum ('ok', 'dark', 'bright');
+
+-- Added as text (no rewrite), then typed together with z1_lux below.
+alter table public.sensor_logs add column z1_lux_state text;
+
+alter table public.sensor_logs
+  alter column z1_lux_state type public.lux_state using (
+    case
+      when z1_lux = 'DARK' then 'dark'
+      when z1_lux = 'BRIGHT' then 'bright'
+      when public.lux_value(z1_lux) is not null then 'ok'
+    end)::public.lux_state,
+  alter column z1_lux type double precision using public.lux_value(z1_lux);
+
+-- As in 20261017130000_sensor_rollups.sql, reading lux directly.
+create or replace function public.upsert_sensor_rollups(p_rows public.sensor_logs[])
+returns void
+language sql
+as $$
+  -- Locks the devices' rows, in a fixed order, so two batches from one
+  -- device take turns and the second sees where the first ended.
+  insert into public.sensor_rollup_devices as d (device_id)
+  select distinct coalesce(n.device_id, '') from unnest(p_rows) n order by 1
+  on conflict (device_id) do update set last_at = d.last_at;
+
+  insert into public.sensor_rollups as r
+         (bucket_s, device_id, zone, bucket, samples, temp_min, temp_max, temp_sum, temp_count,
+          aux_min, aux_max, aux_sum, aux_count, alert_seconds)
+  select res.bucket_s,
+         z.device_id,
+         z.zone,
+         to_timestamp(floor(extract(epoch from z.at) / res.bucket_s) * res.bucket_s),
+         count(*),
+         min(z.temp), max(z.temp), coalesce(sum(z.temp), 0), count(z.temp),
+         min(z.aux), max(z.aux), coalesce(sum(z.aux), 0), count(z.aux),
+         round(sum(case when z.alert then z.seconds else 0 end))
+    from (select t.device_id, t.at, t.seconds, v.zone, v.temp, v.aux, v.alert
+            from (select b.device_id, b.at, b.n,
+                         public.reading_seconds(b.at - coalesce(lag(b.at) over (partition by b.device_id order by b.at),
+                                                                d.last_at)) as seconds
+                    from (select coalesce(n.device_id, '') as device_id,
+                                 coalesce(n.recorded_at, n.created_at) as at,
+                                 n
+                            from unnest(p_rows) n) b
+                    left join public.sensor_rollup_devices d on d.device_id = b.device_id) t
+           cross join lateral (values
+             (1::smallint, (t.n).z1_temp::double precision, (t.n).z1_lux, coalesce((t.n).z1_alert, false)),
+             (2::smallint, (t.n).z2_temp::double precision, (t.n).z2_humidity::double precision, coalesce((t.n).z2_alert, false))
+           ) v(zone, temp, aux, alert)) z
+   cross join (values (60), (3600), (86400)) res(bucket_s)
+   where res.bucket_s <> 60 or z.at >= now() - interval '31 days'
+   group by 1, 2, 3, 4
+  on conflict (bucket_s, device_id, zone, bucket) do update set
+    samples = r.samples + excluded.samples,
+    temp_min = least(r.temp_min, excluded.temp_min),
+    temp_max = greatest(r.temp_max, excluded.temp_max),
+    temp_sum = r.temp_sum + excluded.temp_sum,
+    temp_count = r.temp_count + excluded.temp_count,
+    aux_min = least(r.aux_min, excluded.aux_min),
+    aux_max = greatest(r.aux_max, excluded.aux_max),
+    aux_sum = r.aux_sum + excluded.aux_sum,
+    aux_count = r.aux_count + excluded.aux_count,
+    alert_seconds = r.alert_seconds + excluded.alert_seconds;
+
+  update public.sensor_rollup_devices d
+     set last_at = greatest(d.last_at, b.at)
+    from (select coalesce(n.device_id, '') as device_id, max(coalesce(n.recorded_at, n.created_at)) as at
+            from unnest(p_rows) n
+           group by 1) b
+   where d.device_id = b.device_id;
+$$;
@@ -0,0 +1,135 @@
+-- Chart series: a time range cut into at most p_buckets equal buckets per
+-- device and zone, each with min/max/mean of temperature and lux or
+-- humidity. Used by the sensor-series edge function for min/max charts and
+-- as the input it runs LTTB over.
+--
+-- The bucket width is the range over p_buckets, in whole seconds. Widths of
+-- a minute or more are built from the coarsest sensor_rollups resolution
+-- that fits (and rounded up to a multiple of it), so the cost follows the
+-- number of buckets, not readings. Narrower widths (under about 8 hours at
+-- 500 buckets) aggregate the raw readings. Buckets are aligned to the UTC
+-- epoch; the first one may start before p_from. A null p_device_id returns
+-- every device.
+--
+-- Rows come ordered by device, zone and bucket. Long answers are read in
+-- pages of p_limit rows by key: p_after_* name the last row of the previous
+-- page, and only readings and rollups after it are aggregated, so a page
+-- neither repeats the work of the pages before it nor shifts when rows
+-- arrive between pages.
+--
+-- The function runs as the caller, so row level security decides which
+-- devices it sees: a signed-in user reads the devices granted to them in
+-- device_access, and the service role reads all of them.
+
+create table if not exists public.device_access (
+  user_id uuid not null references auth.users (id) on delete cascade,
+  device_id text not null,
+  primary key (user_id, device_id)
+);
+
+alter table public.device_access enable row level security;
+
+create policy device_access_own on public.device_access
+  for select to authenticated
+  using (user_id = auth.uid());
+
+-- Without it the policy below does nothing and every signed-in user reads
+-- every device. The service role bypasses it.
+alter table public.sensor_logs enable row level security;
+
+create policy sensor_logs_granted on public.sensor_logs
+  for select to authenticated
+  using (device_id in (select a.device_id from public.device_access a where a.user_id = auth.uid()));
+
+create policy sensor_rollups_granted on public.sensor_rollups
+  for select to authenticated
+  using (device_id in (select a.device_id from public.device_access a where a.user_id = auth.uid()));
+
+create or replace function public.sensor_series(p_device_id text, p_zones smallint[], p_from timestamptz,
+                                                p_to timestamptz, p_buckets integer default 500,
+                                                p_after_device text default null, p_after_zone smallint default null,
+                                                p_after_bucket timestamptz default null, p_limit integer default null)
+returns table (device_id text, zone smallint, bucket timestamptz, bucket_s integer, samples integer,
+               temp_min double precision, temp_max double precision, temp_mean double precision,
+               aux_min double precision, aux_max double precision, aux_mean double precision,
+               alert_seconds integer)
+language plpgsql
+stable
+as $$
+#variable_conflict use_column
+declare
+  v_width integer := greatest(ceil(extract(epoch from p_to - p_from) / greatest(p_buckets, 1)), 1)::integer;
+  v_source integer;
+  v_start timestamptz;
+begin
+  select s into v_source
+    from unnest(array[60, 3600, 86400]) s
+   where s <= v_width
+     and (s <> 60 or p_from >= now() - interval '31 days')
+   order by s desc
+   limit 1;
+
+  if v_source is not null then
+    v_width := ceil(v_width::numeric / v_source)::integer * v_source;
+  end if;
+  v_start := to_timestamp(floor(extract(epoch from p_from) / v_width) * v_width);
+
+  if v_source is null then
+    -- Readings are bucketed by recorded_at, which log-sensor-data keeps
+    -- between 5 minutes ahead of created_at (clock skew) and 7 days behind
+    -- it (the oldest reading a batch may carry). The created_at bounds let
+    -- partition pruning and the BRIN index skip everything else, so an old,
+    -- narrow range reads about a week of partitions, not all of them since.
+    -- An hour more is read so the first readings in range measure their
+    -- alert time from the one before (reading_seconds(), as in
+    -- sensor_rollups).
+    return query
+      select z.device_id, z.zone,
+             to_timestamp(floor(extract(epoch from z.at) / v_width) * v_width), v_width,
+             count(*)::integer,
+             min(z.temp), max(z.temp), avg(z.temp),
+             min(z.aux), max(z.aux), avg(z.aux),
+             round(sum(case when z.alert then z.seconds else 0 end))::integer
+        from (select t.device_id, t.at, t.seconds, v.zone, v.temp, v.aux, v.alert
+                from (select b.*,
+                             public.reading_seconds(b.at - lag(b.at) over (partition by b.device_id order by b.at)) as seconds
+                        from (select coalesce(s.device_id, '') as device_id,
+                                     coalesce(s.recorded_at, s.created_at) as at,
+                                     s.z1_temp, s.z1_lux, s.z1_alert, s.z2_temp, s.z2_humidity, s.z2_alert
+                                from public.sensor_logs s
+                               where s.created_at >= v_start - interval '1 hour 5 minutes'
+                                 and s.created_at < p_to + interval '7 days'
+                                 and (p_device_id is null or s.device_id = p_device_id)) b) t
+               cross join lateral (values
+                 (1::smallint, t.z1_temp::double precision, t.z1_lux, coalesce(t.z1_alert, false)),
+                 (2::smallint, t.z2_temp::double precision, t.z2_humidity::double precision, coalesce(t.z2_alert, false))
+               ) v(zone, temp, aux, alert)) z
+       where z.at >= v_start and z.at < p_to
+         and z.zone = any(p_zones)
+         and (p_after_bucket is null
+              or (z.device_id, z.zone, z.at) >= (p_after_device, p_after_zone, p_after_bucket + make_interval(secs => v_width)))
+       group by 1, 2, 3
+       order by 1, 2, 3
+       limit p_limit;
+    return;
+  end if;
+
+  return query
+    select r.device_id, r.zone,
+           to_timestamp(floor(extract(epoch from r.bucket) / v_width) * v_width), v_width,
+           sum(r.samples)::integer,
+           min(r.temp_min), max(r.temp_max), sum(r.temp_sum) / nullif(sum(r.temp_count), 0),
+           min(r.aux_min), max(r.aux_max), sum(r.aux_sum) / nullif(sum(r.aux_count), 0),
+           sum(r.alert_seconds)::integer
+      from public.sensor_rollups r
+     where r.bucket_s = v_source
+       and (p_device_id is null or r.device_id = p_device_id)
+       and r.zone = any(p_zones)
+       and r.bucket >= v_start and r.bucket < p_to
+       and (p_after_bucket is null
+            or (r.device_id, r.zone, r.bucket) >= (p_after_device, p_after_zone, p_after_bucket + make_interval(secs => v_width)))
+     group by 1, 2, 3
+     order by 1, 2, 3
+     limit p_limit;
+end
+$$;
@@ -0,0 +1,118 @@
+-- Device identity and idempotent ingest. Every reading now carries the
+-- device's id (from its MAC) and a sequence number that keeps increasing
+-- across reboots; a (device_id, seq) pair is stored at most once, so a
+-- retried upload is a no-op instead of a duplicate row.
+--
+-- A unique index on sensor_logs cannot enforce that: on a partitioned table
+-- it must include created_at, which differs between retries. The pairs go to
+-- sensor_log_seqs instead, from a BEFORE INSERT row trigger that skips the
+-- row when its pair is already there. Readings without a device or seq
+-- (older firmware) are stored as before. Pairs are kept for 7 days, well
+-- past any retry; the firmware never reuses a seq, so this only bounds how
+-- late a duplicate can still be caught.
+--
+-- Per-device reads (sensor_series(), dashboards) get a (device_id,
+-- created_at) index on every partition.
+--
+-- Moving stray rows out of sensor_logs_default re-inserts rows already
+-- stored; create_sensor_log_partition() now flags that with the
+-- sensor_logs.moving setting so neither this trigger nor the rollup trigger
+-- counts them again.
+
+alter table public.sensor_logs add column if not exists seq bigint;
+
+create table if not exists public.sensor_log_seqs (
+  device_id text not null,
+  seq bigint not null,
+  seen_at timestamptz not null default now(),
+  primary key (device_id, seq)
+);
+
+create index if not exists sensor_log_seqs_seen_at_brin on public.sensor_log_seqs using brin (seen_at);
+
+alter table public.sensor_log_seqs enable row level security;
+
+create or replace function public.dedup_sensor_log()
+returns trigger
+language plpgsql
+as $$
+begin
+  if new.device_id is null or new.seq is null or current_setting('sensor_logs.moving', true) = 'on' then
+    return new;
+  end if;
+  insert into public.sensor_log_seqs (device_id, seq) values (new.device_id, new.seq)
+  on conflict do nothing;
+  if found then
+    return new;
+  end if;
+  return null;
+end
+$$;
+
+create trigger sensor_logs_dedup
+  before insert on public.sensor_logs
+  for each row
+  execute function public.dedup_sensor_log();
+
+-- As in 20261017130000_sensor_rollups.sql, skipping rows being moved.
+create or replace function public.rollup_sensor_logs()
+returns trigger
+language plpgsql
+as $$
+begin
+  if current_setting('sensor_logs.moving', true) = 'on' then
+    return null;
+  end if;
+  perform public.upsert_sensor_rollups(array(select n from new_rows n));
+  return null;
+end
+$$;
+
+-- As in 20261017120000_partition_sensor_logs.sql, with the re-insert of
+-- parked rows flagged for the triggers above.
+create or replace function public.create_sensor_log_partition(p_month date)
+returns text
+language plpgsql
+as $$
+declare
+  v_first date := date_trunc('month', p_month)::date;
+  v_from timestamptz := make_timestamptz(extract(year from v_first)::int, extract(month from v_first)::int, 1, 0, 0, 0, 'UTC');
+  v_to timestamptz := v_from + interval '1 month';
+  v_name text := 'sensor_logs_p' || to_char(v_first, 'YYYY_MM');
+  v_stray boolean;
+begin
+  if to_regclass('public.' || v_name) is not null then
+    return v_name;
+  end if;
+
+  select exists (select 1 from public.sensor_logs_default where created_at >= v_from and created_at < v_to)
+    into v_stray;
+  if v_stray then
+    create temp table sensor_logs_stray (like public.sensor_logs) on commit drop;
+    with moved as (
+      delete from public.sensor_logs_default where created_at >= v_from and created_at < v_to returning *
+    )
+    insert into sensor_logs_stray select * from moved;
+  end if;
+
+  execute format('create table public.%I partition of public.sensor_logs for values from (%L) to (%L)',
+                 v_name, v_from, v_to);
+  -- Reached only through the parent, whose policies apply there.
+  execute format('alter table public.%I enable row level security', v_name);
+  execute format('revoke all on table public.%I from anon, authenticated', v_name);
+
+  if v_stray then
+    perform set_config('sensor_logs.moving', 'on', true);
+    execute format('insert into public.sensor_logs (%1$s) select %1$s from sensor_logs_stray',
+                   public.sensor_log_insert_columns());
+    perform set_config('sensor_logs.moving', 'off', true);
+    drop table sensor_logs_stray;
+  end if;
+  return v_name;
+end
+$$;
+
+create index if not exists sensor_logs_device_created_at_idx on public.sensor_logs (device_id, created_at);
+
+select cron.schedule('sensor-log-seqs-retention', '25 0 * * *',
+                     $$delete from public.sensor_log_seqs where seen_at < now() - interval '7 days'$$);
@@ -0,0 +1,63 @@
+-- note_alert_states() across a raise that lands inside the cooldown:
+--   T0        raised, pushed
+--   T0+11min  cleared, pushed
+--   T0+12min  raised again, suppressed by the cooldown
+--   T0+22min  still in alert: pushed as "raised", not held for the repeat
+--             interval
+-- now() is fixed within the transaction, so the clock is moved by shifting
+-- last_notified_at back instead. Run with `supabase test db`.
+
+begin;
+create extension if not exists pgtap with schema extensions;
+select plan(10);
+
+create temporary table steps (step text primary key, event text, suppressed integer);
+
+create function pg_temp.note(p_step text, p_alerting boolean) returns void language sql as $$
+  insert into steps
+  select p_step, n.event, n.suppressed
+    from public.note_alert_states(
+           jsonb_build_array(jsonb_build_object('device_id', 'test-device', 'zone', 1, 'alerting', p_alerting)),
+           600, 3600) n;
+$$;
+
+create function pg_temp.advance(p_minutes integer) returns void language sql as $$
+  update public.alert_notification_state
+     set last_notified_at = last_notified_at - make_interval(mins => p_minutes)
+   where device_id = 'test-device' and zone = 1;
+$$;
+
+select pg_temp.note('t0 raise', true);
+select is((select event from steps where step = 't0 raise'), 'raised', 'first raise is pushed');
+
+select pg_temp.advance(11);
+select pg_temp.note('t11 clear', false);
+select is((select event from steps where step = 't11 clear'), 'cleared', 'clear after the cooldown is pushed');
+
+select pg_temp.advance(1);
+select pg_temp.note('t12 raise', true);
+select is((select event from steps where step = 't12 raise'), null, 'raise inside the cooldown is held back');
+select is((select suppressed from steps where step = 't12 raise'), 1, 'and counted as suppressed');
+
+select pg_temp.advance(5);
+select pg_temp.note('t17 alerting', true);
+select is((select event from steps where step = 't17 alerting'), null, 'still inside the cooldown');
+
+select pg_temp.advance(5);
+select pg_temp.note('t22 alerting', true);
+select is((select event from steps where step = 't22 alerting'), 'raised', 'held raise goes out once the cooldown is over');
+select is((select suppressed from steps where step = 't22 alerting'), 1, 'with the suppressed count');
+
+select pg_temp.advance(10);
+select pg_temp.note('t32 alerting', true);
+select is((select event from steps where step = 't32 alerting'), null, 'then repeats wait for the repeat interval');
+
+select pg_temp.advance(60);
+select pg_temp.note('t92 alerting', true);
+select is((select event from steps where step = 't92 alerting'), 'repeat', 'and repeat after it');
+
+select is((select suppressed from public.alert_notification_state where device_id = 'test-device' and zone = 1), 0,
+          'nothing left pending');
+
+select * from finish();
+rollback;
@@ -0,0 +1,52 @@
+-- sensor_series() and sensor_logs as a signed-in user: a device shows up
+-- only once device_access grants it, whether the series comes from the raw
+-- readings (a one-hour range) or from the rollups (a week). Run with
+-- `supabase test db`.
+
+begin;
+create extension if not exists pgtap with schema extensions;
+select plan(7);
+
+insert into auth.users (id, email) values
+  ('00000000-0000-0000-0000-00000000000a', 'granted@example.com'),
+  ('00000000-0000-0000-0000-00000000000b', 'stranger@example.com');
+insert into public.device_access (user_id, device_id) values
+  ('00000000-0000-0000-0000-00000000000a', 'test-device-a');
+
+insert into public.sensor_logs (device_id, recorded_at, z1_temp, z1_lux, z1_alert, z2_temp, z2_humidity, z2_alert)
+select d, now() - make_interval(mins => m), 24.5, 300, false, 22.0, 45, false
+  from unnest(array['test-device-a', 'test-device-b']) d, generate_series(1, 30) m;
+
+create function pg_temp.sign_in(p_user uuid) returns void language sql as $$
+  select set_config('request.jwt.claims', json_build_object('sub', p_user, 'role', 'authenticated')::text, true);
+$$;
+
+create function pg_temp.series_devices(p_from interval) returns text[] language sql as $$
+  select coalesce(array_agg(distinct s.device_id order by s.device_id), '{}')
+    from public.sensor_series(null, array[1, 2]::smallint[], now() - p_from, now() + interval '1 minute') s
+   where s.device_id like 'test-device-%';
+$$;
+
+select pg_temp.sign_in('00000000-0000-0000-0000-00000000000b');
+set local role authenticated;
+
+select is((select count(*) from public.sensor_logs where device_id like 'test-device-%'), 0::bigint,
+          'a user without device_access reads no raw rows');
+select is(pg_temp.series_devices('1 hour'), '{}'::text[], 'nor a raw series');
+select is(pg_temp.series_devices('7 days'), '{}'::text[], 'nor a rollup series');
+
+reset role;
+select pg_temp.sign_in('00000000-0000-0000-0000-00000000000a');
+set local role authenticated;
+
+select is((select array_agg(distinct device_id) from public.sensor_logs where device_id like 'test-device-%'),
+          array['test-device-a'], 'a granted user reads the granted device only');
+select is(pg_temp.series_devices('1 hour'), array['test-device-a'], 'in the raw series');
+select is(pg_temp.series_devices('7 days'), array['test-device-a'], 'and in the rollup series');
+
+select throws_ok($$ insert into public.sensor_logs_default (device_id) values ('test-device-a') $$, '42501', null,
+                 'partitions are not reachable directly');
+
+reset role;
+select * from finish();
+rollback;
@@ -0,0 +1,481 @@
+// Unit tests for lib/monitor_core against the simulated hardware:
+//   pio test -e native
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unity.h>
+
+#include "alerts.h"
+#include "device_config.h"
+#include "hal_sim.h"
+#include "monitor_cycle.h"
+#include "payload.h"
+#include "sample_rollup.h"
+#include "sensor_convert.h"
+
+void setUp() {
+  simReset();
+  configDefaults(deviceConfig);
+}
+
+void tearDown() {}
+
+static SensorSample sampleOf(float tempZ1, float luxZ1, float tempZ2, float humidityZ2) {
+  SensorSample sample;
+  sample.temperatureCZ1 = tempZ1;
+  sample.luxZ1 = luxZ1;
+  sample.temperatureCZ2 = tempZ2;
+  sample.humidityZ2 = humidityZ2;
+  return sample;
+}
+
+// --- conversions ---
+
+static void test_ntc_round_trips_through_the_divider() {
+  const float temps[] = {-20.0f, 0.0f, 25.0f, 31.5f, 60.0f};
+  for (float celsius : temps) {
+    NtcReading reading = ntcCelsiusFromAdc(simAdcForCelsius(celsius));
+    TEST_ASSERT_EQUAL(NTC_OK, reading.status);
+    // One ADC code is worth up to about 0.1 C at the ends of the range.
+    TEST_ASSERT_FLOAT_WITHIN(0.15f, celsius, reading.celsius);
+  }
+}
+
+static void test_ntc_uses_the_series_resistor() {
+  // With a series resistor of twice the nominal resistance, the NTC is at
+  // its nominal resistance (so at T0, 25 C) a third of the way up the ADC.
+  deviceConfig.ntcSeriesOhm = 2 * deviceConfig.ntcNominalOhm;
+  NtcReading reading = ntcCelsiusFromAdc(1365);
+  TEST_ASSERT_EQUAL(NTC_OK, reading.status);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 25.0f, reading.celsius);
+  TEST_ASSERT_FLOAT_WITHIN(0.15f, 40.0f, ntcCelsiusFromAdc(simAdcForCelsius(40.0f)).celsius);
+}
+
+static void test_ntc_rejects_rail_codes() {
+  NtcReading low = ntcCelsiusFromAdc(0);
+  TEST_ASSERT_EQUAL(NTC_INVALID_ADC, low.status);
+  TEST_ASSERT_EQUAL_FLOAT(TEMP_INVALID, low.celsius);
+  NtcReading high = ntcCelsiusFromAdc(4095);
+  TEST_ASSERT_EQUAL(NTC_INVALID_ADC, high.status);
+  TEST_ASSERT_EQUAL_FLOAT(TEMP_INVALID, high.celsius);
+}
+
+static void test_ldr_round_trips_and_saturates() {
+  const float luxes[] = {10.0f, 100.0f, 500.0f, 5000.0f};
+  for (float lux : luxes) {
+    TEST_ASSERT_FLOAT_WITHIN(lux * 0.02f, lux, ldrLuxFromAdc(simAdcForLux(lux)));
+  }
+  TEST_ASSERT_EQUAL_FLOAT(LUX_DARK, ldrLuxFromAdc(0));
+  TEST_ASSERT_EQUAL_FLOAT(LUX_BRIGHT, ldrLuxFromAdc(4095));
+}
+
+// --- evaluateAlerts ---
+
+static void test_alerts_follow_the_thresholds() {
+  AlertThresholds limits;
+  limits.tempHigh = 30;
+  limits.lightLow = 100;
+  limits.humidityHigh = 70;
+
+  SensorSample calm = sampleOf(25, 500, 25, 50);
+  evaluateAlerts(calm, limits);
+  TEST_ASSERT_FALSE(calm.zone1Alert);
+  TEST_ASSERT_FALSE(calm.zone2Alert);
+  TEST_ASSERT_FALSE(calm.highTempAlert);
+
+  SensorSample hotZ1 = sampleOf(30.5f, 500, 25, 50);
+  evaluateAlerts(hotZ1, limits);
+  TEST_ASSERT_TRUE(hotZ1.zone1Alert);
+  TEST_ASSERT_FALSE(hotZ1.zone2Alert);
+  TEST_ASSERT_TRUE(hotZ1.highTempAlert);
+
+  SensorSample dim = sampleOf(25, 50, 25, 50);
+  evaluateAlerts(dim, limits);
+  TEST_ASSERT_TRUE(dim.zone1Alert);
+  TEST_ASSERT_FALSE(dim.highTempAlert);
+
+  SensorSample humid = sampleOf(25, 500, 25, 71);
+  evaluateAlerts(humid, limits);
+  TEST_ASSERT_FALSE(humid.zone1Alert);
+  TEST_ASSERT_TRUE(humid.zone2Alert);
+  TEST_ASSERT_FALSE(humid.highTempAlert);
+
+  SensorSample hotZ2 = sampleOf(25, 500, 31, 50);
+  evaluateAlerts(hotZ2, limits);
+  TEST_ASSERT_TRUE(hotZ2.zone2Alert);
+  TEST_ASSERT_TRUE(hotZ2.highTempAlert);
+
+  // At the threshold is not over it.
+  SensorSample edge = sampleOf(30, 100, 30, 70);
+  evaluateAlerts(edge, limits);
+  TEST_ASSERT_FALSE(edge.zone1Alert);
+  TEST_ASSERT_FALSE(edge.zone2Alert);
+}
+
+static void test_alerts_ignore_sentinels() {
+  AlertThresholds limits;
+  limits.tempHigh = -100;
+  limits.lightLow = 100000;
+  limits.humidityHigh = -100;
+
+  // Dark and bright are below any threshold but never alert.
+  SensorSample dark = sampleOf(TEMP_INVALID, LUX_DARK, DHT_NEVER_READ, DHT_NEVER_READ);
+  evaluateAlerts(dark, limits);
+  TEST_ASSERT_FALSE(dark.zone1Alert);
+  TEST_ASSERT_FALSE(dark.zone2Alert);
+  TEST_ASSERT_FALSE(dark.highTempAlert);
+
+  SensorSample bright = sampleOf(TEMP_INVALID, LUX_BRIGHT, DHT_READ_FAILED, DHT_READ_FAILED);
+  evaluateAlerts(bright, limits);
+  TEST_ASSERT_FALSE(bright.zone1Alert);
+  TEST_ASSERT_FALSE(bright.zone2Alert);
+}
+
+static void test_alerts_default_to_the_device_config() {
+  deviceConfig.tempHighC = 20;
+  SensorSample sample = sampleOf(21, 500, 19, 50);
+  evaluateAlerts(sample);
+  TEST_ASSERT_TRUE(sample.zone1Alert);
+  TEST_ASSERT_FALSE(sample.zone2Alert);
+}
+
+// --- cycleDelay ---
+
+static void test_cycle_delay_waits_out_the_interval() {
+  CycleDelay next = cycleDelay(1000, 1400, 100, 30000);
+  TEST_ASSERT_FALSE(next.overrun);
+  TEST_ASSERT_EQUAL_UINT32(30000 - 400 - 100, next.delayMs);
+
+  next = cycleDelay(1000, 31000, 0, 30000);
+  TEST_ASSERT_FALSE(next.overrun);
+  TEST_ASSERT_EQUAL_UINT32(0, next.delayMs);
+}
+
+static void test_cycle_delay_reports_an_overrun() {
+  CycleDelay next = cycleDelay(1000, 30950, 100, 30000);
+  TEST_ASSERT_TRUE(next.overrun);
+  TEST_ASSERT_EQUAL_UINT32(100, next.delayMs);
+
+  next = cycleDelay(0, 40000, 0, 30000, 250);
+  TEST_ASSERT_TRUE(next.overrun);
+  TEST_ASSERT_EQUAL_UINT32(250, next.delayMs);
+}
+
+static void test_cycle_delay_across_the_millis_rollover() {
+  CycleDelay next = cycleDelay(0xFFFFFF00u, 0x00000100u, 0, 30000);
+  TEST_ASSERT_FALSE(next.overrun);
+  TEST_ASSERT_EQUAL_UINT32(30000 - 0x200, next.delayMs);
+}
+
+// --- payload ---
+
+// The String concatenation the firmware used before payload.cpp, as in the
+// original src/main.cpp, with String(x, 1) spelled as "%.1f".
+static std::string stringPayload(const SensorSample& s) {
+  char number[32];
+  std::string json = "{";
+  json += "\"zone1\":{";
+  json += "\"tempC\":";
+  if (s.temperatureCZ1 == -999.0) {
+    json += "null";
+  } else {
+    snprintf(number, sizeof(number), "%.1f", s.temperatureCZ1);
+    json += number;
+  }
+  json += ",\"lux\":";
+  if (s.luxZ1 == -1.0) {
+    json += "\"DARK\"";
+  } else if (s.luxZ1 == 0.0) {
+    json += "\"BRIGHT\"";
+  } else {
+    snprintf(number, sizeof(number), "%d", (int)s.luxZ1);
+    json += number;
+  }
+  json += ",\"alert\":";
+  json += s.zone1Alert ? "true" : "false";
+  json += "},";
+  json += "\"zone2\":{\"dhtTempC\":";
+  if (s.temperatureCZ2 <= -998.0) {
+    json += "null";
+  } else {
+    snprintf(number, sizeof(number), "%.1f", s.temperatureCZ2);
+    json += number;
+  }
+  json += ",\"humidity\":";
+  if (s.humidityZ2 <= -998.0) {
+    json += "null";
+  } else {
+    snprintf(number, sizeof(number), "%.1f", s.humidityZ2);
+    json += number;
+  }
+  json += ",\"alert\":";
+  json += s.zone2Alert ? "true" : "false";
+  json += "},";
+  json += "\"fan_on\":";
+  json += s.highTempAlert ? "true" : "false";
+  json += "}";
+  return json;
+}
+
+// The one intended change since: lux is a number or null, next to an
+// explicit luxState ("ok", "dark" or "bright").
+static std::string withLuxState(std::string json) {
+  static const char* const STATES[][2] = {
+      {"\"lux\":\"DARK\"", "\"lux\":null,\"luxState\":\"dark\""},
+      {"\"lux\":\"BRIGHT\"", "\"lux\":null,\"luxState\":\"bright\""},
+  };
+  for (const auto& state : STATES) {
+    size_t at = json.find(state[0]);
+    if (at != std::string::npos) return json.replace(at, strlen(state[0]), state[1]);
+  }
+  size_t at = json.find(",\"alert\":");
+  return json.insert(at, ",\"luxState\":\"ok\"");
+}
+
+static void test_payload_matches_the_string_built_one() {
+  const SensorSample samples[] = {
+      sampleOf(24.26f, 312.9f, 22.5f, 48.04f),
+      sampleOf(-7.55f, 12000, -0.04f, 99.96f),
+      sampleOf(TEMP_INVALID, LUX_DARK, DHT_NEVER_READ, DHT_NEVER_READ),
+      sampleOf(31.0f, LUX_BRIGHT, DHT_READ_FAILED, DHT_READ_FAILED),
+      sampleOf(0.0f, 0.5f, 35.15f, 80.0f),
+  };
+  for (SensorSample sample : samples) {
+    evaluateAlerts(sample);
+    char buffer[PAYLOAD_BUFFER_SIZE];
+    size_t length = encodePayload(sample, buffer, sizeof(buffer));
+    std::string expected = withLuxState(stringPayload(sample));
+    TEST_ASSERT_EQUAL_size_t(expected.size(), length);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), buffer);
+  }
+}
+
+static void test_payload_refuses_a_short_buffer() {
+  SensorSample sample = sampleOf(24.3f, 312, 22.5f, 48);
+  char buffer[PAYLOAD_BUFFER_SIZE];
+  size_t length = encodePayload(sample, buffer, sizeof(buffer));
+  TEST_ASSERT_EQUAL_size_t(0, encodePayload(sample, buffer, length));
+  TEST_ASSERT_EQUAL_size_t(length, encodePayload(sample, buffer, length + 1));
+}
+
+// --- configLoad ---
+
+static void test_config_defaults_when_nothing_is_stored() {
+  TEST_ASSERT_EQUAL(CONFIG_FROM_DEFAULTS, configLoad());
+  DeviceConfig defaults;
+  configDefaults(defaults);
+  TEST_ASSERT_EQUAL_MEMORY(&defaults, &deviceConfig, sizeof(defaults));
+}
+
+static void test_config_loads_a_stored_blob() {
+  DeviceConfig blob;
+  configDefaults(blob);
+  blob.tempHighC = 27.5f;
+  blob.crc = configCrc(blob);
+  simSetStoredConfig(&blob, sizeof(blob));
+
+  TEST_ASSERT_EQUAL(CONFIG_FROM_STORE, configLoad());
+  TEST_ASSERT_EQUAL_FLOAT(27.5f, deviceConfig.tempHighC);
+}
+
+static void expectRejected(const DeviceConfig& blob, size_t length) {
+  simSetStoredConfig(&blob, length);
+  TEST_ASSERT_EQUAL(CONFIG_REJECTED, configLoad());
+  DeviceConfig defaults;
+  configDefaults(defaults);
+  TEST_ASSERT_EQUAL_MEMORY(&defaults, &deviceConfig, sizeof(defaults));
+  // The stored blob is left for inspection, not overwritten.
+  size_t storedLength;
+  const uint8_t* stored = simStoredConfig(storedLength);
+  TEST_ASSERT_EQUAL_size_t(length, storedLength);
+  TEST_ASSERT_EQUAL_MEMORY(&blob, stored, length);
+}
+
+static void test_config_rejects_a_bad_blob() {
+  DeviceConfig blob;
+  configDefaults(blob);
+  blob.tempHighC = 27.5f;  // CRC not updated
+  expectRejected(blob, sizeof(blob));
+
+  configDefaults(blob);
+  blob.version = CONFIG_VERSION + 1;
+  blob.crc = configCrc(blob);
+  expectRejected(blob, sizeof(blob));
+
+  configDefaults(blob);
+  blob.size = sizeof(blob) - 8;  // a current version must be stored whole
+  blob.crc = configCrc(blob);
+  expectRejected(blob, sizeof(blob) - 8);
+
+  configDefaults(blob);
+  blob.redLedPin = 36;  // input only
+  blob.crc = configCrc(blob);
+  expectRejected(blob, sizeof(blob));
+}
+
+static void test_config_rejects_version_zero() {
+  // No firmware wrote version 0, so neither a whole blob nor a prefix that
+  // would otherwise load over the defaults is taken for an older layout.
+  DeviceConfig blob;
+  configDefaults(blob);
+  blob.version = 0;
+  blob.crc = configCrc(blob);
+  expectRejected(blob, sizeof(blob));
+
+  configDefaults(blob);
+  blob.version = 0;
+  blob.size = offsetof(DeviceConfig, serverUrl);
+  blob.crc = configCrc(blob);
+  expectRejected(blob, blob.size);
+}
+
+// The internal-RAM sizing of src/main.cpp.
+static HistoryRecord historyRecords[HISTORY_CHANNELS * 480];
+static uint32_t historyIndex[HISTORY_CHANNELS * 480 / HISTORY_INDEX_STRIDE];
+static RollupBucket minuteBuckets[HISTORY_CHANNELS * 30];
+static RollupBucket quarterBuckets[HISTORY_CHANNELS * 80];
+
+static void test_history_span_covers_the_raw_ring_and_rollups() {
+  SampleHistory history;
+  historyBegin(history, historyRecords, historyIndex, 480);
+  TEST_ASSERT_EQUAL_UINT32(4 * 3600000UL, historyRawSpanMs(history, 30000));
+  TEST_ASSERT_EQUAL_UINT32(4 * 3600000UL, historySpanMs(history, 30000));
+
+  SampleRollup rollup;
+  RollupBucket* const storage[ROLLUP_LEVELS] = {minuteBuckets, quarterBuckets};
+  const size_t capacity[ROLLUP_LEVELS] = {30, 80};
+  rollupBegin(rollup, storage, capacity);
+  historyAttachRollup(history, &rollup);
+  TEST_ASSERT_EQUAL_UINT32(4 * 3600000UL, historyRawSpanMs(history, 30000));
+  TEST_ASSERT_EQUAL_UINT32((240 + 30 + 80 * 15) * 60000UL, historySpanMs(history, 30000));
+
+  // Two hours per cycle would reach past the millis() rollover limit.
+  TEST_ASSERT_EQUAL_UINT32(HISTORY_MAX_SPAN_MS, historySpanMs(history, 7200000));
+}
+
+// Capacity 64 is two index blocks; 100 records a second apart leave 36..99
+// in the ring, wrapping after slot 63 (record 63).
+static void fillWrappedHistory(SampleHistory& history) {
+  historyBegin(history, historyRecords, historyIndex, 64);
+  for (uint32_t i = 0; i < 100; i++) historyAppend(history, HISTORY_TEMP_Z1, i * 1000, (int16_t)i, 0);
+}
+
+static void test_history_window_across_the_wrap_point() {
+  SampleHistory history;
+  fillWrappedHistory(history);
+
+  HistoryRange range = historySince(history, HISTORY_TEMP_Z1, 50000);
+  TEST_ASSERT_EQUAL_size_t(14, range.firstCount);
+  TEST_ASSERT_EQUAL_size_t(36, range.secondCount);
+  for (size_t i = 0; i < range.size(); i++) TEST_ASSERT_EQUAL_UINT32(50000 + i * 1000, range[i].timeMs);
+
+  HistoryStats stats = historyStats(HISTORY_TEMP_Z1, historyLast(history, HISTORY_TEMP_Z1, 99000, 49000));
+  TEST_ASSERT_EQUAL_size_t(50, stats.count);
+  TEST_ASSERT_EQUAL_FLOAT(historyValue(HISTORY_TEMP_Z1, 50), stats.min);
+  TEST_ASSERT_EQUAL_FLOAT(historyValue(HISTORY_TEMP_Z1, 99), stats.max);
+
+  // Older than the ring: everything left, oldest first.
+  range = historySince(history, HISTORY_TEMP_Z1, 0);
+  TEST_ASSERT_EQUAL_size_t(64, range.size());
+  TEST_ASSERT_EQUAL_UINT32(36000, range[0].timeMs);
+
+  // Past the wrap point only the second segment is left.
+  range = historySince(history, HISTORY_TEMP_Z1, 70000);
+  TEST_ASSERT_EQUAL_size_t(30, range.size());
+  TEST_ASSERT_EQUAL_UINT32(70000, range[0].timeMs);
+}
+
+static void test_history_window_between_index_entries() {
+  SampleHistory history;
+  historyBegin(history, historyRecords, historyIndex, 64);
+  for (uint32_t i = 0; i < 64; i++) historyAppend(history, HISTORY_TEMP_Z1, i * 1000, (int16_t)i, 0);
+
+  // Index entries sit at records 0 and 32; every start between them, on a
+  // record or between two, lands on the first record at or after it.
+  for (uint32_t sinceMs = 500; sinceMs < 64000; sinceMs += 500) {
+    HistoryRange range = historySince(history, HISTORY_TEMP_Z1, sinceMs);
+    uint32_t first = (sinceMs + 999) / 1000;
+    TEST_ASSERT_EQUAL_size_t(64 - first, range.size());
+    if (range.size()) TEST_ASSERT_EQUAL_UINT32(first * 1000, range[0].timeMs);
+  }
+
+  // The same once the ring has wrapped: slot 32 now holds record 96.
+  fillWrappedHistory(history);
+  HistoryRange range = historySince(history, HISTORY_TEMP_Z1, 80500);
+  TEST_ASSERT_EQUAL_size_t(19, range.size());
+  TEST_ASSERT_EQUAL_UINT32(81000, range[0].timeMs);
+  range = historySince(history, HISTORY_TEMP_Z1, 40500);
+  TEST_ASSERT_EQUAL_size_t(59, range.size());
+  TEST_ASSERT_EQUAL_UINT32(41000, range[0].timeMs);
+}
+
+static void test_rollup_buckets_split_at_the_quarter_boundary() {
+  // No raw ring, so every record goes straight to the minute buckets; with
+  // two of those, minutes 10 to 16 have moved up a level by minute 19.
+  SampleHistory history;
+  historyBegin(history, nullptr, nullptr, 0);
+  SampleRollup rollup;
+  RollupBucket* const storage[ROLLUP_LEVELS] = {minuteBuckets, quarterBuckets};
+  const size_t capacity[ROLLUP_LEVELS] = {2, 4};
+  rollupBegin(rollup, storage, capacity);
+  historyAttachRollup(history, &rollup);
+  for (uint32_t t = 600000; t < 1200000; t += 30000) {
+    historyAppend(history, HISTORY_TEMP_Z1, t, (int16_t)(t / 60000), t < 900000 ? HISTORY_ALERT : 0);
+  }
+
+  // Minutes 10-14 and 15-16 sit either side of 15:00, in separate buckets.
+  const RollupRing& quarters = rollup.rings[1][HISTORY_TEMP_Z1];
+  TEST_ASSERT_EQUAL_size_t(1, quarters.count);
+  TEST_ASSERT_EQUAL_UINT32(0, quarters.buckets[0].startMs);
+  TEST_ASSERT_EQUAL_UINT16(10, quarters.buckets[0].count);
+  TEST_ASSERT_EQUAL(14, quarters.buckets[0].max);
+  TEST_ASSERT_EQUAL_UINT16(10, quarters.buckets[0].alerts);
+  TEST_ASSERT_EQUAL_UINT32(900000, quarters.open.startMs);
+  TEST_ASSERT_EQUAL_UINT16(4, quarters.open.count);
+  TEST_ASSERT_EQUAL(15, quarters.open.min);
+
+  // A window starting at 14:00 takes all of the 0-15 bucket; one starting at
+  // 15:00 none of it, and one at 16:00 all of the 15-30 bucket.
+  HistoryStats stats = historyWindowStats(history, HISTORY_TEMP_Z1, 1200000, 360000);
+  TEST_ASSERT_EQUAL_size_t(20, stats.count);
+  TEST_ASSERT_EQUAL_size_t(10, stats.alerts);
+  TEST_ASSERT_EQUAL_FLOAT(historyValue(HISTORY_TEMP_Z1, 10), stats.min);
+  TEST_ASSERT_EQUAL_FLOAT(historyValue(HISTORY_TEMP_Z1, 145) / 10, stats.mean);
+
+  stats = historyWindowStats(history, HISTORY_TEMP_Z1, 1200000, 300000);
+  TEST_ASSERT_EQUAL_size_t(10, stats.count);
+  TEST_ASSERT_EQUAL_size_t(0, stats.alerts);
+  TEST_ASSERT_EQUAL_FLOAT(historyValue(HISTORY_TEMP_Z1, 15), stats.min);
+
+  stats = historyWindowStats(history, HISTORY_TEMP_Z1, 1200000, 240000);
+  TEST_ASSERT_EQUAL_size_t(10, stats.count);
+  TEST_ASSERT_EQUAL_FLOAT(historyValue(HISTORY_TEMP_Z1, 15), stats.min);
+  TEST_ASSERT_EQUAL_FLOAT(historyValue(HISTORY_TEMP_Z1, 19), stats.max);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ntc_round_trips_through_the_divider);
+  RUN_TEST(test_ntc_uses_the_series_resistor);
+  RUN_TEST(test_ntc_rejects_rail_codes);
+  RUN_TEST(test_ldr_round_trips_and_saturates);
+  RUN_TEST(test_alerts_follow_the_thresholds);
+  RUN_TEST(test_alerts_ignore_sentinels);
+  RUN_TEST(test_alerts_default_to_the_device_config);
+  RUN_TEST(test_cycle_delay_waits_out_the_interval);
+  RUN_TEST(test_cycle_delay_reports_an_overrun);
+  RUN_TEST(test_cycle_delay_across_the_millis_rollover);
+  RUN_TEST(test_payload_matches_the_string_built_one);
+  RUN_TEST(test_payload_refuses_a_short_buffer);
+  RUN_TEST(test_config_defaults_when_nothing_is_stored);
+  RUN_TEST(test_config_loads_a_stored_blob);
+  RUN_TEST(test_config_rejects_a_bad_blob);
+  RUN_TEST(test_config_rejects_version_zero);
+  RUN_TEST(test_history_span_covers_the_raw_ring_and_rollups);
+  RUN_TEST(test_history_window_across_the_wrap_point);
+  RUN_TEST(test_history_window_between_index_entries);
+  RUN_TEST(test_rollup_buckets_split_at_the_quarter_boundary);
+  return UNITY_END();
+}
@@ -0,0 +1,213 @@
+// Microbenchmarks for the per-cycle kernels in lib/monitor_core: NTC and LDR
+// conversion, alert evaluation, payload encoding and LCD line formatting.
+//
+//   pio run -e bench_native && .pio/build/bench_native/program
+//   pio run -e bench_esp32 -t upload && pio device monitor
+//
+// Each kernel is timed over a batch of calls, best and median of several
+// batches are kept, and results are printed as one JSON object per line so
+// runs from different firmware versions can be diffed or plotted.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "alerts.h"
+#include "lcd_format.h"
+#include "monitor_config.h"
+#include "payload.h"
+#include "sensor_convert.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#define BENCH_TARGET "esp32"
+static const uint32_t BATCH_CALLS = 2000;
+#else
+#include <chrono>
+#define BENCH_TARGET "native"
+static const uint32_t BATCH_CALLS = 200000;
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+static const int BATCHES = 7;
+static const int INPUT_COUNT = 64;
+
+static int adcInputs[INPUT_COUNT];
+static SensorSample sampleInputs[INPUT_COUNT];
+static volatile float floatSink;
+static volatile uint32_t intSink;
+
+struct Timestamp {
+  uint64_t ns;
+  uint64_t cycles;
+};
+
+static Timestamp now() {
+  Timestamp t;
+#ifdef ARDUINO
+  t.cycles = ESP.getCycleCount();
+  t.ns = (uint64_t)micros() * 1000;
+#else
+  t.ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+#if defined(__x86_64__) || defined(__i386__)
+  t.cycles = __rdtsc();
+#else
+  t.cycles = 0;
+#endif
+#endif
+  return t;
+}
+
+// Wraps 32-bit on the ESP32 (fine for one batch) and is the TSC on x86.
+static uint64_t cyclesBetween(const Timestamp& a, const Timestamp& b) {
+#ifdef ARDUINO
+  return (uint32_t)((uint32_t)b.cycles - (uint32_t)a.cycles);
+#else
+  return b.cycles - a.cycles;
+#endif
+}
+
+static void prepareInputs() {
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    adcInputs[i] = 1 + (i * 4093) / (INPUT_COUNT - 1);
+
+    SensorSample& s = sampleInputs[i];
+    NtcReading ntc = ntcCelsiusFromAdc(adcInputs[i]);
+    s.temperatureCZ1 = ntc.celsius;
+    s.luxZ1 = ldrLuxFromAdc(adcInputs[(i * 7) % INPUT_COUNT]);
+    s.temperatureCZ2 = (i % 11 == 0) ? DHT_READ_FAILED : 15.0f + i * 0.4f;
+    s.humidityZ2 = (i % 11 == 0) ? DHT_READ_FAILED : 30.0f + i;
+    evaluateAlerts(s);
+  }
+}
+
+static void benchNtc(uint32_t calls) {
+  float acc = 0;
+  for (uint32_t i = 0; i < calls; i++) acc += ntcCelsiusFromAdc(adcInputs[i % INPUT_COUNT]).celsius;
+  floatSink = acc;
+}
+
+static void benchLux(uint32_t calls) {
+  float acc = 0;
+  for (uint32_t i = 0; i < calls; i++) acc += ldrLuxFromAdc(adcInputs[i % INPUT_COUNT]);
+  floatSink = acc;
+}
+
+static void benchAlerts(uint32_t calls) {
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < calls; i++) {
+    SensorSample& s = sampleInputs[i % INPUT_COUNT];
+    evaluateAlerts(s);
+    acc += s.zone1Alert + s.zone2Alert + s.highTempAlert;
+  }
+  intSink = acc;
+}
+
+static void benchPayload(uint32_t calls) {
+  char buffer[PAYLOAD_BUFFER_SIZE];
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < calls; i++) acc += encodePayload(sampleInputs[i % INPUT_COUNT], buffer, sizeof(buffer));
+  intSink = acc;
+}
+
+static void benchLcd(uint32_t calls) {
+  char lcd1[LCD1_ROWS][LCD_LINE_BUFFER];
+  char lcd2[LCD2_ROWS][LCD_LINE_BUFFER];
+  uint32_t acc = 0;
+  for (uint32_t i = 0; i < calls; i++) {
+    const SensorSample& s = sampleInputs[i % INPUT_COUNT];
+    formatLcd1(s, lcd1);
+    formatLcd2(s, (i & 1) != 0, lcd2);
+    acc += (uint8_t)lcd1[0][0] + (uint8_t)lcd2[3][0];
+  }
+  intSink = acc;
+}
+
+struct Kernel {
+  const char* name;
+  void (*run)(uint32_t calls);
+  uint32_t callScale;
+};
+
+// Payload and LCD formatting are ~100x the cost of the conversions, so they
+// run fewer calls per batch to keep each batch in the same time range.
+static const Kernel KERNELS[] = {
+  {"ntc_convert", benchNtc, 1},
+  {"lux_convert", benchLux, 1},
+  {"alert_eval", benchAlerts, 1},
+  {"payload_encode", benchPayload, 20},
+  {"lcd_format", benchLcd, 20},
+};
+
+static void sortAscending(double* values, int count) {
+  for (int i = 1; i < count; i++) {
+    double v = values[i];
+    int j = i - 1;
+    while (j >= 0 && values[j] > v) {
+      values[j + 1] = values[j];
+      j--;
+    }
+    values[j + 1] = v;
+  }
+}
+
+static void runKernel(const Kernel& kernel, char* line, size_t lineSize) {
+  uint32_t calls = BATCH_CALLS / kernel.callScale;
+  double nsPerCall[BATCHES];
+  double cyclesPerCall[BATCHES];
+
+  kernel.run(calls / 10 + 1);
+  for (int b = 0; b < BATCHES; b++) {
+    Timestamp start = now();
+    kernel.run(calls);
+    Timestamp end = now();
+    nsPerCall[b] = (double)(end.ns - start.ns) / calls;
+    cyclesPerCall[b] = (double)cyclesBetween(start, end) / calls;
+  }
+  sortAscending(nsPerCall, BATCHES);
+  sortAscending(cyclesPerCall, BATCHES);
+
+  snprintf(line, lineSize,
+           "{\"suite\":\"kernels\",\"target\":\"%s\",\"firmware\":\"%s\",\"kernel\":\"%s\","
+           "\"calls\":%lu,\"batches\":%d,\"ns_per_call_min\":%.2f,\"ns_per_call_median\":%.2f,"
+           "\"cycles_per_call_min\":%.1f,\"cycles_per_call_median\":%.1f}",
+           BENCH_TARGET, FIRMWARE_VERSION, kernel.name, (unsigned long)calls, BATCHES,
+           nsPerCall[0], nsPerCall[BATCHES / 2], cyclesPerCall[0], cyclesPerCall[BATCHES / 2]);
+}
+
+static void runAll(void (*emit)(const char* line)) {
+  char line[384];
+  prepareInputs();
+  for (const Kernel& kernel : KERNELS) {
+    runKernel(kernel, line, sizeof(line));
+    emit(line);
+  }
+}
+
+#ifdef ARDUINO
+static void emitSerial(const char* line) {
+  Serial.println(line);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  runAll(emitSerial);
+  Serial.println("{\"suite\":\"kernels\",\"done\":true}");
+}
+
+void loop() {
+  delay(1000);
+}
+#else
+static void emitStdout(const char* line) {
+  puts(line);
+}
+
+int main() {
+  runAll(emitStdout);
+  return 0;
+}
+#endif
@@ -0,0 +1,290 @@
+// Scaling benchmark: one monitoring cycle over N simulated zones, N = 2..256.
+//
+//   pio run -e bench_zones_native && .pio/build/bench_zones_native/program > zones.jsonl
+//   pio run -e bench_zones_esp32 -t upload && pio device monitor
+//
+// Zones come in pairs shaped like the board's two: an odd analog zone (NTC +
+// LDR) and an even climate zone (DHT22), each pair held in one SensorSample.
+// A cycle converts synthetic ADC codes and climate readings through the
+// firmware's sampling code, evaluates alerts, encodes one payload with a
+// "zone<N>" object per zone, and renders every zone's LCD line as a paged
+// display would. Hardware reads are left out so the numbers are CPU only.
+//
+// One JSON object per N: best and median cycle time, the median time of each
+// stage, payload size, and the RAM the zone state, payload and LCD lines
+// need (on the ESP32 also the measured drop in free heap). For N = 2 the
+// payload is checked against encodePayload().
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alerts.h"
+#include "lcd_format.h"
+#include "monitor_config.h"
+#include "monitor_cycle.h"
+#include "payload.h"
+#include "sensor_convert.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#define BENCH_TARGET "esp32"
+static const int CYCLES_PER_BATCH = 4;
+#else
+#include <chrono>
+#define BENCH_TARGET "native"
+static const int CYCLES_PER_BATCH = 50;
+#endif
+
+static const int BATCHES = 7;
+static const int MAX_ZONES = 256;
+static const int INPUT_VARIANTS = 8;
+
+// Roughly 60 bytes per zone object plus the fan flag.
+static const size_t ZONE_PAYLOAD_BYTES = 72;
+
+enum Stage {
+  STAGE_SAMPLE,
+  STAGE_ALERTS,
+  STAGE_ENCODE,
+  STAGE_LCD,
+  STAGE_COUNT
+};
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = {"sample", "alerts", "encode", "lcd"};
+
+struct ZoneInputs {
+  int ntcRaw;
+  int ldrRaw;
+  bool climateOk;
+  float temperature;
+  float humidity;
+};
+
+struct ZoneBank {
+  int zones;
+  int pairs;
+  SensorSample* samples;
+  ZoneInputs* inputs;  // pairs * INPUT_VARIANTS
+  char* payload;
+  size_t payloadCapacity;
+  char (*lcdLines)[LCD_LINE_BUFFER];
+  bool fanOn;
+  size_t payloadLength;
+};
+
+static volatile uint32_t sink;
+
+static uint64_t nowNs() {
+#ifdef ARDUINO
+  return (uint64_t)micros() * 1000;
+#else
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static size_t bankBytes(int zones) {
+  int pairs = zones / 2;
+  return pairs * sizeof(SensorSample) + zones * ZONE_PAYLOAD_BYTES + 16 + zones * LCD_LINE_BUFFER;
+}
+
+static bool allocBank(ZoneBank& bank, int zones) {
+  bank.zones = zones;
+  bank.pairs = zones / 2;
+  bank.payloadCapacity = zones * ZONE_PAYLOAD_BYTES + 16;
+  bank.samples = new SensorSample[bank.pairs];
+  bank.inputs = (ZoneInputs*)malloc(sizeof(ZoneInputs) * bank.pairs * INPUT_VARIANTS);
+  bank.payload = (char*)malloc(bank.payloadCapacity);
+  bank.lcdLines = (char(*)[LCD_LINE_BUFFER])malloc((size_t)zones * LCD_LINE_BUFFER);
+  return bank.samples && bank.inputs && bank.payload && bank.lcdLines;
+}
+
+static void freeBank(ZoneBank& bank) {
+  delete[] bank.samples;
+  free(bank.inputs);
+  free(bank.payload);
+  free(bank.lcdLines);
+}
+
+// Spreads readings across the ADC range so every branch of the conversion,
+// alert and formatting code is taken somewhere in the fleet.
+static void fillInputs(ZoneBank& bank) {
+  uint32_t state = 12345;
+  for (int i = 0; i < bank.pairs * INPUT_VARIANTS; i++) {
+    state = state * 1664525u + 1013904223u;
+    ZoneInputs& in = bank.inputs[i];
+    in.ntcRaw = 1 + (int)((state >> 8) % 4094);
+    in.ldrRaw = (int)((state >> 4) % 4096);
+    in.climateOk = (state >> 20) % 23 != 0;
+    in.temperature = 15.0f + (float)((state >> 12) % 250) / 10.0f;
+    in.humidity = 30.0f + (float)((state >> 16) % 600) / 10.0f;
+  }
+}
+
+static void sampleZones(ZoneBank& bank, int variant) {
+  const ZoneInputs* inputs = bank.inputs + variant * bank.pairs;
+  for (int p = 0; p < bank.pairs; p++) {
+    const ZoneInputs& in = inputs[p];
+    convertAnalogZone(bank.samples[p], in.ntcRaw, in.ldrRaw);
+    storeClimateReading(bank.samples[p], in.climateOk, in.temperature, in.humidity, in.climateOk ? 0 : 1);
+  }
+}
+
+static void evaluateZones(ZoneBank& bank) {
+  bank.fanOn = false;
+  for (int p = 0; p < bank.pairs; p++) {
+    evaluateAlerts(bank.samples[p]);
+    bank.fanOn = bank.fanOn || bank.samples[p].highTempAlert;
+  }
+}
+
+static void encodeZones(ZoneBank& bank) {
+  JsonWriter json(bank.payload, bank.payloadCapacity);
+  json.raw('{');
+  for (int p = 0; p < bank.pairs; p++) {
+    if (p > 0) json.raw(',');
+    appendAnalogZone(json, bank.samples[p], 2 * p + 1);
+    json.raw(',');
+    appendClimateZone(json, bank.samples[p], 2 * p + 2);
+  }
+  json.raw(",\"fan_on\":");
+  json.boolean(bank.fanOn);
+  endPayload(json);
+  bank.payloadLength = json.ok() ? json.length() : 0;
+}
+
+static void renderZones(ZoneBank& bank) {
+  for (int p = 0; p < bank.pairs; p++) {
+    formatAnalogZoneLine(bank.samples[p], 2 * p + 1, bank.lcdLines[2 * p]);
+    formatClimateZoneLine(bank.samples[p], 2 * p + 2, bank.lcdLines[2 * p + 1]);
+  }
+  sink = (uint8_t)bank.lcdLines[bank.zones - 1][1];
+}
+
+static void sortAscending(double* values, int count) {
+  for (int i = 1; i < count; i++) {
+    double v = values[i];
+    int j = i - 1;
+    while (j >= 0 && values[j] > v) {
+      values[j + 1] = values[j];
+      j--;
+    }
+    values[j + 1] = v;
+  }
+}
+
+static bool checkTwoZonePayload(ZoneBank& bank) {
+  char expected[PAYLOAD_BUFFER_SIZE];
+  SensorSample sample = bank.samples[0];
+  sample.highTempAlert = bank.fanOn;
+  size_t length = encodePayload(sample, expected, sizeof(expected));
+  return length == bank.payloadLength && memcmp(expected, bank.payload, length) == 0;
+}
+
+static void runZones(int zones, char* line, size_t lineSize) {
+#ifdef ARDUINO
+  uint32_t heapBefore = ESP.getFreeHeap();
+#endif
+  ZoneBank bank;
+  if (!allocBank(bank, zones)) {
+    snprintf(line, lineSize, "{\"suite\":\"zones\",\"target\":\"%s\",\"firmware\":\"%s\",\"zones\":%d,\"error\":\"alloc\"}",
+             BENCH_TARGET, FIRMWARE_VERSION, zones);
+    freeBank(bank);
+    return;
+  }
+#ifdef ARDUINO
+  uint32_t heapUsed = heapBefore - ESP.getFreeHeap();
+#endif
+  fillInputs(bank);
+
+  double cycleUs[BATCHES];
+  double stageUs[STAGE_COUNT][BATCHES];
+  int variant = 0;
+
+  // Warm-up cycle, also the one checked against the two-zone encoder.
+  sampleZones(bank, variant);
+  evaluateZones(bank);
+  encodeZones(bank);
+  renderZones(bank);
+  bool payloadMatches = zones != 2 || checkTwoZonePayload(bank);
+
+  for (int b = 0; b < BATCHES; b++) {
+    uint64_t stageNs[STAGE_COUNT] = {};
+    uint64_t batchStart = nowNs();
+    for (int c = 0; c < CYCLES_PER_BATCH; c++) {
+      variant = (variant + 1) % INPUT_VARIANTS;
+      uint64_t t0 = nowNs();
+      sampleZones(bank, variant);
+      uint64_t t1 = nowNs();
+      evaluateZones(bank);
+      uint64_t t2 = nowNs();
+      encodeZones(bank);
+      uint64_t t3 = nowNs();
+      renderZones(bank);
+      uint64_t t4 = nowNs();
+      stageNs[STAGE_SAMPLE] += t1 - t0;
+      stageNs[STAGE_ALERTS] += t2 - t1;
+      stageNs[STAGE_ENCODE] += t3 - t2;
+      stageNs[STAGE_LCD] += t4 - t3;
+    }
+    cycleUs[b] = (double)(nowNs() - batchStart) / CYCLES_PER_BATCH / 1000.0;
+    for (int s = 0; s < STAGE_COUNT; s++) stageUs[s][b] = (double)stageNs[s] / CYCLES_PER_BATCH / 1000.0;
+  }
+  sortAscending(cycleUs, BATCHES);
+  for (int s = 0; s < STAGE_COUNT; s++) sortAscending(stageUs[s], BATCHES);
+
+  int n = snprintf(line, lineSize,
+                   "{\"suite\":\"zones\",\"target\":\"%s\",\"firmware\":\"%s\",\"zones\":%d,\"cycles\":%d,"
+                   "\"cycle_us_min\":%.2f,\"cycle_us_median\":%.2f",
+                   BENCH_TARGET, FIRMWARE_VERSION, zones, CYCLES_PER_BATCH * BATCHES,
+                   cycleUs[0], cycleUs[BATCHES / 2]);
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    n += snprintf(line + n, lineSize - n, ",\"%s_us\":%.2f", STAGE_NAMES[s], stageUs[s][BATCHES / 2]);
+  }
+  n += snprintf(line + n, lineSize - n,
+                ",\"payload_bytes\":%u,\"fits_payload_buffer\":%s,\"state_bytes\":%u,\"ram_bytes\":%u",
+                (unsigned)bank.payloadLength, bank.payloadLength < PAYLOAD_BUFFER_SIZE ? "true" : "false",
+                (unsigned)(bank.pairs * sizeof(SensorSample)), (unsigned)bankBytes(zones));
+#ifdef ARDUINO
+  n += snprintf(line + n, lineSize - n, ",\"heap_used\":%u", (unsigned)heapUsed);
+#endif
+  if (!payloadMatches) n += snprintf(line + n, lineSize - n, ",\"error\":\"payload mismatch\"");
+  snprintf(line + n, lineSize - n, "}");
+  freeBank(bank);
+}
+
+static void runAll(void (*emit)(const char* line)) {
+  char line[512];
+  for (int zones = 2; zones <= MAX_ZONES; zones *= 2) {
+    runZones(zones, line, sizeof(line));
+    emit(line);
+  }
+}
+
+#ifdef ARDUINO
+static void emitSerial(const char* line) {
+  Serial.println(line);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  runAll(emitSerial);
+  Serial.println("{\"suite\":\"zones\",\"done\":true}");
+}
+
+void loop() {
+  delay(1000);
+}
+#else
+static void emitStdout(const char* line) {
+  puts(line);
+}
+
+int main() {
+  runAll(emitStdout);
+  return 0;
+}
+#endif
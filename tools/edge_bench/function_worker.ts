@@ -0,0 +1,127 @@
+// One edge isolate for load_test.ts. Imports a function module the way the
+// runtime does (its serve() call is mapped to serve_stub.ts) and runs
+// requests against the exported handler on command. fetch is confined to
+// the local stubs: ntfy.sh is sent to the ntfy stub and any other remote
+// host is refused, so a run can never reach a real backend.
+//
+//   {type: 'load', module, ntfyUrl}               -> {type: 'loaded', importMs}
+//   {type: 'run', payload, requests, concurrency}  -> {type: 'result', latenciesMs, elapsedMs, statuses, readings}
+//   {type: 'alloc', payload, chunks, chunkSize}    -> {type: 'alloc', bytesPerRequest, retainedPerRequest}
+//   {type: 'call', url, body}                      -> {type: 'called', ms, status, body}
+
+import { type GeneratedRequest, PayloadGenerator, type PayloadOptions } from './payloads.ts'
+
+const nativeFetch = globalThis.fetch
+let ntfyUrl = ''
+let handleRequest: ((req: Request) => Promise<Response>) | null = null
+// One fleet per isolate, so sequence numbers carry on from run to run.
+let generator: PayloadGenerator | null = null
+
+function fleet(options: PayloadOptions): PayloadGenerator {
+  if (!generator) generator = new PayloadGenerator(options)
+  return generator
+}
+
+globalThis.fetch = (input: Request | URL | string, init?: RequestInit) => {
+  const url = new URL(input instanceof Request ? input.url : String(input))
+  if (url.hostname === 'ntfy.sh') {
+    const local = ntfyUrl + url.pathname
+    return input instanceof Request ? nativeFetch(new Request(local, input)) : nativeFetch(local, init)
+  }
+  if (url.hostname !== '127.0.0.1' && url.hostname !== 'localhost') {
+    return Promise.reject(new Error(`load test is offline: refused fetch to ${url.host}`))
+  }
+  return nativeFetch(input, init)
+}
+
+function toRequest(generated: GeneratedRequest): Request {
+  return new Request('http://localhost/functions/v1/log-sensor-data', {
+    method: 'POST',
+    headers: generated.headers,
+    body: generated.body
+  })
+}
+
+async function serveOne(generated: GeneratedRequest): Promise<number> {
+  const response = await handleRequest!(toRequest(generated))
+  await response.arrayBuffer()
+  return response.status
+}
+
+// Payloads are generated (and signed) before the clock starts.
+async function generate(source: PayloadGenerator, count: number): Promise<GeneratedRequest[]> {
+  const out = []
+  for (let i = 0; i < count; i++) out.push(await source.nextRequest())
+  return out
+}
+
+async function run(message: any) {
+  const requests = await generate(fleet(message.payload), message.requests)
+  const latenciesMs = new Array<number>(requests.length)
+  const statuses: Record<string, number> = {}
+  let next = 0
+  const started = performance.now()
+  const worker = async () => {
+    while (next < requests.length) {
+      const index = next++
+      const begin = performance.now()
+      const status = await serveOne(requests[index])
+      latenciesMs[index] = performance.now() - begin
+      statuses[status] = (statuses[status] ?? 0) + 1
+    }
+  }
+  await Promise.all(Array.from({ length: Math.max(1, message.concurrency) }, worker))
+  const elapsedMs = performance.now() - started
+  const readings = requests.reduce((sum, request) => sum + request.readings, 0)
+  self.postMessage({ type: 'result', latenciesMs, elapsedMs, statuses, readings })
+}
+
+// Heap growth over a chunk of sequential requests between forced
+// collections: what a request allocates, as long as no collection runs
+// inside the chunk (chunks are kept small for that). Needs --expose-gc.
+async function alloc(message: any) {
+  const gc = (globalThis as any).gc as (() => void) | undefined
+  if (!gc) {
+    self.postMessage({ type: 'alloc', bytesPerRequest: null, retainedPerRequest: null })
+    return
+  }
+  const generator = fleet(message.payload)
+  const samples: number[] = []
+  gc()
+  const start = Deno.memoryUsage().heapUsed
+  for (let chunk = 0; chunk < message.chunks; chunk++) {
+    const requests = await generate(generator, message.chunkSize)
+    gc()
+    const before = Deno.memoryUsage().heapUsed
+    for (const request of requests) await serveOne(request)
+    samples.push((Deno.memoryUsage().heapUsed - before) / message.chunkSize)
+  }
+  // Let background work (alert state calls) finish before the retained count.
+  await new Promise((resolve) => setTimeout(resolve, 50))
+  gc()
+  const retained = (Deno.memoryUsage().heapUsed - start) / (message.chunks * message.chunkSize)
+  samples.sort((a, b) => a - b)
+  self.postMessage({ type: 'alloc', bytesPerRequest: samples[Math.floor(samples.length / 2)], retainedPerRequest: retained })
+}
+
+self.onmessage = async (event: MessageEvent) => {
+  const message = event.data
+  if (message.type === 'load') {
+    ntfyUrl = message.ntfyUrl
+    const begin = performance.now()
+    const module = await import(message.module)
+    handleRequest = module.handleRequest
+    self.postMessage({ type: 'loaded', importMs: performance.now() - begin })
+  } else if (message.type === 'run') {
+    await run(message)
+  } else if (message.type === 'alloc') {
+    await alloc(message)
+  } else if (message.type === 'call') {
+    const begin = performance.now()
+    const response = await handleRequest!(new Request(message.url, { method: 'POST', body: message.body }))
+    const body = await response.text()
+    self.postMessage({ type: 'called', ms: performance.now() - begin, status: response.status, body })
+  }
+}
+
+self.postMessage({ type: 'ready' })
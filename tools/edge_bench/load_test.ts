@@ -0,0 +1,243 @@
+// Offline load test of the log-sensor-data handler, with a local PostgREST
+// and ntfy (stub_servers.ts) and firmware-shaped payloads (payloads.ts):
+//
+//   deno run --allow-env --allow-read --allow-net=127.0.0.1 --v8-flags=--expose-gc \
+//     --import-map tools/edge_bench/import_map.json tools/edge_bench/load_test.ts \
+//     [--requests 2000] [--concurrency 20] [--warmup 200] [--devices 50] [--batch 1]
+//     [--alert-rate 0.05] [--diagnostics-every 10] [--full] [--sign] [--seed 42]
+//     [--db-latency-ms 0] [--ntfy-latency-ms 0] [--cold-runs 5] [--no-drain] [--json]
+//
+// Reports, for one isolate at a time:
+//
+//   throughput   requests and readings per second over the timed run
+//   latency      p50/p95/p99/max from request to fully read response
+//   cold start   a fresh isolate: worker boot, module import (supabase-js
+//                included) and its first request, against warm requests in
+//                the same isolate; medians over --cold-runs isolates
+//   allocation   heap allocated per request between forced collections, and
+//                what stays allocated afterwards (needs --expose-gc)
+//   drain        one notify-drain pass over the pushes the run queued
+//
+// The stubs answer without delay unless --db-latency-ms/--ntfy-latency-ms
+// are given, so the numbers are the functions' own cost. --full drops
+// Prefer: return=minimal and --sign signs requests as the firmware does.
+// Nothing leaves the machine: function_worker.ts refuses any fetch that is
+// not to the stubs. Remote modules come from Deno's cache, so run
+// `deno cache --import-map tools/edge_bench/import_map.json tools/edge_bench/load_test.ts`
+// once while online; add --cached-only to make sure later runs stay offline.
+
+import { DEFAULT_PAYLOAD_OPTIONS, type PayloadOptions } from './payloads.ts'
+
+const SIGNING_KEY = '00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff'
+const WARM_SAMPLES = 50
+const ALLOC_CHUNKS = 20
+const ALLOC_CHUNK_SIZE = 50
+
+interface Options {
+  requests: number
+  concurrency: number
+  warmup: number
+  coldRuns: number
+  dbLatencyMs: number
+  ntfyLatencyMs: number
+  drain: boolean
+  json: boolean
+  payload: PayloadOptions
+}
+
+function parseArgs(args: string[]): Options {
+  const options: Options = {
+    requests: 2000,
+    concurrency: 20,
+    warmup: 200,
+    coldRuns: 5,
+    dbLatencyMs: 0,
+    ntfyLatencyMs: 0,
+    drain: true,
+    json: false,
+    payload: { ...DEFAULT_PAYLOAD_OPTIONS }
+  }
+  for (let i = 0; i < args.length; i++) {
+    const arg = args[i]
+    if (arg === '--full') { options.payload.minimal = false; continue }
+    if (arg === '--sign') { options.payload.signingKey = SIGNING_KEY; continue }
+    if (arg === '--no-drain') { options.drain = false; continue }
+    if (arg === '--json') { options.json = true; continue }
+    const value = Number(args[++i])
+    if (!isFinite(value) || value < 0) throw new Error(`${arg} needs a non-negative number`)
+    switch (arg) {
+      case '--requests': options.requests = value; break
+      case '--concurrency': options.concurrency = value; break
+      case '--warmup': options.warmup = value; break
+      case '--cold-runs': options.coldRuns = value; break
+      case '--db-latency-ms': options.dbLatencyMs = value; break
+      case '--ntfy-latency-ms': options.ntfyLatencyMs = value; break
+      case '--devices': options.payload.devices = Math.max(1, value); break
+      case '--batch': options.payload.batch = Math.max(1, value); break
+      case '--alert-rate': options.payload.alertRate = value; break
+      case '--diagnostics-every': options.payload.diagnosticsEvery = value; break
+      case '--seed': options.payload.seed = value; break
+      default: throw new Error(`unknown option ${arg}`)
+    }
+  }
+  return options
+}
+
+// Posts a message and resolves with the worker's next reply of that type.
+function ask(worker: Worker, message: unknown, replyType: string): Promise<any> {
+  return new Promise((resolve, reject) => {
+    const onMessage = (event: MessageEvent) => {
+      if (event.data.type !== replyType) return
+      worker.removeEventListener('message', onMessage)
+      resolve(event.data)
+    }
+    worker.addEventListener('message', onMessage)
+    worker.addEventListener('error', (event) => reject(event.error ?? new Error(event.message)), { once: true })
+    if (message !== null) worker.postMessage(message)
+  })
+}
+
+function spawn(name: string): Worker {
+  return new Worker(new URL(name, import.meta.url).href, { type: 'module' })
+}
+
+function percentile(sorted: number[], p: number): number {
+  if (sorted.length === 0) return 0
+  const rank = Math.ceil(p / 100 * sorted.length)
+  return sorted[Math.min(Math.max(rank - 1, 0), sorted.length - 1)]
+}
+
+function median(values: number[]): number {
+  return percentile([...values].sort((a, b) => a - b), 50)
+}
+
+const functionModule = (name: string) => new URL(`../../supabase/functions/${name}/index.ts`, import.meta.url).href
+
+// A fresh isolate with the function imported, and how long each step took.
+async function startIsolate(name: string, ntfyUrl: string) {
+  const begin = performance.now()
+  const worker = spawn('./function_worker.ts')
+  await ask(worker, null, 'ready')
+  const bootMs = performance.now() - begin
+  const { importMs } = await ask(worker, { type: 'load', module: functionModule(name), ntfyUrl }, 'loaded')
+  return { worker, bootMs, importMs, begin }
+}
+
+async function coldStarts(options: Options, stubs: Worker, ntfyUrl: string) {
+  const boot: number[] = []
+  const imports: number[] = []
+  const first: number[] = []
+  const total: number[] = []
+  const warm: number[] = []
+  for (let run = 0; run < options.coldRuns; run++) {
+    await ask(stubs, { type: 'reset' }, 'reset')
+    const isolate = await startIsolate('log-sensor-data', ntfyUrl)
+    const cold = await ask(isolate.worker, { type: 'run', payload: options.payload, requests: 1, concurrency: 1 }, 'result')
+    total.push(performance.now() - isolate.begin)
+    const rest = await ask(isolate.worker, { type: 'run', payload: options.payload, requests: WARM_SAMPLES, concurrency: 1 }, 'result')
+    isolate.worker.terminate()
+    boot.push(isolate.bootMs)
+    imports.push(isolate.importMs)
+    first.push(cold.latenciesMs[0])
+    warm.push(median(rest.latenciesMs))
+  }
+  return { bootMs: median(boot), importMs: median(imports), firstRequestMs: median(first), totalMs: median(total), warmMs: median(warm) }
+}
+
+function fmt(value: number, digits = 2): string {
+  return value.toFixed(digits)
+}
+
+async function main() {
+  const options = parseArgs(Deno.args)
+
+  const stubs = spawn('./stub_servers.ts')
+  const { supabaseUrl, ntfyUrl } = await ask(stubs, { type: 'start', dbLatencyMs: options.dbLatencyMs, ntfyLatencyMs: options.ntfyLatencyMs }, 'ready')
+  Deno.env.set('MY_SUPABASE_URL', supabaseUrl)
+  Deno.env.set('MY_SUPABASE_SERVICE_KEY', 'stub-service-key')
+  Deno.env.set('NTFY_TOPIC_URL', 'https://ntfy.sh/load-test')
+  Deno.env.set('NTFY_ACCESS_TOKEN', 'stub-ntfy-token')
+  if (options.payload.signingKey) Deno.env.set('INGEST_SIGNING_KEY', options.payload.signingKey)
+
+  const cold = options.coldRuns > 0 ? await coldStarts(options, stubs, ntfyUrl) : null
+  await ask(stubs, { type: 'reset' }, 'reset')
+
+  // The timed run and the allocation probe each get their own isolate, so
+  // neither inherits the other's heap.
+  const loadIsolate = await startIsolate('log-sensor-data', ntfyUrl)
+  if (options.warmup > 0) {
+    await ask(loadIsolate.worker, { type: 'run', payload: options.payload, requests: options.warmup, concurrency: options.concurrency }, 'result')
+  }
+  await ask(stubs, { type: 'reset' }, 'reset')
+  const load = await ask(loadIsolate.worker, { type: 'run', payload: options.payload, requests: options.requests, concurrency: options.concurrency }, 'result')
+  const stubStats = (await ask(stubs, { type: 'stats' }, 'stats')).stats
+  loadIsolate.worker.terminate()
+
+  let drain = null
+  if (options.drain) {
+    const drainIsolate = await startIsolate('notify-drain', ntfyUrl)
+    const called = await ask(drainIsolate.worker, { type: 'call', url: 'http://localhost/functions/v1/notify-drain', body: '{}' }, 'called')
+    drainIsolate.worker.terminate()
+    const after = (await ask(stubs, { type: 'stats' }, 'stats')).stats
+    drain = { ms: called.ms, status: called.status, queued: stubStats.queued, pushes: after.ntfyPushes }
+  }
+
+  const allocIsolate = await startIsolate('log-sensor-data', ntfyUrl)
+  const allocation = await ask(allocIsolate.worker, { type: 'alloc', payload: options.payload, chunks: ALLOC_CHUNKS, chunkSize: ALLOC_CHUNK_SIZE }, 'alloc')
+  allocIsolate.worker.terminate()
+  stubs.terminate()
+
+  const sorted = [...load.latenciesMs].sort((a, b) => a - b)
+  const seconds = load.elapsedMs / 1000
+  const report = {
+    requests: options.requests,
+    concurrency: options.concurrency,
+    devices: options.payload.devices,
+    batch: options.payload.batch,
+    minimal_ack: options.payload.minimal,
+    signed: options.payload.signingKey !== null,
+    db_latency_ms: options.dbLatencyMs,
+    rps: options.requests / seconds,
+    readings_per_s: load.readings / seconds,
+    latency_ms: {
+      p50: percentile(sorted, 50), p95: percentile(sorted, 95), p99: percentile(sorted, 99), max: percentile(sorted, 100)
+    },
+    statuses: load.statuses,
+    cold_start_ms: cold && {
+      boot: cold.bootMs, import: cold.importMs, first_request: cold.firstRequestMs, total: cold.totalMs, warm_request: cold.warmMs
+    },
+    alloc_bytes_per_request: allocation.bytesPerRequest,
+    retained_bytes_per_request: allocation.retainedPerRequest,
+    stub: stubStats,
+    drain
+  }
+  if (options.json) {
+    console.log(JSON.stringify(report))
+    return
+  }
+
+  const p = options.payload
+  console.log(`log-sensor-data: ${options.requests} requests, concurrency ${options.concurrency}, ${p.devices} devices, ` +
+              `batch ${p.batch}, ${p.minimal ? 'minimal ack' : 'full ack'}, ${p.signingKey ? 'signed' : 'unsigned'}`)
+  console.log(`  throughput   ${fmt(report.rps, 1)} req/s, ${fmt(report.readings_per_s, 1)} readings/s`)
+  console.log(`  latency ms   p50 ${fmt(report.latency_ms.p50, 3)}  p95 ${fmt(report.latency_ms.p95, 3)}  ` +
+              `p99 ${fmt(report.latency_ms.p99, 3)}  max ${fmt(report.latency_ms.max, 3)}`)
+  console.log(`  statuses     ${Object.entries(load.statuses).map(([status, count]) => `${status}: ${count}`).join(', ')}`)
+  if (cold) {
+    console.log(`  cold start   ${fmt(cold.totalMs, 1)} ms to first response (boot ${fmt(cold.bootMs, 1)}, import ${fmt(cold.importMs, 1)}, ` +
+                `first request ${fmt(cold.firstRequestMs, 2)}); warm request ${fmt(cold.warmMs, 3)} ms; median of ${options.coldRuns}`)
+  }
+  if (allocation.bytesPerRequest === null) {
+    console.log('  allocation   n/a (run with --v8-flags=--expose-gc)')
+  } else {
+    console.log(`  allocation   ${fmt(allocation.bytesPerRequest / 1024, 1)} KiB/request, ` +
+                `${fmt(allocation.retainedPerRequest / 1024, 2)} KiB retained/request`)
+  }
+  console.log(`  stubs        ${stubStats.inserts} inserts, ${stubStats.rows} rows, ${stubStats.duplicates} duplicates, ` +
+              `${stubStats.alertCalls} alert state calls, ${stubStats.queued} pushes queued`)
+  if (drain) {
+    console.log(`  drain        ${drain.pushes} ntfy pushes for ${drain.queued} queued in ${fmt(drain.ms, 1)} ms (status ${drain.status})`)
+  }
+}
+
+await main()
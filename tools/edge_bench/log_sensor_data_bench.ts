@@ -0,0 +1,78 @@
+// Per-request cost of the log-sensor-data handler with a stubbed Supabase.
+//
+//   deno bench --allow-env --import-map tools/edge_bench/import_map.json \
+//     tools/edge_bench/log_sensor_data_bench.ts
+//
+// The real supabase-js client is used; fetch is replaced so PostgREST inserts
+// and ntfy pushes are answered in-process. "warm" is a request served by an
+// isolate that already holds the module-scope client, "cold" resets it first,
+// which is what every request used to pay (env lookups plus createClient()).
+
+const SUPABASE_URL = 'http://supabase.stub'
+
+Deno.env.set('MY_SUPABASE_URL', SUPABASE_URL)
+Deno.env.set('MY_SUPABASE_SERVICE_KEY', 'stub-service-key')
+
+let nextId = 1
+
+// PostgREST echoes the inserted rows; .single() asks for an object instead
+// of an array through the Accept header.
+globalThis.fetch = async (input: Request | URL | string, init?: RequestInit) => {
+  const request = new Request(input, init)
+  if (!request.url.startsWith(SUPABASE_URL)) return new Response('ok')
+
+  const body = await request.json()
+  const rows = (Array.isArray(body) ? body : [body]).map((row) => ({ id: nextId++, created_at: new Date().toISOString(), ...row }))
+  const single = (request.headers.get('accept') ?? '').includes('vnd.pgrst.object')
+  return new Response(JSON.stringify(single ? rows[0] : rows), {
+    status: 201,
+    headers: { 'Content-Type': 'application/json' }
+  })
+}
+
+const { handleRequest, resetSupabaseClient } = await import('../../supabase/functions/log-sensor-data/index.ts')
+
+function reading() {
+  return {
+    zone1: { tempC: 24.5, lux: 412, luxState: 'ok', alert: false },
+    zone2: { dhtTempC: 22.1, humidity: 58.3, alert: false },
+    fan_on: false
+  }
+}
+
+const singleBody = JSON.stringify(reading())
+const batchBody = JSON.stringify({
+  device: 'bench-01',
+  readings: Array.from({ length: 30 }, (_, i) => ({ ts: Date.now() - (30 - i) * 30000, ...reading() }))
+})
+
+function post(body: string) {
+  return new Request('http://localhost/functions/v1/log-sensor-data', {
+    method: 'POST',
+    headers: { 'Content-Type': 'application/json' },
+    body
+  })
+}
+
+async function expectCreated(response: Response) {
+  if (response.status !== 201) throw new Error(`unexpected status ${response.status}: ${await response.text()}`)
+  await response.arrayBuffer()
+}
+
+Deno.bench('warm: module-scope client', { group: 'single reading', baseline: true }, async () => {
+  await expectCreated(await handleRequest(post(singleBody)))
+})
+
+Deno.bench('cold: client per request', { group: 'single reading' }, async () => {
+  resetSupabaseClient()
+  await expectCreated(await handleRequest(post(singleBody)))
+})
+
+Deno.bench('warm: module-scope client', { group: 'batch of 30', baseline: true }, async () => {
+  await expectCreated(await handleRequest(post(batchBody)))
+})
+
+Deno.bench('cold: client per request', { group: 'batch of 30' }, async () => {
+  resetSupabaseClient()
+  await expectCreated(await handleRequest(post(batchBody)))
+})
@@ -0,0 +1,160 @@
+// Firmware-shaped request bodies for the edge benchmarks, field for field as
+// lib/monitor_core's payload.cpp writes them: zone1, zone2, fan_on, then the
+// device id and sequence number, and every diagnosticsEvery-th upload the
+// "prof" and "heap" blocks the firmware appends every 10th cycle.
+
+export interface PayloadOptions {
+  devices: number
+  // Readings per request; above 1 they are sent as one batch upload.
+  batch: number
+  // Chance that a zone is in alert on a given reading.
+  alertRate: number
+  // 0 leaves the diagnostics out.
+  diagnosticsEvery: number
+  seed: number
+  // Send Prefer: return=minimal, as the firmware does.
+  minimal: boolean
+  // Master key (hex) to sign with as the firmware does; see log-sensor-data.
+  signingKey: string | null
+}
+
+export const DEFAULT_PAYLOAD_OPTIONS: PayloadOptions = {
+  devices: 50,
+  batch: 1,
+  alertRate: 0.05,
+  diagnosticsEvery: 10,
+  seed: 42,
+  minimal: true,
+  signingKey: null
+}
+
+export interface GeneratedRequest {
+  body: string
+  headers: Record<string, string>
+  readings: number
+}
+
+const PHASES = ['adc', 'dht', 'alerts', 'lcd1', 'lcd2', 'json', 'tls', 'post', 'resp', 'sign']
+
+// xorshift32, so runs with the same seed send the same readings.
+function random(state: { s: number }): number {
+  let x = state.s
+  x ^= x << 13
+  x ^= x >>> 17
+  x ^= x << 5
+  state.s = x >>> 0
+  return state.s / 4294967296
+}
+
+function round1(value: number): number {
+  return Math.round(value * 10) / 10
+}
+
+interface DeviceState {
+  id: string
+  seq: number
+  uploads: number
+  key: CryptoKey | null
+}
+
+function hex(bytes: Uint8Array): string {
+  return Array.from(bytes, (b) => b.toString(16).padStart(2, '0')).join('')
+}
+
+function hexBytes(text: string): Uint8Array {
+  return new Uint8Array(text.match(/../g)!.map((pair) => parseInt(pair, 16)))
+}
+
+async function hmac(key: Uint8Array | CryptoKey, data: Uint8Array): Promise<Uint8Array> {
+  const cryptoKey = key instanceof Uint8Array
+    ? await crypto.subtle.importKey('raw', key, { name: 'HMAC', hash: 'SHA-256' }, false, ['sign'])
+    : key
+  return new Uint8Array(await crypto.subtle.sign('HMAC', cryptoKey, data))
+}
+
+export class PayloadGenerator {
+  private readonly options: PayloadOptions
+  private readonly rng: { s: number }
+  private readonly devices: DeviceState[] = []
+  private next = 0
+
+  constructor(options: PayloadOptions) {
+    this.options = options
+    this.rng = { s: (options.seed * 2654435761) >>> 0 || 1 }
+    for (let i = 0; i < options.devices; i++) {
+      const mac = (0xa1b2c3000000 + i).toString(16).padStart(12, '0')
+      this.devices.push({ id: `esp32-${mac}`, seq: 0, uploads: 0, key: null })
+    }
+  }
+
+  private reading(device: DeviceState) {
+    const hot = random(this.rng) < this.options.alertRate
+    const humid = random(this.rng) < this.options.alertRate
+    const tempC = round1(hot ? 30.5 + random(this.rng) * 5 : 20 + random(this.rng) * 8)
+    const lux = Math.round(hot ? 50 + random(this.rng) * 40 : 150 + random(this.rng) * 600)
+    const reading: any = {
+      zone1: { tempC, lux, luxState: 'ok', alert: hot },
+      zone2: {
+        dhtTempC: round1(19 + random(this.rng) * 6),
+        humidity: round1(humid ? 72 + random(this.rng) * 20 : 35 + random(this.rng) * 30),
+        alert: humid
+      },
+      fan_on: hot
+    }
+    return { reading, seq: device.seq++ }
+  }
+
+  private diagnostics() {
+    const prof: Record<string, number[]> = {}
+    for (const phase of PHASES) {
+      const p50 = Math.round(50 + random(this.rng) * 5000)
+      prof[phase] = [10, p50, p50 * 2, p50 * 3]
+    }
+    const heap = {
+      free: 180000, largest: 110000, min: 150000, cyc_allocs: 6, cyc_bytes: 900, up_allocs: 40, up_bytes: 12000,
+      stack: { loopTask: 4200, tiT: 1800, wifi: 2300 }
+    }
+    return { prof, heap }
+  }
+
+  // One upload from the next device in turn.
+  async nextRequest(): Promise<GeneratedRequest> {
+    const device = this.devices[this.next++ % this.devices.length]
+    let body: string
+    if (this.options.batch > 1) {
+      const now = Date.now()
+      const readings = []
+      for (let i = 0; i < this.options.batch; i++) {
+        const { reading, seq } = this.reading(device)
+        readings.push({ ts: now - (this.options.batch - 1 - i) * 30000, ...reading, seq })
+      }
+      body = JSON.stringify({ device: device.id, readings })
+    } else {
+      const { reading, seq } = this.reading(device)
+      const payload: any = { ...reading, device: device.id, seq }
+      if (this.options.diagnosticsEvery > 0 && ++device.uploads % this.options.diagnosticsEvery === 0) {
+        Object.assign(payload, this.diagnostics())
+      }
+      body = JSON.stringify(payload)
+    }
+
+    const headers: Record<string, string> = { 'Content-Type': 'application/json' }
+    if (this.options.minimal) headers['Prefer'] = 'return=minimal'
+    if (this.options.signingKey) {
+      if (!device.key) {
+        const derived = await hmac(hexBytes(this.options.signingKey), new TextEncoder().encode(device.id))
+        device.key = await crypto.subtle.importKey('raw', derived, { name: 'HMAC', hash: 'SHA-256' }, false, ['sign'])
+      }
+      const t = Math.floor(Date.now() / 1000)
+      const nonce = hex(crypto.getRandomValues(new Uint8Array(16)))
+      const prefix = new TextEncoder().encode(`${t}.${nonce}.`)
+      const bytes = new TextEncoder().encode(body)
+      const message = new Uint8Array(prefix.length + bytes.length)
+      message.set(prefix)
+      message.set(bytes, prefix.length)
+      headers['X-Device-Id'] = device.id
+      headers['X-Signature'] = `t=${t},n=${nonce},v1=${hex(await hmac(device.key, message))}`
+    }
+    return { body, headers, readings: this.options.batch }
+  }
+}
@@ -0,0 +1,3 @@
+// Stands in for std/http serve() so importing the edge function does not
+// open a listener; the benchmark calls the exported handler directly.
+export function serve(_handler: (req: Request) => Response | Promise<Response>) {}
@@ -0,0 +1,157 @@
+// Local stand-ins for everything the edge functions call, so load_test.ts
+// runs offline: the slice of PostgREST that log-sensor-data and notify-drain
+// use, and an ntfy topic. Runs as a worker so stub work does not share the
+// event loop of the function being measured.
+//
+//   POST /rest/v1/sensor_logs                insert; drops repeated (device_id, seq)
+//                                            and honours Prefer return= and count=
+//   POST /rest/v1/rpc/note_alert_states      raise/clear transitions (no cooldown),
+//                                            queued in an in-memory outbox
+//   POST /rest/v1/rpc/claim_notifications    leases queued pushes
+//   POST /rest/v1/rpc/finish_notifications   settles them
+//   POST <ntfy>/*                            counts pushes
+//
+// Messages: {type: 'start', dbLatencyMs, ntfyLatencyMs} answered with
+// {type: 'ready', supabaseUrl, ntfyUrl}; {type: 'stats'} and {type: 'reset'}.
+
+const stats = {
+  inserts: 0,
+  rows: 0,
+  duplicates: 0,
+  alertCalls: 0,
+  queued: 0,
+  claims: 0,
+  ntfyPushes: 0,
+  ntfyBytes: 0,
+  unknown: 0
+}
+
+let dbLatencyMs = 0
+let ntfyLatencyMs = 0
+let nextId = 1
+const seen = new Set<string>()
+const alerting = new Map<string, boolean>()
+let outbox: any[] = []
+const leases = new Map<string, any[]>()
+
+function sleep(ms: number) {
+  return ms > 0 ? new Promise((resolve) => setTimeout(resolve, ms)) : Promise.resolve()
+}
+
+function json(body: unknown, status = 200, headers: Record<string, string> = {}) {
+  return new Response(JSON.stringify(body), { status, headers: { 'Content-Type': 'application/json', ...headers } })
+}
+
+function insertRows(req: Request, body: any) {
+  const prefer = req.headers.get('prefer') ?? ''
+  const input: any[] = Array.isArray(body) ? body : [body]
+  const kept = []
+  for (const row of input) {
+    if (row.device_id != null && row.seq != null) {
+      const key = `${row.device_id}/${row.seq}`
+      if (seen.has(key)) {
+        stats.duplicates++
+        continue
+      }
+      seen.add(key)
+    }
+    kept.push({ id: nextId++, created_at: new Date().toISOString(), ...row })
+  }
+  stats.inserts++
+  stats.rows += kept.length
+
+  const headers: Record<string, string> = {}
+  if (prefer.includes('count=exact')) headers['Content-Range'] = kept.length ? `0-${kept.length - 1}/${kept.length}` : '*/0'
+  if (!prefer.includes('return=representation')) return new Response(null, { status: 201, headers })
+  if ((req.headers.get('accept') ?? '').includes('vnd.pgrst.object')) {
+    if (kept.length !== 1) {
+      return json({
+        code: 'PGRST116',
+        details: `The result contains ${kept.length} rows`,
+        hint: null,
+        message: 'JSON object requested, multiple (or no) rows returned'
+      }, 406)
+    }
+    return json(kept[0], 201, headers)
+  }
+  return json(kept, 201, headers)
+}
+
+function noteAlertStates(args: any) {
+  stats.alertCalls++
+  const rows = []
+  for (const state of args.p_states ?? []) {
+    const key = `${state.device_id}/${state.zone}`
+    const was = alerting.get(key) ?? false
+    let event = null
+    if (state.alerting !== was) {
+      event = state.alerting ? 'raised' : 'cleared'
+      alerting.set(key, state.alerting)
+      outbox.push({ id: nextId++, device_id: state.device_id, zone: state.zone, event, reading: state.reading, suppressed: 0, attempts: 0 })
+      stats.queued++
+    }
+    rows.push({ device_id: state.device_id, zone: state.zone, event, settled: !state.alerting })
+  }
+  return json(rows)
+}
+
+function claimNotifications(args: any) {
+  stats.claims++
+  const rows = outbox.slice(0, args.p_limit)
+  outbox = outbox.slice(rows.length)
+  leases.set(args.p_token, rows)
+  return json(rows)
+}
+
+function finishNotifications(args: any) {
+  const rows = leases.get(args.p_token) ?? []
+  leases.delete(args.p_token)
+  const failed = new Set(args.p_failed ?? [])
+  outbox.push(...rows.filter((row) => failed.has(row.id)))
+  return new Response(null, { status: 204 })
+}
+
+async function supabaseHandler(req: Request): Promise<Response> {
+  await sleep(dbLatencyMs)
+  const path = new URL(req.url).pathname
+  const body = req.method === 'POST' ? await req.json() : null
+  switch (path) {
+    case '/rest/v1/sensor_logs': return insertRows(req, body)
+    case '/rest/v1/rpc/note_alert_states': return noteAlertStates(body)
+    case '/rest/v1/rpc/claim_notifications': return claimNotifications(body)
+    case '/rest/v1/rpc/finish_notifications': return finishNotifications(body)
+  }
+  stats.unknown++
+  return json({ code: 'PGRST202', message: `stub has no ${req.method} ${path}` }, 404)
+}
+
+async function ntfyHandler(req: Request): Promise<Response> {
+  await sleep(ntfyLatencyMs)
+  const message = await req.text()
+  stats.ntfyPushes++
+  stats.ntfyBytes += message.length
+  return json({ id: String(stats.ntfyPushes), time: Math.floor(Date.now() / 1000), event: 'message' })
+}
+
+function listen(handler: (req: Request) => Promise<Response>): string {
+  const server = Deno.serve({ hostname: '127.0.0.1', port: 0, onListen() {} }, handler)
+  return `http://127.0.0.1:${server.addr.port}`
+}
+
+self.onmessage = (event: MessageEvent) => {
+  const message = event.data
+  if (message.type === 'start') {
+    dbLatencyMs = message.dbLatencyMs ?? 0
+    ntfyLatencyMs = message.ntfyLatencyMs ?? 0
+    self.postMessage({ type: 'ready', supabaseUrl: listen(supabaseHandler), ntfyUrl: listen(ntfyHandler) })
+  } else if (message.type === 'stats') {
+    self.postMessage({ type: 'stats', stats: { ...stats, outbox: outbox.length } })
+  } else if (message.type === 'reset') {
+    seen.clear()
+    alerting.clear()
+    leases.clear()
+    outbox = []
+    for (const key of Object.keys(stats)) (stats as any)[key] = 0
+    self.postMessage({ type: 'reset' })
+  }
+}
@@ -0,0 +1,88 @@
+#!/bin/sh
+# Builds and runs the fuzz targets with AddressSanitizer and UBSan.
+#
+#   tools/fuzz/fuzz.sh build              build every target
+#   tools/fuzz/fuzz.sh check [RUNS]       build, then run each target over its
+#                                         corpus and RUNS generated inputs
+#   tools/fuzz/fuzz.sh run TARGET [ARGS]  run one target (libFuzzer or driver
+#                                         arguments)
+#
+# With a clang++ that supports -fsanitize=fuzzer the targets are libFuzzer
+# binaries; otherwise they are linked against fuzz_driver.cpp, which replays
+# files and random inputs without coverage feedback. CXX overrides the
+# compiler, FUZZ_OUT the output directory (default .pio/fuzz).
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+OUT=${FUZZ_OUT:-$ROOT/.pio/fuzz}
+TARGETS="payload trace_dump replay_bin ingest_contract history config"
+
+if [ -z "$CXX" ]; then
+  if command -v clang++ >/dev/null 2>&1; then CXX=clang++; else CXX=g++; fi
+fi
+
+if echo 'extern "C" int LLVMFuzzerTestOneInput(const char*, long) { return 0; }' |
+    "$CXX" -x c++ -fsanitize=fuzzer -o /dev/null - >/dev/null 2>&1; then
+  ENGINE=libfuzzer
+  ENGINE_FLAGS="-fsanitize=fuzzer,address,undefined"
+  ENGINE_SOURCES=""
+else
+  ENGINE=driver
+  ENGINE_FLAGS="-fsanitize=address,undefined"
+  ENGINE_SOURCES="$ROOT/tools/fuzz/fuzz_driver.cpp"
+fi
+
+build() {
+  mkdir -p "$OUT"
+  for target in $TARGETS; do
+    echo "building fuzz_$target ($ENGINE, $CXX)"
+    # shellcheck disable=SC2086
+    "$CXX" -std=gnu++17 -g -O1 -fno-omit-frame-pointer -fno-sanitize-recover=undefined $ENGINE_FLAGS \
+      -I"$ROOT/include" -I"$ROOT/lib/monitor_core/src" -I"$ROOT/lib/hal_sim/src" -I"$ROOT/lib/ingest_contract/src" \
+      -I"$ROOT/tools/trace_decode" -I"$ROOT/tools/replay" -I"$ROOT/tools/fuzz" \
+      "$ROOT/tools/fuzz/fuzz_$target.cpp" $ENGINE_SOURCES \
+      "$ROOT"/lib/monitor_core/src/*.cpp "$ROOT"/lib/hal_sim/src/*.cpp "$ROOT"/lib/ingest_contract/src/*.cpp \
+      "$ROOT/tools/trace_decode/trace_dump.cpp" "$ROOT/tools/replay/replay_format.cpp" \
+      -o "$OUT/fuzz_$target"
+  done
+}
+
+run_target() {
+  target=$1
+  runs=$2
+  corpus="$ROOT/tools/fuzz/corpus/$target"
+  if [ "$ENGINE" = libfuzzer ]; then
+    work="$OUT/corpus/$target"
+    mkdir -p "$work"
+    [ -d "$corpus" ] || corpus=""
+    # shellcheck disable=SC2086
+    "$OUT/fuzz_$target" -runs="$runs" -seed=1 -max_len=1024 "$work" $corpus
+  else
+    [ ! -d "$corpus" ] || "$OUT/fuzz_$target" "$corpus"
+    "$OUT/fuzz_$target" --runs "$runs" --seed 1 --max-len 1024
+  fi
+}
+
+case "$1" in
+  build)
+    build
+    ;;
+  check)
+    build
+    for target in $TARGETS; do
+      echo "== $target"
+      run_target "$target" "${2:-200000}"
+    done
+    ;;
+  run)
+    [ -n "$2" ] || { echo "usage: $0 run TARGET [ARGS]" >&2; exit 1; }
+    target=$2
+    shift 2
+    exec "$OUT/fuzz_$target" "$@"
+    ;;
+  *)
+    echo "usage: $0 build | check [RUNS] | run TARGET [ARGS]" >&2
+    exit 1
+    ;;
+esac
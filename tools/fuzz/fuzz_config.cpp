@@ -0,0 +1,117 @@
+// Device configuration store. The input is a stored blob, either raw bytes
+// or a valid configuration with a few bytes changed, possibly cut short and
+// its CRC optionally fixed up, followed by "config set" style edits. Whatever is stored,
+// configLoad() must end with a configuration that validates; an edit that
+// configUpdate() accepts must be stored so that the next boot loads exactly
+// it, and one it refuses must leave everything as it was.
+
+#include "device_config.h"
+#include "fuzz_support.h"
+#include "hal_sim.h"
+
+static void checkLoaded(ConfigSource source) {
+  const char* invalid = configValidate(deviceConfig);
+  FUZZ_CHECK(invalid == nullptr, "source %d loaded an invalid %s", source, invalid);
+  FUZZ_CHECK(deviceConfig.version == CONFIG_VERSION && deviceConfig.size == sizeof(DeviceConfig) &&
+                 deviceConfig.crc == configCrc(deviceConfig),
+             "source %d: header %u/%u/%08x", source, deviceConfig.version, deviceConfig.size, deviceConfig.crc);
+  FUZZ_CHECK(memcmp(&configStored(), &deviceConfig, sizeof(DeviceConfig)) == 0, "source %d: stored differs", source);
+}
+
+static bool bootFieldsEqual(const DeviceConfig& a, const DeviceConfig& b) {
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+    const ConfigField& field = CONFIG_FIELDS[i];
+    if ((field.flags & CONFIG_AT_BOOT) &&
+        memcmp((const uint8_t*)&a + field.offset, (const uint8_t*)&b + field.offset, field.size) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  FuzzInput in(data, size);
+  simReset();
+
+  if (in.flag()) {
+    size_t length = in.u16() % (sizeof(DeviceConfig) + 16);
+    if (length > in.remaining()) length = in.remaining();
+    simSetStoredConfig(in.bytes(length), length);
+  } else {
+    DeviceConfig blob;
+    configDefaults(blob);
+    uint8_t changes = in.u8() % 4;
+    for (uint8_t i = 0; i < changes; i++) {
+      ((uint8_t*)&blob)[in.u16() % sizeof(blob)] = in.u8();
+    }
+    // Cut short, with or without a header that agrees: a current version
+    // must be stored whole.
+    size_t length = in.flag() ? in.u16() % (sizeof(blob) + 1) : sizeof(blob);
+    if (in.flag()) blob.size = (uint16_t)length;
+    if (in.flag()) blob.crc = configCrc(blob);
+    simSetStoredConfig(&blob, length);
+  }
+
+  size_t storedLength;
+  DeviceConfig before;
+  memcpy(&before, simStoredConfig(storedLength), sizeof(before));
+  size_t lengthBefore = storedLength;
+
+  ConfigSource source = configLoad();
+  checkLoaded(source);
+  const uint8_t* stored = simStoredConfig(storedLength);
+  if (source == CONFIG_FROM_STORE) {
+    FUZZ_CHECK(storedLength == sizeof(DeviceConfig) && memcmp(stored, &deviceConfig, storedLength) == 0,
+               "loaded config is not the stored blob");
+  } else if (source == CONFIG_MIGRATED) {
+    FUZZ_CHECK(storedLength == sizeof(DeviceConfig) && memcmp(stored, &deviceConfig, storedLength) == 0,
+               "migrated config was not stored again");
+  } else {
+    size_t compared = storedLength < sizeof(before) ? storedLength : sizeof(before);
+    FUZZ_CHECK(storedLength == lengthBefore && memcmp(stored, &before, compared) == 0,
+               "source %d changed the stored blob", source);
+  }
+
+  while (in.remaining() > 0) {
+    const ConfigField& field = CONFIG_FIELDS[in.u8() % CONFIG_FIELD_COUNT];
+    char value[64];
+    size_t length = in.u8() % sizeof(value);
+    if (length > in.remaining()) length = in.remaining();
+    memcpy(value, in.bytes(length), length);
+    value[length] = '\0';
+
+    DeviceConfig running = deviceConfig;
+    DeviceConfig next = configStored();
+    DeviceConfig edited = next;
+    if (!configParseField(edited, field, value)) {
+      FUZZ_CHECK(memcmp(&edited, &next, sizeof(next)) == 0, "%s: refused value changed the config", field.key);
+      continue;
+    }
+
+    ConfigUpdate result = configUpdate(edited);
+    if (result == CONFIG_INVALID) {
+      FUZZ_CHECK(configValidate(edited) != nullptr, "%s = \"%s\" refused but validates", field.key, value);
+      FUZZ_CHECK(memcmp(&configStored(), &next, sizeof(next)) == 0 &&
+                     memcmp(&deviceConfig, &running, sizeof(running)) == 0,
+                 "%s: refused update changed the config", field.key);
+      continue;
+    }
+    FUZZ_CHECK(result == CONFIG_APPLIED || result == CONFIG_PENDING_RESTART, "%s: result %d", field.key, result);
+    if (result == CONFIG_APPLIED) {
+      FUZZ_CHECK(memcmp(&deviceConfig, &configStored(), sizeof(DeviceConfig)) == 0, "%s: applied but not stored",
+                 field.key);
+      FUZZ_CHECK(bootFieldsEqual(deviceConfig, running), "%s: boot field applied at once", field.key);
+    } else {
+      FUZZ_CHECK(!bootFieldsEqual(configStored(), running), "%s: pending without a boot field change", field.key);
+      FUZZ_CHECK(memcmp(&deviceConfig, &running, sizeof(running)) == 0, "%s: pending update applied", field.key);
+    }
+
+    // What the next boot sees.
+    DeviceConfig wanted = configStored();
+    ConfigSource reload = configLoad();
+    FUZZ_CHECK(reload == CONFIG_FROM_STORE, "%s: reload source %d", field.key, reload);
+    checkLoaded(reload);
+    FUZZ_CHECK(memcmp(&deviceConfig, &wanted, sizeof(wanted)) == 0, "%s: reload differs from the update", field.key);
+  }
+  return 0;
+}
@@ -0,0 +1,100 @@
+// Stand-in for libFuzzer's main() when building with a compiler that has no
+// -fsanitize=fuzzer (gcc). Runs the target over the given files and
+// directories, or over pseudo-random inputs when none are given:
+//
+//   fuzz_<target> [--runs N] [--seed S] [--max-len L] [FILE|DIR ...]
+//
+// No coverage feedback, so it is a property test with random inputs rather
+// than a fuzzer; build with clang (tools/fuzz/fuzz.sh) for the real thing.
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#include "fuzz_support.h"
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  uint8_t chunk[4096];
+  size_t n;
+  out.clear();
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) out.insert(out.end(), chunk, chunk + n);
+  fclose(f);
+  return true;
+}
+
+static size_t runPath(const std::string& path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    fprintf(stderr, "cannot stat %s\n", path.c_str());
+    exit(1);
+  }
+  if (S_ISDIR(st.st_mode)) {
+    size_t count = 0;
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return 0;
+    while (dirent* entry = readdir(dir)) {
+      if (entry->d_name[0] == '.') continue;
+      count += runPath(path + "/" + entry->d_name);
+    }
+    closedir(dir);
+    return count;
+  }
+
+  std::vector<uint8_t> data;
+  if (!readFile(path, data)) {
+    fprintf(stderr, "cannot read %s\n", path.c_str());
+    exit(1);
+  }
+  fprintf(stderr, "running %s (%zu bytes)\n", path.c_str(), data.size());
+  LLVMFuzzerTestOneInput(data.data(), data.size());
+  return 1;
+}
+
+static uint64_t nextRandom(uint64_t& state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+int main(int argc, char** argv) {
+  uint64_t runs = 100000;
+  uint64_t seed = 1;
+  size_t maxLen = 512;
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--runs") == 0 && value) { runs = strtoull(value, nullptr, 10); i++; }
+    else if (strcmp(arg, "--seed") == 0 && value) { seed = strtoull(value, nullptr, 10); i++; }
+    else if (strcmp(arg, "--max-len") == 0 && value) { maxLen = strtoul(value, nullptr, 10); i++; }
+    else if (arg[0] == '-') { fprintf(stderr, "usage: %s [--runs N] [--seed S] [--max-len L] [FILE|DIR ...]\n", argv[0]); return 1; }
+    else paths.push_back(arg);
+  }
+
+  if (!paths.empty()) {
+    size_t count = 0;
+    for (const std::string& path : paths) count += runPath(path);
+    fprintf(stderr, "%zu inputs ok\n", count);
+    return 0;
+  }
+
+  uint64_t state = seed ? seed : 1;
+  std::vector<uint8_t> data(maxLen);
+  for (uint64_t run = 0; run < runs; run++) {
+    size_t length = maxLen ? nextRandom(state) % (maxLen + 1) : 0;
+    for (size_t i = 0; i < length; i++) data[i] = (uint8_t)nextRandom(state);
+    LLVMFuzzerTestOneInput(data.data(), length);
+  }
+  fprintf(stderr, "%llu random inputs ok (seed %llu, max length %zu)\n", (unsigned long long)runs,
+          (unsigned long long)seed, maxLen);
+  return 0;
+}
@@ -0,0 +1,149 @@
+// On-device sample history and its rollups. The input is a sequence of
+// appends and range queries against a small history, some of them starting
+// just short of the millis() rollover; every range must match a plain list
+// of the channel's most recent records, and its stats a straight
+// recomputation. Window stats over the rollups must count every record
+// exactly once, and only records within one bucket width of the window.
+
+#include <deque>
+#include <vector>
+
+#include "fuzz_support.h"
+#include "sample_history.h"
+#include "sample_rollup.h"
+
+struct Expected {
+  uint32_t timeMs;
+  int16_t value;
+  uint16_t flags;
+};
+
+static void checkQuery(const SampleHistory& history, const std::deque<Expected>& model, HistoryChannel channel,
+                       uint32_t sinceMs) {
+  HistoryRange range = historySince(history, channel, sinceMs);
+
+  size_t skip = 0;
+  while (skip < model.size() && (int32_t)(model[skip].timeMs - sinceMs) < 0) skip++;
+  FUZZ_CHECK(range.size() == model.size() - skip, "channel %d since %u: %zu records, expected %zu", channel,
+             sinceMs, range.size(), model.size() - skip);
+
+  int64_t sum = 0;
+  size_t alerts = 0;
+  int16_t low = 32767;
+  int16_t high = -32768;
+  for (size_t i = 0; i < range.size(); i++) {
+    const Expected& want = model[skip + i];
+    const HistoryRecord& got = range[i];
+    FUZZ_CHECK(got.timeMs == want.timeMs && got.value == want.value && got.flags == want.flags,
+               "record %zu: got (%u, %d, %u), expected (%u, %d, %u)", i, got.timeMs, got.value, got.flags,
+               want.timeMs, want.value, want.flags);
+    sum += want.value;
+    if (want.flags & HISTORY_ALERT) alerts++;
+    if (want.value < low) low = want.value;
+    if (want.value > high) high = want.value;
+  }
+
+  HistoryStats stats = historyStats(channel, range);
+  FUZZ_CHECK(stats.count == range.size() && stats.alerts == alerts, "stats count %zu alerts %zu, expected %zu %zu",
+             stats.count, stats.alerts, range.size(), alerts);
+  if (range.size() > 0) {
+    FUZZ_CHECK(stats.min == historyValue(channel, low) && stats.max == historyValue(channel, high),
+               "min %g max %g, expected %g %g", stats.min, stats.max, historyValue(channel, low),
+               historyValue(channel, high));
+    float mean = (float)sum / (float)range.size() / HISTORY_CHANNEL_INFO[channel].scale;
+    FUZZ_CHECK(stats.mean == mean, "mean %g, expected %g", stats.mean, mean);
+  }
+}
+
+static void checkWindow(const SampleHistory& history, const std::vector<Expected>& all, HistoryChannel channel,
+                        uint32_t nowMs, uint32_t windowMs) {
+  HistoryStats stats = historyWindowStats(history, channel, nowMs, windowMs);
+  uint32_t sinceMs = nowMs - windowMs;
+  uint32_t slack = ROLLUP_WIDTH_MS[ROLLUP_LEVELS - 1] - 1;
+  size_t inside = 0;
+  size_t near = 0;
+  for (const Expected& record : all) {
+    if ((int32_t)(record.timeMs - sinceMs) >= 0) inside++;
+    if ((int32_t)(record.timeMs - (sinceMs - slack)) >= 0) near++;
+  }
+  FUZZ_CHECK(stats.count >= inside && stats.count <= near, "channel %d window %u: %zu records, expected %zu to %zu",
+             channel, windowMs, stats.count, inside, near);
+}
+
+// A window from the first record on must hold every record, with the same
+// totals as the records themselves.
+static void checkEverything(const SampleHistory& history, const std::vector<Expected>& all, HistoryChannel channel,
+                            uint32_t nowMs) {
+  if (all.empty()) return;
+  HistoryStats stats = historyWindowStats(history, channel, nowMs, nowMs - all.front().timeMs);
+  int64_t sum = 0;
+  size_t alerts = 0;
+  int16_t low = 32767;
+  int16_t high = -32768;
+  for (const Expected& record : all) {
+    sum += record.value;
+    if (record.flags & HISTORY_ALERT) alerts++;
+    if (record.value < low) low = record.value;
+    if (record.value > high) high = record.value;
+  }
+  float mean = (float)sum / (float)all.size() / HISTORY_CHANNEL_INFO[channel].scale;
+  FUZZ_CHECK(stats.count == all.size() && stats.alerts == alerts, "channel %d: %zu records %zu alerts, expected %zu %zu",
+             channel, stats.count, stats.alerts, all.size(), alerts);
+  FUZZ_CHECK(stats.min == historyValue(channel, low) && stats.max == historyValue(channel, high) && stats.mean == mean,
+             "channel %d: min %g max %g mean %g, expected %g %g %g", channel, stats.min, stats.max, stats.mean,
+             historyValue(channel, low), historyValue(channel, high), mean);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  FuzzInput in(data, size);
+
+  // Up to 4 blocks per channel, plus capacities that are not a whole number
+  // of blocks, so wrapping and partial blocks come up quickly.
+  size_t requested = in.u8() % (4 * HISTORY_INDEX_STRIDE + 8);
+  static HistoryRecord records[HISTORY_CHANNELS * 4 * HISTORY_INDEX_STRIDE + HISTORY_CHANNELS * 8];
+  static uint32_t index[HISTORY_CHANNELS * 4 + HISTORY_CHANNELS];
+  SampleHistory history;
+  historyBegin(history, records, index, requested);
+  size_t capacity = history.capacity;
+  FUZZ_CHECK(capacity % HISTORY_INDEX_STRIDE == 0 && capacity <= requested, "capacity %zu for %zu", capacity,
+             requested);
+
+  // A short minute level, so buckets move up often; the top level is long
+  // enough that nothing is dropped from it.
+  static RollupBucket minutes[HISTORY_CHANNELS * 4];
+  static RollupBucket quarters[HISTORY_CHANNELS * 512];
+  RollupBucket* const storage[ROLLUP_LEVELS] = {in.flag() ? minutes : nullptr, quarters};
+  const size_t rollupCapacity[ROLLUP_LEVELS] = {(size_t)(in.u8() % 5), 512};
+  SampleRollup rollup;
+  rollupBegin(rollup, storage, rollupCapacity);
+  historyAttachRollup(history, &rollup);
+
+  std::deque<Expected> model[HISTORY_CHANNELS];
+  std::vector<Expected> all[HISTORY_CHANNELS];
+  uint32_t clock = in.flag() ? 0xFFFFFFFFu - in.u16() * 64u : in.u32();
+
+  while (in.remaining() > 0) {
+    uint8_t op = in.u8();
+    HistoryChannel channel = (HistoryChannel)(op % HISTORY_CHANNELS);
+    if (op & 0x80) {
+      uint32_t back = in.u16() * (uint32_t)(in.u8() % 64 + 1);
+      checkQuery(history, model[channel], channel, clock - back);
+      checkWindow(history, all[channel], channel, clock, back);
+      continue;
+    }
+    clock += (op & 0x40) ? in.u16() : in.u8();
+    Expected record = {clock, (int16_t)in.u16(), (uint16_t)(in.u8() & 7)};
+    historyAppend(history, channel, record.timeMs, record.value, record.flags);
+    all[channel].push_back(record);
+    if (capacity == 0) continue;
+    model[channel].push_back(record);
+    if (model[channel].size() > capacity) model[channel].pop_front();
+  }
+
+  for (int c = 0; c < HISTORY_CHANNELS; c++) {
+    checkQuery(history, model[c], (HistoryChannel)c, clock - 0x7FFFFFFFu);
+    checkQuery(history, model[c], (HistoryChannel)c, clock + 1);
+    checkEverything(history, all[c], (HistoryChannel)c, clock);
+  }
+  return 0;
+}
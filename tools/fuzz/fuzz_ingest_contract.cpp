@@ -0,0 +1,63 @@
+// The C++ mirror of the edge function's request handling. Arbitrary bytes
+// go through the strict JSON parser and parseLogEntry(); any accepted body
+// must produce a row whose JSON parses again and reads back the same.
+
+#include <math.h>
+
+#include <string>
+
+#include "fuzz_support.h"
+#include "ingest_contract.h"
+#include "json_value.h"
+
+static void checkNumber(const JsonValue* value, const OptionalNumber& expected, const char* field) {
+  FUZZ_CHECK(value != nullptr, "%s missing from row", field);
+  if (!expected.present) {
+    FUZZ_CHECK(value->isNull(), "%s should be null", field);
+    return;
+  }
+  FUZZ_CHECK(value->isNumber() && value->number() == expected.value, "%s: %.17g did not round-trip", field, expected.value);
+}
+
+static void checkBool(const JsonValue* value, bool expected, const char* field) {
+  FUZZ_CHECK(value != nullptr && value->isBool() && value->boolean() == expected, "%s did not round-trip", field);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  LogEntry entry;
+  std::string error;
+  if (!parseLogEntry((const char*)data, size, entry, error)) return 0;
+
+  std::string row = logEntryToJson(entry, 1, "2026-01-01T00:00:00+00:00");
+  JsonValue parsed;
+  FUZZ_CHECK(JsonValue::parse(row.data(), row.size(), parsed, &error), "row is not JSON (%s): %s", error.c_str(), row.c_str());
+
+  checkNumber(parsed.get("z1_temp"), entry.z1Temp, "z1_temp");
+  checkNumber(parsed.get("z2_temp"), entry.z2Temp, "z2_temp");
+  checkNumber(parsed.get("z2_humidity"), entry.z2Humidity, "z2_humidity");
+  checkNumber(parsed.get("z1_lux"), entry.z1Lux, "z1_lux");
+  const JsonValue* luxState = parsed.get("z1_lux_state");
+  FUZZ_CHECK(luxState != nullptr, "z1_lux_state missing from row");
+  if (entry.z1LuxState.empty()) {
+    FUZZ_CHECK(luxState->isNull(), "z1_lux_state should be null");
+  } else {
+    FUZZ_CHECK(luxState->isString() && luxState->string() == entry.z1LuxState, "z1_lux_state did not round-trip");
+  }
+  FUZZ_CHECK(entry.z1Lux.present == (entry.z1LuxState == "ok"), "z1_lux and z1_lux_state disagree");
+  checkBool(parsed.get("z1_alert"), entry.z1Alert, "z1_alert");
+  checkBool(parsed.get("z2_alert"), entry.z2Alert, "z2_alert");
+  checkBool(parsed.get("fan_on"), entry.fanOn, "fan_on");
+  checkNumber(parsed.get("seq"), entry.seq, "seq");
+  FUZZ_CHECK(!entry.seq.present || (entry.seq.value >= 0 && entry.seq.value == floor(entry.seq.value)), "seq is not a whole number");
+  const JsonValue* device = parsed.get("device_id");
+  FUZZ_CHECK(device != nullptr, "device_id missing from row");
+  FUZZ_CHECK(entry.hasDevice ? device->isString() && device->string() == entry.deviceId : device->isNull(),
+             "device_id did not round-trip");
+
+  // A single reading signed by the device it names is never refused.
+  JsonValue input;
+  if (entry.hasDevice && JsonValue::parse((const char*)data, size, input) && !isLogBatch(input)) {
+    FUZZ_CHECK(!namesOtherDevice(input, entry.deviceId), "reading refused for its own device");
+  }
+  return 0;
+}
@@ -0,0 +1,95 @@
+// Payload encoder vs. the reference decoder. Builds a SensorSample from the
+// input (biased towards sentinels, thresholds, NaN, infinities and huge
+// values), encodes it with encodePayload(), and checks that the result is
+// strict JSON and that the edge function's coercions, as mirrored by
+// lib/ingest_contract, recover every field.
+
+#include <float.h>
+#include <math.h>
+
+#include <string>
+
+#include "alerts.h"
+#include "fuzz_support.h"
+#include "ingest_contract.h"
+#include "json_value.h"
+#include "payload.h"
+
+static const float SPECIAL_VALUES[] = {
+  NAN, INFINITY, -INFINITY, TEMP_INVALID, DHT_READ_FAILED, LUX_DARK, LUX_BRIGHT, -0.0f,
+  0.05f, -0.05f, 0.04999f, 29.95f, 30.05f, 69.95f, 100.0f, 99.5f,
+  1e30f, -1e30f, FLT_MAX, -FLT_MAX, FLT_MIN, 2147483520.0f, 2147483648.0f, -2147483904.0f,
+};
+static const size_t SPECIAL_COUNT = sizeof(SPECIAL_VALUES) / sizeof(SPECIAL_VALUES[0]);
+
+static float pickFloat(FuzzInput& in) {
+  uint8_t selector = in.u8();
+  if (selector < 96) return SPECIAL_VALUES[selector % SPECIAL_COUNT];
+  if (selector < 176) return (float)(int16_t)in.u16() / 10.0f;
+  return in.f32bits();
+}
+
+static void checkNumber(const OptionalNumber& parsed, float sent, bool expectNull, const char* field) {
+  FUZZ_CHECK(parsed.present == !expectNull, "%s: sent %.9g, present=%d", field, sent, parsed.present);
+  if (!parsed.present) return;
+  double error = fabs(parsed.value - (double)sent);
+  FUZZ_CHECK(error <= 0.0500001 + fabs((double)sent) * 1e-12, "%s: sent %.9g, got %.17g", field, sent, parsed.value);
+}
+
+static std::string expectedLuxState(float lux) {
+  if (lux == LUX_DARK) return "dark";
+  if (lux == LUX_BRIGHT) return "bright";
+  return isfinite(lux) ? "ok" : "";
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  FuzzInput in(data, size);
+  SensorSample sample;
+  sample.temperatureCZ1 = pickFloat(in);
+  sample.luxZ1 = pickFloat(in);
+  sample.temperatureCZ2 = pickFloat(in);
+  sample.humidityZ2 = pickFloat(in);
+  if (in.flag()) {
+    AlertThresholds thresholds;
+    if (in.flag()) thresholds.tempHigh = pickFloat(in);
+    if (in.flag()) thresholds.lightLow = pickFloat(in);
+    if (in.flag()) thresholds.humidityHigh = pickFloat(in);
+    evaluateAlerts(sample, thresholds);
+  } else {
+    sample.zone1Alert = in.flag();
+    sample.zone2Alert = in.flag();
+    sample.highTempAlert = in.flag();
+  }
+
+  char buffer[PAYLOAD_BUFFER_SIZE];
+  size_t length = encodePayload(sample, buffer, sizeof(buffer));
+  FUZZ_CHECK(length > 0, "payload did not fit %zu bytes", sizeof(buffer));
+  FUZZ_CHECK(strlen(buffer) == length, "length %zu, strlen %zu", length, strlen(buffer));
+
+  JsonValue document;
+  std::string error;
+  FUZZ_CHECK(JsonValue::parse(buffer, length, document, &error), "invalid JSON (%s): %s", error.c_str(), buffer);
+  FUZZ_CHECK(document.isObject() && document.object().size() == 3, "unexpected shape: %s", buffer);
+
+  LogEntry entry;
+  FUZZ_CHECK(parseLogEntry(buffer, length, entry, error), "rejected (%s): %s", error.c_str(), buffer);
+
+  float z1 = sample.temperatureCZ1;
+  float z2 = sample.temperatureCZ2;
+  float h2 = sample.humidityZ2;
+  checkNumber(entry.z1Temp, z1, z1 == TEMP_INVALID || !isfinite(z1), "z1_temp");
+  checkNumber(entry.z2Temp, z2, !(z2 > DHT_READ_FAILED) || !isfinite(z2), "z2_temp");
+  checkNumber(entry.z2Humidity, h2, !(h2 > DHT_READ_FAILED) || !isfinite(h2), "z2_humidity");
+
+  float lux = sample.luxZ1;
+  std::string luxState = expectedLuxState(lux);
+  FUZZ_CHECK(entry.z1LuxState == luxState, "z1_lux_state: sent %.9g, expected \"%s\", got \"%s\"", lux, luxState.c_str(), entry.z1LuxState.c_str());
+  FUZZ_CHECK(entry.z1Lux.present == (luxState == "ok"), "z1_lux: sent %.9g, present=%d", lux, entry.z1Lux.present);
+  if (entry.z1Lux.present) {
+    FUZZ_CHECK(entry.z1Lux.value == (double)truncf(lux), "z1_lux: sent %.9g, got %.17g", lux, entry.z1Lux.value);
+  }
+  FUZZ_CHECK(entry.z1Alert == sample.zone1Alert, "z1_alert: %s", buffer);
+  FUZZ_CHECK(entry.z2Alert == sample.zone2Alert, "z2_alert: %s", buffer);
+  FUZZ_CHECK(entry.fanOn == sample.highTempAlert, "fan_on: %s", buffer);
+  return 0;
+}
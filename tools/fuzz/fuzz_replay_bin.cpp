@@ -0,0 +1,41 @@
+// Binary replay trace decoder. The input is decoded as a file image both as
+// given and behind a valid header; every decoded record must encode back to
+// its original bytes, padding and unused flag bits aside.
+
+#include <string.h>
+
+#include <vector>
+
+#include "fuzz_support.h"
+#include "replay_format.h"
+
+static void checkImage(const uint8_t* image, size_t size) {
+  std::vector<TraceRow> rows;
+  if (!decodeReplayTrace(image, size, rows)) return;
+
+  size_t expected = (size - REPLAY_HEADER_SIZE) / REPLAY_RECORD_SIZE;
+  FUZZ_CHECK(rows.size() == expected, "%zu bytes decoded to %zu rows, expected %zu", size, rows.size(), expected);
+
+  for (size_t i = 0; i < rows.size(); i++) {
+    const uint8_t* original = image + REPLAY_HEADER_SIZE + i * REPLAY_RECORD_SIZE;
+    uint8_t canonical[REPLAY_RECORD_SIZE];
+    memcpy(canonical, original, REPLAY_RECORD_SIZE);
+    canonical[12] &= 1;
+    memset(canonical + 13, 0, REPLAY_RECORD_SIZE - 13);
+
+    uint8_t encoded[REPLAY_RECORD_SIZE];
+    encodeReplayRecord(rows[i], encoded);
+    FUZZ_CHECK(memcmp(encoded, canonical, REPLAY_RECORD_SIZE) == 0, "record %zu does not round-trip", i);
+  }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  checkImage(data, size);
+
+  std::vector<uint8_t> image(REPLAY_HEADER_SIZE + size);
+  encodeReplayHeader(image.data());
+  if (size > 0) memcpy(image.data() + REPLAY_HEADER_SIZE, data, size);
+  FUZZ_CHECK(decodeReplayHeader(image.data(), image.size()), "own header rejected");
+  checkImage(image.data(), image.size());
+  return 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Shared by the fuzz targets: a byte consumer for building structured inputs
+// and a check macro that aborts, which both libFuzzer and the standalone
+// driver report as a crash with the offending input.
+
+#define FUZZ_CHECK(cond, ...)                                      \
+  do {                                                             \
+    if (!(cond)) {                                                 \
+      fprintf(stderr, "property failed: %s\n  ", #cond);           \
+      fprintf(stderr, __VA_ARGS__);                                \
+      fprintf(stderr, "\n");                                       \
+      abort();                                                     \
+    }                                                              \
+  } while (0)
+
+// Reads past the end return zeros, so every input maps to some value.
+class FuzzInput {
+ public:
+  FuzzInput(const uint8_t* data, size_t size) : data_(data), size_(size), pos_(0) {}
+
+  size_t remaining() const { return size_ - pos_; }
+
+  uint8_t u8() { return pos_ < size_ ? data_[pos_++] : 0; }
+  uint16_t u16() { return (uint16_t)(u8() | (u8() << 8)); }
+  uint32_t u32() { return (uint32_t)u16() | ((uint32_t)u16() << 16); }
+  bool flag() { return (u8() & 1) != 0; }
+
+  float f32bits() {
+    uint32_t bits = u32();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  const uint8_t* bytes(size_t count) {
+    if (count > remaining()) count = remaining();
+    const uint8_t* p = data_ + pos_;
+    pos_ += count;
+    return p;
+  }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t pos_;
+};
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
@@ -0,0 +1,58 @@
+// Trace dump decoder. The input is used twice: as raw serial text, which
+// must decode without crashing and with monotonic unwrapped timestamps, and
+// as a list of 12-byte records, which must survive a round trip through the
+// dump format traceDump() prints.
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "fuzz_support.h"
+#include "trace_dump.h"
+
+static void checkDecoded(const std::vector<DecodedRecord>& records) {
+  for (size_t i = 0; i < records.size(); i++) {
+    FUZZ_CHECK((uint32_t)records[i].timestampUs == records[i].raw.timestampUs, "record %zu: timestamp low bits changed", i);
+    if (i > 0) {
+      FUZZ_CHECK(records[i].timestampUs >= records[i - 1].timestampUs, "record %zu: timestamp went backwards", i);
+    }
+    formatArg(records[i].raw);
+  }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  std::vector<DecodedRecord> records;
+  std::istringstream text(std::string((const char*)data, size));
+  if (readLastDump(text, records)) checkDecoded(records);
+
+  FuzzInput in(data, size);
+  bool crlf = in.flag();
+  std::vector<TraceRecord> sent;
+  while (in.remaining() >= sizeof(TraceRecord)) {
+    TraceRecord r;
+    r.timestampUs = in.u32();
+    r.event = in.u16();
+    r.aux = in.u16();
+    r.arg = (int32_t)in.u32();
+    sent.push_back(r);
+  }
+
+  const char* eol = crlf ? "\r\n" : "\n";
+  std::string dump = std::string("noise before the dump") + eol + "#TRACE v1 records=" + std::to_string(sent.size()) +
+                     " overwritten=0 cpu_mhz=240" + eol;
+  for (const TraceRecord& r : sent) dump += formatRecordLine(r) + eol;
+  dump += std::string("#END") + eol;
+
+  records.clear();
+  std::istringstream roundTrip(dump);
+  FUZZ_CHECK(readLastDump(roundTrip, records), "dump of %zu records not found", sent.size());
+  FUZZ_CHECK(records.size() == sent.size(), "sent %zu records, decoded %zu", sent.size(), records.size());
+  for (size_t i = 0; i < sent.size(); i++) {
+    const TraceRecord& a = sent[i];
+    const TraceRecord& b = records[i].raw;
+    FUZZ_CHECK(a.timestampUs == b.timestampUs && a.event == b.event && a.aux == b.aux && a.arg == b.arg,
+               "record %zu changed in the round trip", i);
+  }
+  checkDecoded(records);
+  return 0;
+}
@@ -0,0 +1,374 @@
+// Local stand-in for supabase/functions/log-sensor-data, for load tests that
+// must not touch the hosted project.
+//
+//   ingest_standin [--port N] [--cert cert.pem --key key.pem]
+//                  [--insert-delay-ms MS] [--rows FILE] [--stats-interval S]
+//                  [--signing-key HEX] [--require-signature]
+//
+// Speaks the same contract as the edge function: POST with
+// Content-Type: application/json, 405/415/400/500 bodies as it returns them,
+// and 201 {"status":"success","data_inserted":<row>} with the row built by
+// lib/ingest_contract, or the compact per-row status for batch uploads.
+// Requests with Prefer: return=minimal get a bodiless 204 instead.
+// Readings with a device and "seq" are deduplicated on that pair, as the
+// database does, with every pair kept in memory for the run.
+// Signed requests (X-Device-Id / X-Signature, see lib/host_http's
+// request_signing.h) are checked against device keys derived from
+// --signing-key, the function's INGEST_SIGNING_KEY; nonces are also kept for
+// the run. --require-signature refuses unsigned requests.
+// Rows are numbered in memory instead of inserted; --insert-delay-ms adds a
+// fixed delay per INSERT statement (one per request, however many rows) to
+// stand in for the database round trip and --rows appends each row to an
+// NDJSON file.
+//
+// One thread per connection, keep-alive honoured. Plain HTTP unless a
+// certificate and key are given (generate a throwaway pair with
+// `openssl req -x509 -newkey rsa:2048 -nodes -subj /CN=localhost -keyout key.pem -out cert.pem`).
+// A JSON stats line goes to stdout every --stats-interval seconds.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#include "host_http.h"
+#include "ingest_contract.h"
+#include "request_signing.h"
+
+static const char FUNCTION_PATH[] = "/functions/v1/log-sensor-data";
+static const size_t MAX_BODY_BYTES = 64 * 1024;
+
+struct ServerStats {
+  std::atomic<uint64_t> connections{0};
+  std::atomic<uint64_t> requests{0};
+  std::atomic<uint64_t> created{0};
+  std::atomic<uint64_t> rows{0};
+  std::atomic<uint64_t> rejected{0};
+  std::atomic<uint64_t> duplicates{0};
+  std::atomic<uint64_t> signedRequests{0};
+  std::atomic<uint64_t> bytesIn{0};
+  std::atomic<uint64_t> bytesOut{0};
+  std::atomic<int> openConnections{0};
+};
+
+static ServerStats stats;
+static std::atomic<uint64_t> nextRowId{1};
+static SSL_CTX* tlsContext = nullptr;
+static uint32_t insertDelayMs = 0;
+static FILE* rowsFile = nullptr;
+static std::mutex rowsMutex;
+static std::unordered_set<std::string> seenReadings;
+static std::mutex seenMutex;
+static std::vector<uint8_t> masterKey;
+static bool requireSignature = false;
+static std::unordered_set<std::string> seenNonces;
+
+static std::string isoTimestampNow() {
+  auto now = std::chrono::system_clock::now();
+  time_t seconds = std::chrono::system_clock::to_time_t(now);
+  long micros = (long)(std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count() % 1000000);
+  struct tm utc;
+  gmtime_r(&seconds, &utc);
+  char buffer[40];
+  size_t n = strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &utc);
+  snprintf(buffer + n, sizeof(buffer) - n, ".%06ld+00:00", micros);
+  return buffer;
+}
+
+static std::string errorBody(const std::string& message) {
+  std::string body = "{\"error\":\"";
+  for (char c : message) {
+    if (c == '"' || c == '\\') body += '\\';
+    body += c;
+  }
+  return body + "\"}";
+}
+
+static bool sendResponse(HttpConnection& connection, int status, const std::string& body, bool keepAlive) {
+  char head[192];
+  if (status == 204) {
+    snprintf(head, sizeof(head), "HTTP/1.1 204 %s\r\nConnection: %s\r\n\r\n", httpReason(status),
+             keepAlive ? "keep-alive" : "close");
+    return connection.writeAll(head);
+  }
+  snprintf(head, sizeof(head),
+           "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+           status, httpReason(status), body.size(), keepAlive ? "keep-alive" : "close");
+  std::string response = head + body;
+  return connection.writeAll(response);
+}
+
+// False for a (device, seq) pair that was stored before; see the
+// sensor_logs_dedup trigger in supabase/migrations.
+static bool firstDelivery(const LogEntry& entry) {
+  if (!entry.hasDevice || !entry.seq.present) return true;
+  std::string key = entry.deviceId + '\0' + jsNumberToString(entry.seq.value);
+  std::lock_guard<std::mutex> lock(seenMutex);
+  if (seenReadings.insert(key).second) return true;
+  stats.duplicates++;
+  return false;
+}
+
+static int64_t nowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// verifySignature() in the edge function: 0 with signer set (empty for an
+// accepted unsigned request), or the status refusing it.
+static int checkRequestSignature(const HttpMessage& request, std::string& signer, std::string& body) {
+  const std::string* header = request.header("x-signature");
+  const std::string* device = request.header("x-device-id");
+  if (!header) {
+    if (!requireSignature) return 0;
+    body = errorBody("Signature required");
+    return 401;
+  }
+  if (masterKey.empty()) {
+    body = errorBody("Internal configuration error");
+    return 500;
+  }
+  std::string nonce;
+  SignatureCheck check = device && !device->empty()
+      ? checkSignature(*header, deriveDeviceKey(masterKey, *device), request.body, nowMs() / 1000, nonce)
+      : SIGNATURE_MALFORMED;
+  if (check != SIGNATURE_OK) {
+    body = errorBody(signatureError(check));
+    return 401;
+  }
+  {
+    std::lock_guard<std::mutex> lock(seenMutex);
+    if (!seenNonces.insert(*device + '/' + nonce).second) {
+      body = errorBody("Replayed request");
+      return 401;
+    }
+  }
+  stats.signedRequests++;
+  signer = *device;
+  return 0;
+}
+
+// One INSERT for every accepted reading, as the edge function does it.
+static int handleBatch(const JsonValue& data, bool minimal, const std::string& signer, std::string& body) {
+  LogBatch batch;
+  int status;
+  std::string error;
+  if (!parseLogBatch(data, nowMs(), batch, status, error)) {
+    body = errorBody(error);
+    return status;
+  }
+  if (batch.rows.empty()) {
+    body = logBatchResponse(batch);
+    return logBatchStatus(batch, minimal);
+  }
+
+  std::vector<BatchRow> stored;
+  for (BatchRow& row : batch.rows) {
+    if (!row.entry.hasDevice && !signer.empty()) {
+      row.entry.hasDevice = true;
+      row.entry.deviceId = signer;
+    }
+    if (firstDelivery(row.entry)) stored.push_back(row); else batch.duplicates++;
+  }
+
+  if (insertDelayMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(insertDelayMs));
+  uint64_t firstId = nextRowId.fetch_add(stored.size());
+  stats.rows += stored.size();
+  if (rowsFile) {
+    std::string createdAt = isoTimestampNow();
+    std::lock_guard<std::mutex> lock(rowsMutex);
+    for (size_t i = 0; i < stored.size(); i++) {
+      fprintf(rowsFile, "%s\n", batchRowToJson(stored[i], firstId + i, createdAt).c_str());
+    }
+  }
+  status = logBatchStatus(batch, minimal);
+  if (status != 204) body = logBatchResponse(batch);
+  return status;
+}
+
+// Same order of checks as the edge function.
+static int handleRequest(const HttpMessage& request, std::string& body) {
+  std::string path = request.target.substr(0, request.target.find('?'));
+  if (path != FUNCTION_PATH) {
+    body = errorBody("Not Found");
+    return 404;
+  }
+  if (request.method != "POST") {
+    body = errorBody("Method Not Allowed");
+    return 405;
+  }
+  const std::string* contentType = request.header("content-type");
+  if (!contentType || *contentType != "application/json") {
+    body = errorBody("Request must be JSON");
+    return 415;
+  }
+
+  std::string signer;
+  int signatureStatus = checkRequestSignature(request, signer, body);
+  if (signatureStatus != 0) return signatureStatus;
+
+  JsonValue data;
+  if (!JsonValue::parse(request.body.data(), request.body.size(), data)) {
+    body = errorBody("Invalid JSON payload");
+    return 400;
+  }
+  if (!signer.empty() && namesOtherDevice(data, signer)) {
+    body = errorBody("Readings name a device other than the signer");
+    return 403;
+  }
+  const std::string* prefer = request.header("prefer");
+  bool minimal = prefer && prefersMinimalAck(*prefer);
+  if (isLogBatch(data)) return handleBatch(data, minimal, signer, body);
+
+  LogEntry entry;
+  std::string error;
+  if (!logEntryFromValue(data, entry, error)) {
+    body = errorBody(error);
+    return 500;
+  }
+  if (!entry.hasDevice && !signer.empty()) {
+    entry.hasDevice = true;
+    entry.deviceId = signer;
+  }
+
+  if (insertDelayMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(insertDelayMs));
+  if (!firstDelivery(entry)) {
+    if (minimal) return 204;
+    body = "{\"status\":\"duplicate\"}";
+    return 200;
+  }
+  std::string row = logEntryToJson(entry, nextRowId++, isoTimestampNow());
+  stats.rows++;
+  if (rowsFile) {
+    std::lock_guard<std::mutex> lock(rowsMutex);
+    fprintf(rowsFile, "%s\n", row.c_str());
+  }
+  if (minimal) return 204;
+  body = "{\"status\":\"success\",\"data_inserted\":" + row + "}";
+  return 201;
+}
+
+static void serveConnection(int fd) {
+  SSL* ssl = nullptr;
+  if (tlsContext) {
+    ssl = tlsAccept(tlsContext, fd);
+    if (!ssl) {
+      close(fd);
+      return;
+    }
+  }
+
+  stats.connections++;
+  stats.openConnections++;
+  {
+    HttpConnection connection(fd, ssl);
+    HttpMessage request;
+    uint64_t countedIn = 0;
+    uint64_t countedOut = 0;
+    while (connection.readMessage(request, true, MAX_BODY_BYTES)) {
+      std::string body;
+      int status = handleRequest(request, body);
+      stats.requests++;
+      if (status == 200 || status == 201 || status == 204) stats.created++; else stats.rejected++;
+
+      bool keepAlive = request.keepAlive();
+      bool sent = sendResponse(connection, status, body, keepAlive);
+      stats.bytesIn += connection.bytesRead() - countedIn;
+      stats.bytesOut += connection.bytesWritten() - countedOut;
+      countedIn = connection.bytesRead();
+      countedOut = connection.bytesWritten();
+      if (!sent || !keepAlive) break;
+    }
+  }
+  stats.openConnections--;
+}
+
+static void reportStats(uint32_t intervalS) {
+  uint64_t lastRequests = 0;
+  uint64_t lastRows = 0;
+  auto last = std::chrono::steady_clock::now();
+  for (;;) {
+    std::this_thread::sleep_for(std::chrono::seconds(intervalS));
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - last).count();
+    uint64_t requests = stats.requests.load();
+    uint64_t rows = stats.rows.load();
+    printf("{\"rps\":%.1f,\"rows_per_s\":%.1f,\"requests\":%llu,\"rows\":%llu,\"created\":%llu,\"rejected\":%llu,\"duplicates\":%llu,\"signed\":%llu,"
+           "\"connections\":%llu,\"open_connections\":%d,\"bytes_in\":%llu,\"bytes_out\":%llu}\n",
+           (requests - lastRequests) / seconds, (rows - lastRows) / seconds, (unsigned long long)requests,
+           (unsigned long long)rows, (unsigned long long)stats.created.load(), (unsigned long long)stats.rejected.load(),
+           (unsigned long long)stats.duplicates.load(), (unsigned long long)stats.signedRequests.load(),
+           (unsigned long long)stats.connections.load(), stats.openConnections.load(),
+           (unsigned long long)stats.bytesIn.load(), (unsigned long long)stats.bytesOut.load());
+    fflush(stdout);
+    lastRequests = requests;
+    lastRows = rows;
+    last = now;
+  }
+}
+
+int main(int argc, char** argv) {
+  uint16_t port = 54321;
+  const char* certPath = nullptr;
+  const char* keyPath = nullptr;
+  const char* rowsPath = nullptr;
+  uint32_t statsInterval = 5;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--require-signature") == 0) {
+      requireSignature = true;
+      continue;
+    }
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!value) { fprintf(stderr, "missing value for %s\n", arg); return 1; }
+    i++;
+    if (strcmp(arg, "--port") == 0) port = (uint16_t)atoi(value);
+    else if (strcmp(arg, "--cert") == 0) certPath = value;
+    else if (strcmp(arg, "--key") == 0) keyPath = value;
+    else if (strcmp(arg, "--insert-delay-ms") == 0) insertDelayMs = (uint32_t)strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--rows") == 0) rowsPath = value;
+    else if (strcmp(arg, "--stats-interval") == 0) statsInterval = (uint32_t)strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--signing-key") == 0) {
+      if (!parseHex(value, masterKey) || masterKey.size() < 16) {
+        fprintf(stderr, "--signing-key wants at least 32 hex digits\n");
+        return 1;
+      }
+    }
+    else { fprintf(stderr, "unknown option %s\n", arg); return 1; }
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+
+  if (certPath || keyPath) {
+    if (!certPath || !keyPath) { fprintf(stderr, "--cert and --key go together\n"); return 1; }
+    tlsContext = createServerTlsContext(certPath, keyPath);
+    if (!tlsContext) { fprintf(stderr, "cannot load %s / %s\n", certPath, keyPath); return 1; }
+  }
+  if (rowsPath) {
+    rowsFile = fopen(rowsPath, "a");
+    if (!rowsFile) { fprintf(stderr, "cannot open %s\n", rowsPath); return 1; }
+  }
+
+  int listener = listenTcp(port);
+  if (listener < 0) { perror("listen"); return 1; }
+  fprintf(stderr, "ingest stand-in on %s://localhost:%u%s\n", tlsContext ? "https" : "http", port, FUNCTION_PATH);
+
+  if (statsInterval > 0) std::thread(reportStats, statsInterval).detach();
+
+  for (;;) {
+    int fd = accept(listener, nullptr, nullptr);
+    if (fd < 0) continue;
+    std::thread(serveConnection, fd).detach();
+  }
+}
@@ -0,0 +1,392 @@
+// Simulated device fleet for end-to-end uplink load tests against
+// tools/ingest_standin (or any log-sensor-data endpoint).
+//
+//   load_driver [--url http://127.0.0.1:54321/functions/v1/log-sensor-data]
+//               [--devices N] [--duration S] [--interval-ms MS]
+//               [--closed-loop] [--keep-alive] [--batch N] [--minimal] [--seed N]
+//               [--signing-key HEX]
+//
+// Each device is a thread running the firmware's cycle: sample the zones
+// through lib/hal_sim, evaluate alerts, encode the payload, POST it, then
+// sleep for what cycleDelay() leaves of the interval. --interval-ms
+// compresses the 30 s firmware cycle so a few hundred devices produce
+// useful load; --closed-loop drops the pacing and posts back to back.
+// Like the firmware, every POST opens a fresh connection (and TLS session
+// for https:// URLs, without certificate checks) unless --keep-alive.
+// --batch N buffers N cycles and sends them as one batch upload
+// ({"device", "readings":[{"ts", ...}]}) to compare against one POST per
+// reading. --minimal sends Prefer: return=minimal, as the firmware does, and
+// expects a bodiless 204; without it the function echoes the stored row.
+// Every reading carries "device" (sim-<seed>-<index>) and "seq", as the
+// firmware's do. --signing-key signs every request as the firmware does,
+// with each device's key derived from that master key (the stand-in's or
+// the function's), and reports the mean time spent signing.
+//
+// Prints one JSON summary line: sustained requests per second, latency
+// percentiles from connect to last response byte, and payload and wire
+// byte counts.
+
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "alerts.h"
+#include "hal.h"
+#include "hal_sim.h"
+#include "host_http.h"
+#include "monitor_config.h"
+#include "monitor_cycle.h"
+#include "payload.h"
+#include "request_signing.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Target {
+  bool tls = false;
+  std::string host;
+  uint16_t port = 0;
+  std::string path;
+};
+
+struct DriverOptions {
+  Target target;
+  uint32_t devices = 200;
+  uint32_t durationS = 30;
+  uint32_t intervalMs = 1000;
+  bool closedLoop = false;
+  bool keepAlive = false;
+  uint32_t batch = 1;
+  bool minimalAck = false;
+  uint32_t seed = 42;
+  std::vector<uint8_t> signingKey;
+};
+
+struct DeviceResult {
+  std::vector<uint32_t> latencyUs;
+  uint64_t ok = 0;
+  uint64_t readings = 0;
+  uint64_t httpErrors = 0;
+  uint64_t connectErrors = 0;
+  uint64_t overruns = 0;
+  uint64_t payloadBytes = 0;
+  uint64_t wireBytesOut = 0;
+  uint64_t wireBytesIn = 0;
+  uint64_t signedRequests = 0;
+  uint64_t signNs = 0;
+};
+
+// hal_sim is a single simulated board, so devices take turns on it: each
+// one loads its own readings, runs the firmware sampling code and keeps the
+// resulting sample. Encoding takes microseconds, so the lock is not what
+// the test measures.
+static std::mutex boardMutex;
+static SSL_CTX* tlsContext = nullptr;
+static std::atomic<bool> stopping{false};
+
+static bool parseUrl(const char* url, Target& target) {
+  std::string s = url;
+  size_t schemeEnd = s.find("://");
+  if (schemeEnd == std::string::npos) return false;
+  std::string scheme = s.substr(0, schemeEnd);
+  if (scheme != "http" && scheme != "https") return false;
+  target.tls = scheme == "https";
+
+  size_t hostStart = schemeEnd + 3;
+  size_t pathStart = s.find('/', hostStart);
+  std::string hostPort = s.substr(hostStart, pathStart == std::string::npos ? std::string::npos : pathStart - hostStart);
+  target.path = pathStart == std::string::npos ? "/" : s.substr(pathStart);
+
+  size_t colon = hostPort.rfind(':');
+  if (colon != std::string::npos && hostPort.find(']') == std::string::npos) {
+    target.host = hostPort.substr(0, colon);
+    target.port = (uint16_t)atoi(hostPort.c_str() + colon + 1);
+  } else {
+    target.host = hostPort;
+    target.port = target.tls ? 443 : 80;
+  }
+  return !target.host.empty() && target.port != 0;
+}
+
+static uint32_t nextRandom(uint32_t& state) {
+  state = state * 1664525u + 1013904223u;
+  return state >> 8;
+}
+
+static float noise(uint32_t& state) {
+  return (nextRandom(state) & 0xFFFF) / 65535.0f - 0.5f;
+}
+
+// Per-device weather: the same daily shape as the native simulator, shifted
+// by a random phase and offset so the fleet does not alert in lockstep.
+static void sampleDevice(uint32_t cycle, float phase, float offset, uint32_t& rng, SensorSample& sample) {
+  const uint32_t cyclesPerDay = 24 * 3600 * 1000 / CYCLE_INTERVAL_MS;
+  float dayFraction = fmodf((float)(cycle % cyclesPerDay) / cyclesPerDay + phase, 1.0f);
+  float daylight = sinf(dayFraction * 2 * (float)M_PI - (float)M_PI / 2);
+
+  std::lock_guard<std::mutex> lock(boardMutex);
+  float zone1Temp = 24.0f + offset + 9.0f * daylight + noise(rng);
+  float zone1Lux = daylight > -0.2f ? 40.0f + 900.0f * (daylight + 0.2f) : 0.0f;
+  simSetAnalog(TEMP_PIN_Z1, simAdcForCelsius(zone1Temp));
+  simSetAnalog(LIGHT_PIN_Z1, simAdcForLux(zone1Lux));
+  if (nextRandom(rng) % 97 == 0) {
+    simSetClimateFailure(1);
+  } else {
+    simSetClimate(21.0f + offset * 0.5f + 4.0f * daylight, 60.0f + 15.0f * -daylight + noise(rng) * 4.0f);
+  }
+
+  sampleAnalogZone(sample);
+  sampleClimateZone(sample);
+  evaluateAlerts(sample);
+}
+
+static std::unique_ptr<HttpConnection> openConnection(const Target& target) {
+  int fd = connectTcp(target.host.c_str(), target.port);
+  if (fd < 0) return nullptr;
+  SSL* ssl = nullptr;
+  if (target.tls) {
+    ssl = tlsConnect(tlsContext, fd, target.host.c_str());
+    if (!ssl) {
+      close(fd);
+      return nullptr;
+    }
+  }
+  return std::unique_ptr<HttpConnection>(new HttpConnection(fd, ssl));
+}
+
+// Request head as the ESP32 HTTPClient sends it; signature holds the
+// X-Device-Id and X-Signature lines of a signed request.
+static std::string requestHead(const Target& target, size_t length, bool minimalAck, const std::string& signature) {
+  char head[512];
+  snprintf(head, sizeof(head),
+           "POST %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: ESP32HTTPClient\r\nConnection: keep-alive\r\n"
+           "Accept-Encoding: identity;q=1,chunked;q=0.1,*;q=0\r\nContent-Type: application/json\r\n"
+           "%s%sContent-Length: %zu\r\n\r\n",
+           target.path.c_str(), target.host.c_str(), minimalAck ? "Prefer: return=minimal\r\n" : "",
+           signature.c_str(), length);
+  return head;
+}
+
+static int64_t epochMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// The payload object with the reading time spliced in front of its fields.
+static void appendReading(std::string& body, const char* payload, size_t length, int64_t ts) {
+  if (body.back() != '[') body += ',';
+  body += "{\"ts\":" + std::to_string(ts) + ",";
+  body.append(payload + 1, length - 1);
+}
+
+static void waitForNextCycle(const DriverOptions& options, const SensorSample& sample, uint32_t cycleStart,
+                             uint32_t now, uint32_t minDelayMs, DeviceResult& result) {
+  uint32_t blockedMs = (sample.zone1Alert || sample.zone2Alert) ? options.intervalMs * BUZZER_PULSE_MS / CYCLE_INTERVAL_MS : 0;
+  CycleDelay next = cycleDelay(cycleStart, now, blockedMs, options.intervalMs, minDelayMs);
+  if (next.overrun) result.overruns++;
+  uint32_t waitMs = next.delayMs + blockedMs;
+  while (waitMs > 0 && !stopping) {
+    uint32_t step = std::min<uint32_t>(waitMs, 100);
+    std::this_thread::sleep_for(std::chrono::milliseconds(step));
+    waitMs -= step;
+  }
+}
+
+static void runDevice(uint32_t index, const DriverOptions& options, DeviceResult& result) {
+  uint32_t rng = options.seed * 2654435761u + index * 40503u + 1;
+  float phase = (nextRandom(rng) & 0xFFFF) / 65536.0f;
+  float offset = noise(rng) * 6.0f;
+  uint32_t cycle = nextRandom(rng) % 2880;
+
+  SensorSample sample;
+  char payload[PAYLOAD_BUFFER_SIZE];
+  std::unique_ptr<HttpConnection> connection;
+  // Sequence numbers restart with every run, so the seed is part of the
+  // name: rerun with another --seed to keep the stand-in's dedup out of it.
+  char deviceId[32];
+  snprintf(deviceId, sizeof(deviceId), "sim-%u-%04u", options.seed, index);
+  uint32_t seq = 0;
+  bool signing = !options.signingKey.empty();
+  SigningKey key = signing ? deriveDeviceKey(options.signingKey, deviceId) : SigningKey();
+  char batchHead[64];
+  snprintf(batchHead, sizeof(batchHead), "{\"device\":\"%s\",\"readings\":[", deviceId);
+  std::string batchBody = batchHead;
+  uint32_t batched = 0;
+  // Same proportion of the interval as the firmware's 100 ms floor.
+  uint32_t minDelayMs = options.intervalMs * 100 / CYCLE_INTERVAL_MS;
+
+  // Spread first posts over one interval instead of starting in lockstep.
+  if (!options.closedLoop) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(nextRandom(rng) % (options.intervalMs + 1)));
+  }
+
+  auto epoch = Clock::now();
+  auto elapsedMs = [&epoch]() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - epoch).count();
+  };
+
+  while (!stopping) {
+    uint32_t cycleStart = elapsedMs();
+    sampleDevice(cycle++, phase, offset, rng, sample);
+    // As the firmware: the device name and a sequence number per reading.
+    JsonWriter json(payload, sizeof(payload));
+    beginPayload(json, sample);
+    appendIdentity(json, options.batch > 1 ? nullptr : deviceId, seq++);
+    endPayload(json);
+    size_t length = json.ok() ? json.length() : 0;
+    const char* body = payload;
+    if (options.batch > 1) {
+      appendReading(batchBody, payload, length, epochMs());
+      if (++batched < options.batch) {
+        if (!options.closedLoop) waitForNextCycle(options, sample, cycleStart, elapsedMs(), minDelayMs, result);
+        continue;
+      }
+      batchBody += "]}";
+      body = batchBody.data();
+      length = batchBody.size();
+    }
+    result.payloadBytes += length;
+
+    std::string signature;
+    if (signing) {
+      auto signStart = Clock::now();
+      int64_t unixS = epochMs() / 1000;
+      signature = "X-Device-Id: " + std::string(deviceId) + "\r\nX-Signature: " +
+                  signatureHeader(key, unixS, randomNonce(), body, length) + "\r\n";
+      result.signNs += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - signStart).count();
+      result.signedRequests++;
+    }
+
+    auto requestStart = Clock::now();
+    if (!connection) connection = openConnection(options.target);
+    bool ok = false;
+    HttpMessage response;
+    if (!connection) {
+      result.connectErrors++;
+    } else {
+      uint64_t writtenBefore = connection->bytesWritten();
+      uint64_t readBefore = connection->bytesRead();
+      std::string request = requestHead(options.target, length, options.minimalAck, signature);
+      request.append(body, length);
+      ok = connection->writeAll(request) && connection->readMessage(response, false);
+      result.wireBytesOut += connection->bytesWritten() - writtenBefore;
+      result.wireBytesIn += connection->bytesRead() - readBefore;
+      if (!ok) result.connectErrors++;
+    }
+    if (ok) {
+      auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - requestStart).count();
+      result.latencyUs.push_back((uint32_t)us);
+      if (uplinkAccepted(response.status)) {
+        result.ok++;
+        result.readings += options.batch;
+      } else {
+        result.httpErrors++;
+      }
+    }
+    if (!ok || !options.keepAlive || !response.keepAlive()) connection.reset();
+    batchBody.resize(strlen(batchHead));
+    batched = 0;
+
+    if (!options.closedLoop) waitForNextCycle(options, sample, cycleStart, elapsedMs(), minDelayMs, result);
+  }
+}
+
+static double percentileMs(const std::vector<uint32_t>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+  if (rank > 0) rank--;
+  return sorted[std::min(rank, sorted.size() - 1)] / 1000.0;
+}
+
+int main(int argc, char** argv) {
+  DriverOptions options;
+  const char* url = "http://127.0.0.1:54321/functions/v1/log-sensor-data";
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--closed-loop") == 0) { options.closedLoop = true; continue; }
+    if (strcmp(arg, "--keep-alive") == 0) { options.keepAlive = true; continue; }
+    if (strcmp(arg, "--minimal") == 0) { options.minimalAck = true; continue; }
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!value) { fprintf(stderr, "missing value for %s\n", arg); return 1; }
+    i++;
+    if (strcmp(arg, "--url") == 0) url = value;
+    else if (strcmp(arg, "--devices") == 0) options.devices = (uint32_t)strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--duration") == 0) options.durationS = (uint32_t)strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--interval-ms") == 0) options.intervalMs = (uint32_t)strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--batch") == 0) options.batch = (uint32_t)strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--seed") == 0) options.seed = (uint32_t)strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--signing-key") == 0) {
+      if (!parseHex(value, options.signingKey) || options.signingKey.size() < 16) {
+        fprintf(stderr, "--signing-key wants at least 32 hex digits\n");
+        return 1;
+      }
+    }
+    else { fprintf(stderr, "unknown option %s\n", arg); return 1; }
+  }
+  if (!parseUrl(url, options.target)) { fprintf(stderr, "cannot parse URL %s\n", url); return 1; }
+  if (options.devices == 0 || options.intervalMs == 0 || options.batch == 0) {
+    fprintf(stderr, "--devices, --interval-ms and --batch must be positive\n");
+    return 1;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  if (options.target.tls) tlsContext = createClientTlsContext();
+
+  simReset();
+  std::vector<DeviceResult> results(options.devices);
+  std::vector<std::thread> threads;
+  threads.reserve(options.devices);
+  auto start = Clock::now();
+  for (uint32_t i = 0; i < options.devices; i++) {
+    threads.emplace_back(runDevice, i, std::cref(options), std::ref(results[i]));
+  }
+  std::this_thread::sleep_for(std::chrono::seconds(options.durationS));
+  stopping = true;
+  for (std::thread& t : threads) t.join();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  DeviceResult total;
+  for (DeviceResult& r : results) {
+    total.latencyUs.insert(total.latencyUs.end(), r.latencyUs.begin(), r.latencyUs.end());
+    total.ok += r.ok;
+    total.readings += r.readings;
+    total.httpErrors += r.httpErrors;
+    total.connectErrors += r.connectErrors;
+    total.overruns += r.overruns;
+    total.payloadBytes += r.payloadBytes;
+    total.wireBytesOut += r.wireBytesOut;
+    total.wireBytesIn += r.wireBytesIn;
+    total.signedRequests += r.signedRequests;
+    total.signNs += r.signNs;
+  }
+  std::sort(total.latencyUs.begin(), total.latencyUs.end());
+  uint64_t attempts = total.latencyUs.size() + total.connectErrors;
+
+  printf("{\"devices\":%u,\"mode\":\"%s\",\"interval_ms\":%u,\"batch\":%u,\"minimal_ack\":%s,\"keep_alive\":%s,\"tls\":%s,\"duration_s\":%.2f,"
+         "\"requests\":%llu,\"ok\":%llu,\"http_errors\":%llu,\"connect_errors\":%llu,\"overruns\":%llu,"
+         "\"rps\":%.1f,\"readings_per_s\":%.1f,\"latency_ms\":{\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"p999\":%.3f,\"max\":%.3f},"
+         "\"payload_bytes\":{\"total\":%llu,\"mean\":%.1f},\"wire_bytes\":{\"out\":%llu,\"in\":%llu},\"sign_us\":%.2f}\n",
+         options.devices, options.closedLoop ? "closed" : "paced", options.intervalMs, options.batch,
+         options.minimalAck ? "true" : "false", options.keepAlive ? "true" : "false", options.target.tls ? "true" : "false", seconds,
+         (unsigned long long)attempts, (unsigned long long)total.ok, (unsigned long long)total.httpErrors,
+         (unsigned long long)total.connectErrors, (unsigned long long)total.overruns,
+         total.ok / seconds, total.readings / seconds,
+         percentileMs(total.latencyUs, 50), percentileMs(total.latencyUs, 90), percentileMs(total.latencyUs, 99),
+         percentileMs(total.latencyUs, 99.9), percentileMs(total.latencyUs, 100),
+         (unsigned long long)total.payloadBytes, attempts ? (double)total.payloadBytes / attempts : 0.0,
+         (unsigned long long)total.wireBytesOut, (unsigned long long)total.wireBytesIn,
+         total.signedRequests ? total.signNs / 1000.0 / total.signedRequests : 0.0);
+  return total.connectErrors == attempts ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+// Runs the monitor cycle on Linux against lib/hal_sim.
+//
+//   pio run -e native && .pio/build/native/program [--cycles N] [--quiet]
+//
+// Drives a synthetic day: zone 1 warms past the temperature threshold in the
+// afternoon and goes dark at night, zone 2 gets humid and drops a few DHT
+// reads. Each cycle goes through the same sampling, alert, LCD formatting,
+// payload encoding and scheduling code as the firmware, with the uplink
+// landing in the simulated HTTP sink.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alerts.h"
+#include "hal.h"
+#include "hal_sim.h"
+#include "lcd_format.h"
+#include "monitor_config.h"
+#include "monitor_cycle.h"
+#include "payload.h"
+
+static void applyScenario(uint32_t cycle, uint32_t cyclesPerDay) {
+  float dayFraction = (float)(cycle % cyclesPerDay) / cyclesPerDay;
+  float daylight = sinf(dayFraction * 2 * (float)M_PI - (float)M_PI / 2);
+
+  float zone1Temp = 24.0f + 9.0f * daylight;
+  float zone1Lux = daylight > -0.2f ? 40.0f + 900.0f * (daylight + 0.2f) : 0.0f;
+  simSetAnalog(TEMP_PIN_Z1, simAdcForCelsius(zone1Temp));
+  simSetAnalog(LIGHT_PIN_Z1, simAdcForLux(zone1Lux));
+
+  if (cycle % 97 == 13) {
+    simSetClimateFailure(1);
+  } else {
+    simSetClimate(21.0f + 4.0f * daylight, 60.0f + 15.0f * -daylight);
+  }
+}
+
+int main(int argc, char** argv) {
+  uint32_t cycles = 2880;
+  bool quiet = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+      cycles = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--quiet") == 0) {
+      quiet = true;
+    } else {
+      fprintf(stderr, "usage: %s [--cycles N] [--quiet]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  const uint32_t cyclesPerDay = 24 * 3600 * 1000 / CYCLE_INTERVAL_MS;
+
+  simReset();
+  setupIndicators();
+
+  SensorSample sample;
+  char payload[PAYLOAD_BUFFER_SIZE];
+  char lcd1Lines[LCD1_ROWS][LCD_LINE_BUFFER];
+  char lcd2Lines[LCD2_ROWS][LCD_LINE_BUFFER];
+  uint32_t alertCycles = 0;
+  uint32_t overruns = 0;
+  uint32_t failedPosts = 0;
+
+  for (uint32_t cycle = 0; cycle < cycles; cycle++) {
+    applyScenario(cycle, cyclesPerDay);
+    uint32_t cycleStart = halMillis();
+
+    sampleAnalogZone(sample);
+    sampleClimateZone(sample);
+    evaluateAlerts(sample);
+    uint32_t blockedMs = driveIndicators(sample);
+    formatLcd1(sample, lcd1Lines);
+    formatLcd2(sample, true, lcd2Lines);
+
+    size_t length = encodePayload(sample, payload, sizeof(payload));
+    int status = halHttpPost(payload, length);
+    if (!uplinkAccepted(status)) failedPosts++;
+    if (sample.zone1Alert || sample.zone2Alert) alertCycles++;
+
+    if (!quiet) {
+      printf("[%8.1f s] %-16s | %-20s | %s\n", cycleStart / 1000.0, lcd1Lines[0], lcd2Lines[0], payload);
+    }
+
+    CycleDelay next = cycleDelay(cycleStart, halMillis(), blockedMs, CYCLE_INTERVAL_MS);
+    if (next.overrun) overruns++;
+    halDelay(next.delayMs);
+  }
+
+  const SimHttpSink& sink = simHttpSink();
+  printf("cycles=%lu simulated_s=%.0f alert_cycles=%lu overruns=%lu posts=%lu failed_posts=%lu uplink_bytes=%llu\n",
+         (unsigned long)cycles, halMillis() / 1000.0, (unsigned long)alertCycles, (unsigned long)overruns,
+         (unsigned long)sink.posts, (unsigned long)failedPosts, (unsigned long long)sink.bytes);
+  return 0;
+}
@@ -0,0 +1,265 @@
+// Replays recorded or synthetic sensor traces through the firmware's
+// sampling, conversion, alert and payload code on the host.
+//
+//   replay --csv trace.csv [options]
+//   replay --bin trace.bin [options]
+//   replay --synthetic DAYS [--seed N] [options]
+//
+// Options:
+//   --temp-high C        zone temperature alert threshold (default from monitor_config.h)
+//   --lux-low LUX        zone 1 low-light threshold
+//   --humidity-high PCT  zone 2 humidity threshold
+//   --transitions        print every alert transition as CSV
+//   --write-csv FILE     save the input trace as CSV (handy with --synthetic)
+//   --write-bin FILE     save the input trace in the binary format
+//
+// CSV columns: t_ms,ntc_adc,ldr_adc,dht_temp_c,dht_humidity
+// (leave both DHT columns empty for a failed read). The binary format is
+// described in replay_format.h.
+//
+// Each record is one firmware cycle. The summary line is JSON.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "alerts.h"
+#include "hal.h"
+#include "hal_sim.h"
+#include "monitor_config.h"
+#include "monitor_cycle.h"
+#include "payload.h"
+#include "replay_format.h"
+
+static bool loadCsv(const char* path, std::vector<TraceRow>& rows) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#' || line[0] == 't' || line[0] == '\n') continue;
+
+    TraceRow row = {};
+    char* fields[5] = {};
+    int n = 0;
+    char* p = line;
+    while (n < 5) {
+      fields[n++] = p;
+      char* comma = strchr(p, ',');
+      if (!comma) break;
+      *comma = '\0';
+      p = comma + 1;
+    }
+    if (n < 3) continue;
+
+    row.tMs = (uint32_t)strtoul(fields[0], NULL, 10);
+    row.ntcAdc = (uint16_t)atoi(fields[1]);
+    row.ldrAdc = (uint16_t)atoi(fields[2]);
+    row.dhtOk = n >= 5 && fields[3][0] != '\0' && fields[3][0] != '\n' && fields[4][0] != '\0' && fields[4][0] != '\n';
+    if (row.dhtOk) {
+      row.dhtTemp = strtof(fields[3], NULL);
+      row.dhtHumidity = strtof(fields[4], NULL);
+    }
+    rows.push_back(row);
+  }
+  fclose(f);
+  return true;
+}
+
+static bool writeCsv(const char* path, const std::vector<TraceRow>& rows) {
+  FILE* f = fopen(path, "w");
+  if (!f) return false;
+  fprintf(f, "t_ms,ntc_adc,ldr_adc,dht_temp_c,dht_humidity\n");
+  for (const TraceRow& r : rows) {
+    if (r.dhtOk) {
+      fprintf(f, "%lu,%u,%u,%.2f,%.2f\n", (unsigned long)r.tMs, r.ntcAdc, r.ldrAdc, r.dhtTemp, r.dhtHumidity);
+    } else {
+      fprintf(f, "%lu,%u,%u,,\n", (unsigned long)r.tMs, r.ntcAdc, r.ldrAdc);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static bool loadBin(const char* path, std::vector<TraceRow>& rows) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+
+  std::vector<uint8_t> image;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) image.insert(image.end(), chunk, chunk + n);
+  fclose(f);
+
+  if (!decodeReplayTrace(image.data(), image.size(), rows)) {
+    fprintf(stderr, "%s: not a version %u replay trace\n", path, REPLAY_BIN_VERSION);
+    return false;
+  }
+  return true;
+}
+
+static bool writeBin(const char* path, const std::vector<TraceRow>& rows) {
+  FILE* f = fopen(path, "wb");
+  if (!f) return false;
+
+  uint8_t header[REPLAY_HEADER_SIZE];
+  encodeReplayHeader(header);
+  fwrite(header, 1, sizeof(header), f);
+
+  for (const TraceRow& r : rows) {
+    uint8_t rec[REPLAY_RECORD_SIZE];
+    encodeReplayRecord(r, rec);
+    fwrite(rec, 1, sizeof(rec), f);
+  }
+  fclose(f);
+  return true;
+}
+
+// Deterministic weather: a daily temperature and light cycle with slow
+// day-to-day drift, sensor noise and occasional DHT dropouts.
+static void generateSynthetic(uint32_t days, uint32_t seed, std::vector<TraceRow>& rows) {
+  uint32_t state = seed ? seed : 1;
+  auto noise = [&state]() {
+    state = state * 1664525u + 1013904223u;
+    return ((state >> 8) & 0xFFFF) / 65535.0f - 0.5f;
+  };
+
+  const uint32_t cyclesPerDay = 24 * 3600 * 1000 / CYCLE_INTERVAL_MS;
+  float drift = 0;
+  for (uint32_t day = 0; day < days; day++) {
+    drift = drift * 0.7f + noise() * 6.0f;
+    for (uint32_t c = 0; c < cyclesPerDay; c++) {
+      float phase = (float)c / cyclesPerDay;
+      float daylight = sinf(phase * 2 * (float)M_PI - (float)M_PI / 2);
+
+      TraceRow row;
+      row.tMs = (day * cyclesPerDay + c) * CYCLE_INTERVAL_MS;
+      float zone1Temp = 25.0f + drift + 7.0f * daylight + noise() * 0.6f;
+      float zone1Lux = daylight > -0.15f ? (daylight + 0.15f) * 1100.0f + noise() * 20.0f : 0.0f;
+      row.ntcAdc = (uint16_t)simAdcForCelsius(zone1Temp);
+      row.ldrAdc = (uint16_t)simAdcForLux(zone1Lux);
+      row.dhtOk = noise() > -0.49f;
+      row.dhtTemp = 21.0f + drift * 0.5f + 3.0f * daylight + noise() * 0.4f;
+      row.dhtHumidity = 62.0f - 12.0f * daylight + noise() * 4.0f;
+      rows.push_back(row);
+    }
+  }
+}
+
+struct ZoneTracker {
+  const char* name;
+  bool active;
+  uint32_t transitions;
+  uint32_t onTransitions;
+  uint32_t alertCycles;
+};
+
+static void track(ZoneTracker& zone, bool alert, uint32_t tMs, bool printTransitions) {
+  if (alert) zone.alertCycles++;
+  if (alert == zone.active) return;
+  zone.active = alert;
+  zone.transitions++;
+  if (alert) zone.onTransitions++;
+  if (printTransitions) printf("%.1f,%s,%s\n", tMs / 1000.0, zone.name, alert ? "on" : "off");
+}
+
+int main(int argc, char** argv) {
+  const char* csvPath = NULL;
+  const char* binPath = NULL;
+  const char* writeCsvPath = NULL;
+  const char* writeBinPath = NULL;
+  uint32_t syntheticDays = 0;
+  uint32_t seed = 42;
+  bool printTransitions = false;
+  AlertThresholds thresholds;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(arg, "--transitions") == 0) { printTransitions = true; continue; }
+    if (!value) { fprintf(stderr, "missing value for %s\n", arg); return 1; }
+    i++;
+    if (strcmp(arg, "--csv") == 0) csvPath = value;
+    else if (strcmp(arg, "--bin") == 0) binPath = value;
+    else if (strcmp(arg, "--synthetic") == 0) syntheticDays = (uint32_t)strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--seed") == 0) seed = (uint32_t)strtoul(value, NULL, 10);
+    else if (strcmp(arg, "--temp-high") == 0) thresholds.tempHigh = strtof(value, NULL);
+    else if (strcmp(arg, "--lux-low") == 0) thresholds.lightLow = strtof(value, NULL);
+    else if (strcmp(arg, "--humidity-high") == 0) thresholds.humidityHigh = strtof(value, NULL);
+    else if (strcmp(arg, "--write-csv") == 0) writeCsvPath = value;
+    else if (strcmp(arg, "--write-bin") == 0) writeBinPath = value;
+    else { fprintf(stderr, "unknown option %s\n", arg); return 1; }
+  }
+
+  std::vector<TraceRow> rows;
+  if (csvPath) {
+    if (!loadCsv(csvPath, rows)) { fprintf(stderr, "cannot read %s\n", csvPath); return 1; }
+  } else if (binPath) {
+    if (!loadBin(binPath, rows)) { fprintf(stderr, "cannot read %s\n", binPath); return 1; }
+  } else if (syntheticDays > 0) {
+    generateSynthetic(syntheticDays, seed, rows);
+  } else {
+    fprintf(stderr, "usage: %s (--csv FILE | --bin FILE | --synthetic DAYS) [options]\n", argv[0]);
+    return 1;
+  }
+
+  if (writeCsvPath && !writeCsv(writeCsvPath, rows)) { fprintf(stderr, "cannot write %s\n", writeCsvPath); return 1; }
+  if (writeBinPath && !writeBin(writeBinPath, rows)) { fprintf(stderr, "cannot write %s\n", writeBinPath); return 1; }
+
+  simReset();
+  SensorSample sample;
+  char payload[PAYLOAD_BUFFER_SIZE];
+  ZoneTracker zone1 = {"zone1", false, 0, 0, 0};
+  ZoneTracker zone2 = {"zone2", false, 0, 0, 0};
+  ZoneTracker fan = {"fan", false, 0, 0, 0};
+  uint32_t perReadingNotifications = 0;
+  uint32_t ntcFaults = 0;
+  uint32_t dhtFailures = 0;
+  uint64_t uplinkBytes = 0;
+
+  if (printTransitions) printf("t_s,zone,state\n");
+
+  auto wallStart = std::chrono::steady_clock::now();
+  for (const TraceRow& row : rows) {
+    simSetAnalog(TEMP_PIN_Z1, row.ntcAdc);
+    simSetAnalog(LIGHT_PIN_Z1, row.ldrAdc);
+    if (row.dhtOk) simSetClimate(row.dhtTemp, row.dhtHumidity); else simSetClimateFailure(1);
+
+    sampleAnalogZone(sample);
+    sampleClimateZone(sample);
+    evaluateAlerts(sample, thresholds);
+    uplinkBytes += encodePayload(sample, payload, sizeof(payload));
+
+    if (sample.ntcStatus != NTC_OK) ntcFaults++;
+    if (!sample.climateOk) dhtFailures++;
+
+    // One push per reading that carries an alert, as the edge function did
+    // before it kept per-zone notification state.
+    if (sample.zone1Alert || sample.zone2Alert) perReadingNotifications++;
+
+    track(zone1, sample.zone1Alert, row.tMs, printTransitions);
+    track(zone2, sample.zone2Alert, row.tMs, printTransitions);
+    track(fan, sample.highTempAlert, row.tMs, printTransitions);
+  }
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  double simulatedSeconds = rows.empty() ? 0 : (rows.back().tMs - rows.front().tMs) / 1000.0 + CYCLE_INTERVAL_MS / 1000.0;
+  printf("{\"cycles\":%zu,\"simulated_s\":%.0f,\"wall_s\":%.4f,\"cycles_per_s\":%.0f,"
+         "\"thresholds\":{\"temp_high\":%.2f,\"lux_low\":%.2f,\"humidity_high\":%.2f},"
+         "\"zone1\":{\"transitions\":%u,\"alert_cycles\":%u},\"zone2\":{\"transitions\":%u,\"alert_cycles\":%u},"
+         "\"fan\":{\"transitions\":%u,\"on_cycles\":%u},"
+         "\"notifications_per_reading\":%u,\"notifications_on_transition\":%u,"
+         "\"ntc_faults\":%u,\"dht_failures\":%u,\"uplink_bytes\":%llu}\n",
+         rows.size(), simulatedSeconds, wallSeconds, wallSeconds > 0 ? rows.size() / wallSeconds : 0.0,
+         thresholds.tempHigh, thresholds.lightLow, thresholds.humidityHigh,
+         zone1.transitions, zone1.alertCycles, zone2.transitions, zone2.alertCycles,
+         fan.transitions, fan.alertCycles,
+         perReadingNotifications, zone1.onTransitions + zone2.onTransitions,
+         ntcFaults, dhtFailures, (unsigned long long)uplinkBytes);
+  return 0;
+}
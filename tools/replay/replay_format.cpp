@@ -0,0 +1,60 @@
+#include "replay_format.h"
+
+#include <math.h>
+#include <string.h>
+
+static const char BIN_MAGIC[4] = {'M', 'Z', 'R', 'P'};
+
+static void putU16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+static void putU32(uint8_t* p, uint32_t v) { putU16(p, v & 0xFFFF); putU16(p + 2, v >> 16); }
+static uint16_t getU16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t getU32(const uint8_t* p) { return getU16(p) | ((uint32_t)getU16(p + 2) << 16); }
+
+// Hundredths, clamped to the field; NaN stores as 0.
+static long centi(float value, long lo, long hi) {
+  if (!(value == value)) return 0;
+  float scaled = value * 100;
+  if (scaled <= (float)lo) return lo;
+  if (scaled >= (float)hi) return hi;
+  return lroundf(scaled);
+}
+
+void encodeReplayHeader(uint8_t header[REPLAY_HEADER_SIZE]) {
+  memcpy(header, BIN_MAGIC, 4);
+  putU16(header + 4, REPLAY_BIN_VERSION);
+  putU16(header + 6, REPLAY_RECORD_SIZE);
+}
+
+bool decodeReplayHeader(const uint8_t* data, size_t length) {
+  return length >= REPLAY_HEADER_SIZE && memcmp(data, BIN_MAGIC, 4) == 0 &&
+         getU16(data + 4) == REPLAY_BIN_VERSION && getU16(data + 6) == REPLAY_RECORD_SIZE;
+}
+
+void encodeReplayRecord(const TraceRow& row, uint8_t record[REPLAY_RECORD_SIZE]) {
+  memset(record, 0, REPLAY_RECORD_SIZE);
+  putU32(record, row.tMs);
+  putU16(record + 4, row.ntcAdc);
+  putU16(record + 6, row.ldrAdc);
+  putU16(record + 8, (uint16_t)(int16_t)centi(row.dhtTemp, INT16_MIN, INT16_MAX));
+  putU16(record + 10, (uint16_t)centi(row.dhtHumidity, 0, UINT16_MAX));
+  record[12] = row.dhtOk ? 1 : 0;
+}
+
+void decodeReplayRecord(const uint8_t record[REPLAY_RECORD_SIZE], TraceRow& row) {
+  row.tMs = getU32(record);
+  row.ntcAdc = getU16(record + 4);
+  row.ldrAdc = getU16(record + 6);
+  row.dhtTemp = (int16_t)getU16(record + 8) / 100.0f;
+  row.dhtHumidity = getU16(record + 10) / 100.0f;
+  row.dhtOk = (record[12] & 1) != 0;
+}
+
+bool decodeReplayTrace(const uint8_t* data, size_t length, std::vector<TraceRow>& rows) {
+  if (!decodeReplayHeader(data, length)) return false;
+  for (size_t offset = REPLAY_HEADER_SIZE; offset + REPLAY_RECORD_SIZE <= length; offset += REPLAY_RECORD_SIZE) {
+    TraceRow row;
+    decodeReplayRecord(data + offset, row);
+    rows.push_back(row);
+  }
+  return true;
+}
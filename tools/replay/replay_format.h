@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Binary replay trace: an 8-byte header "MZRP", u16 version, u16 record
+// size, then 16-byte little-endian records: u32 t_ms, u16 ntc_adc,
+// u16 ldr_adc, i16 dht_temp_centi_c, u16 dht_humidity_centi_pct,
+// u8 flags (bit 0 = DHT ok), 3 pad bytes.
+
+struct TraceRow {
+  uint32_t tMs;
+  uint16_t ntcAdc;
+  uint16_t ldrAdc;
+  float dhtTemp;
+  float dhtHumidity;
+  bool dhtOk;
+};
+
+const uint16_t REPLAY_BIN_VERSION = 1;
+const size_t REPLAY_HEADER_SIZE = 8;
+const size_t REPLAY_RECORD_SIZE = 16;
+
+void encodeReplayHeader(uint8_t header[REPLAY_HEADER_SIZE]);
+bool decodeReplayHeader(const uint8_t* data, size_t length);
+
+// Temperatures and humidity are stored in hundredths; values outside the
+// field's range saturate instead of wrapping.
+void encodeReplayRecord(const TraceRow& row, uint8_t record[REPLAY_RECORD_SIZE]);
+void decodeReplayRecord(const uint8_t record[REPLAY_RECORD_SIZE], TraceRow& row);
+
+// A whole file image. A trailing partial record is ignored, as a capture cut
+// off mid-write would leave one.
+bool decodeReplayTrace(const uint8_t* data, size_t length, std::vector<TraceRow>& rows);
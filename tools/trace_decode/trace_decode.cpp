@@ -0,0 +1,115 @@
+// Host-side decoder for trace dumps produced by the `trace` serial command.
+//
+//   trace_decode [--chrome] [capture.log]
+//
+// Reads a serial capture (stdin when no file is given), finds the last
+// "#TRACE ... #END" block and prints one line per record, or Chrome trace
+// JSON with --chrome (load it in chrome://tracing or ui.perfetto.dev).
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "profile_phases.h"
+#include "trace_dump.h"
+#include "trace_events.h"
+
+static void printText(const std::vector<DecodedRecord>& records) {
+  for (const DecodedRecord& d : records) {
+    const TraceEventInfo& info = traceEventInfo(d.raw.event);
+    std::string arg = formatArg(d.raw);
+    printf("%12.6f  %-22s", d.timestampUs / 1e6, info.name);
+    if (info.auxLabel) printf(" %s=%u", info.auxLabel, d.raw.aux);
+    if (!arg.empty()) printf(" %s", arg.c_str());
+    printf("\n");
+  }
+}
+
+static void printJsonString(const char* s) {
+  putchar('"');
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') putchar('\\');
+    putchar(*s);
+  }
+  putchar('"');
+}
+
+static void printChrome(const std::vector<DecodedRecord>& records) {
+  printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool first = true;
+  for (const DecodedRecord& d : records) {
+    const TraceEventInfo& info = traceEventInfo(d.raw.event);
+    if (!first) printf(",\n");
+    first = false;
+
+    if (d.raw.event == TRACE_PHASE_BEGIN || d.raw.event == TRACE_PHASE_END) {
+      printf("{\"name\":");
+      printJsonString(profilePhaseName(d.raw.aux));
+      printf(",\"ph\":\"%s\",\"ts\":%llu,\"pid\":1,\"tid\":1}",
+             d.raw.event == TRACE_PHASE_BEGIN ? "B" : "E", (unsigned long long)d.timestampUs);
+      continue;
+    }
+
+    printf("{\"name\":");
+    printJsonString(info.name);
+    printf(",\"ph\":\"i\",\"s\":\"g\",\"ts\":%llu,\"pid\":1,\"tid\":1,\"args\":{", (unsigned long long)d.timestampUs);
+    bool hasArg = false;
+    if (info.auxLabel) {
+      printJsonString(info.auxLabel);
+      printf(":%u", d.raw.aux);
+      hasArg = true;
+    }
+    std::string arg = formatArg(d.raw);
+    if (!arg.empty()) {
+      if (hasArg) printf(",");
+      printf("\"value\":");
+      printJsonString(arg.c_str());
+    }
+    printf("}}");
+  }
+  printf("\n]}\n");
+}
+
+int main(int argc, char** argv) {
+  bool chrome = false;
+  const char* path = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--chrome") == 0) {
+      chrome = true;
+    } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      fprintf(stderr, "usage: %s [--chrome] [capture.log]\n", argv[0]);
+      return 0;
+    } else {
+      path = argv[i];
+    }
+  }
+
+  std::vector<DecodedRecord> records;
+  bool found;
+  if (path) {
+    std::ifstream file(path);
+    if (!file) {
+      fprintf(stderr, "cannot open %s\n", path);
+      return 1;
+    }
+    found = readLastDump(file, records);
+  } else {
+    found = readLastDump(std::cin, records);
+  }
+
+  if (!found) {
+    fprintf(stderr, "no complete #TRACE ... #END block found\n");
+    return 1;
+  }
+
+  if (chrome) {
+    printChrome(records);
+  } else {
+    printText(records);
+  }
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include "trace_dump.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "profile_phases.h"
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool parseRecordLine(const std::string& line, TraceRecord& record) {
+  std::string hex = line;
+  while (!hex.empty() && (hex.back() == '\r' || hex.back() == ' ')) hex.pop_back();
+  if (hex.size() != sizeof(TraceRecord) * 2) return false;
+
+  uint8_t bytes[sizeof(TraceRecord)];
+  for (size_t i = 0; i < sizeof(bytes); i++) {
+    int hi = hexValue(hex[i * 2]);
+    int lo = hexValue(hex[i * 2 + 1]);
+    if (hi < 0 || lo < 0) return false;
+    bytes[i] = (uint8_t)((hi << 4) | lo);
+  }
+
+  record.timestampUs = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+  record.event = (uint16_t)(bytes[4] | (bytes[5] << 8));
+  record.aux = (uint16_t)(bytes[6] | (bytes[7] << 8));
+  record.arg = (int32_t)((uint32_t)bytes[8] | ((uint32_t)bytes[9] << 8) | ((uint32_t)bytes[10] << 16) | ((uint32_t)bytes[11] << 24));
+  return true;
+}
+
+// Little-endian field by field, which is what the ESP32's in-memory layout
+// gives traceDump().
+std::string formatRecordLine(const TraceRecord& record) {
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+  uint8_t bytes[sizeof(TraceRecord)];
+  uint32_t arg = (uint32_t)record.arg;
+  for (int i = 0; i < 4; i++) bytes[i] = (uint8_t)(record.timestampUs >> (8 * i));
+  bytes[4] = (uint8_t)record.event;
+  bytes[5] = (uint8_t)(record.event >> 8);
+  bytes[6] = (uint8_t)record.aux;
+  bytes[7] = (uint8_t)(record.aux >> 8);
+  for (int i = 0; i < 4; i++) bytes[8 + i] = (uint8_t)(arg >> (8 * i));
+
+  std::string line;
+  for (uint8_t b : bytes) {
+    line += HEX_DIGITS[b >> 4];
+    line += HEX_DIGITS[b & 0x0F];
+  }
+  return line;
+}
+
+// Earlier complete dumps are older snapshots of the same ring.
+bool readLastDump(std::istream& in, std::vector<DecodedRecord>& out) {
+  std::vector<DecodedRecord> current;
+  bool inDump = false;
+  bool found = false;
+  std::string line;
+
+  while (std::getline(in, line)) {
+    if (line.compare(0, 6, "#TRACE") == 0) {
+      inDump = true;
+      current.clear();
+      continue;
+    }
+    if (!inDump) continue;
+    if (line.compare(0, 4, "#END") == 0) {
+      out.swap(current);
+      inDump = false;
+      found = true;
+      continue;
+    }
+
+    TraceRecord record;
+    if (!parseRecordLine(line, record)) continue;
+
+    // micros() wraps every ~71 minutes; unwrap against the previous record.
+    uint64_t timestamp = record.timestampUs;
+    if (!current.empty()) {
+      uint64_t previous = current.back().timestampUs;
+      uint64_t epoch = previous & ~0xFFFFFFFFULL;
+      timestamp += epoch;
+      if (timestamp < previous) timestamp += 0x100000000ULL;
+    }
+    current.push_back({timestamp, record});
+  }
+  return found;
+}
+
+std::string formatArg(const TraceRecord& r) {
+  const TraceEventInfo& info = traceEventInfo(r.event);
+  char buf[96];
+
+  switch (info.argKind) {
+    case TRACE_ARG_NONE:
+      buf[0] = '\0';
+      break;
+    case TRACE_ARG_INT:
+      snprintf(buf, sizeof(buf), "%ld", (long)r.arg);
+      break;
+    case TRACE_ARG_FLOAT: {
+      float value;
+      memcpy(&value, &r.arg, sizeof(value));
+      snprintf(buf, sizeof(buf), "%g", value);
+      break;
+    }
+    case TRACE_ARG_IPV4: {
+      uint32_t ip = (uint32_t)r.arg;
+      snprintf(buf, sizeof(buf), "%u.%u.%u.%u", ip & 0xFF, (ip >> 8) & 0xFF, (ip >> 16) & 0xFF, ip >> 24);
+      break;
+    }
+    case TRACE_ARG_MAC: {
+      uint32_t low = (uint32_t)r.arg;
+      snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", r.aux >> 8, r.aux & 0xFF,
+               low >> 24, (low >> 16) & 0xFF, (low >> 8) & 0xFF, low & 0xFF);
+      break;
+    }
+    case TRACE_ARG_PHASE:
+      if (r.event == TRACE_PHASE_END) {
+        snprintf(buf, sizeof(buf), "%s %ld us", profilePhaseName(r.aux), (long)r.arg);
+      } else {
+        snprintf(buf, sizeof(buf), "%s", profilePhaseName(r.aux));
+      }
+      break;
+  }
+  return buf;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "trace_events.h"
+
+// Parsing of the `trace` serial dump, shared by the decoder and its fuzz
+// target.
+
+struct DecodedRecord {
+  uint64_t timestampUs;
+  TraceRecord raw;
+};
+
+// One 24-hex-digit dump line (trailing CR/spaces allowed) into a record.
+bool parseRecordLine(const std::string& line, TraceRecord& record);
+
+// The dump line traceDump() prints for a record.
+std::string formatRecordLine(const TraceRecord& record);
+
+// Keeps only the last complete "#TRACE ... #END" block, with timestamps
+// unwrapped to 64 bits. Returns false when there is none.
+bool readLastDump(std::istream& in, std::vector<DecodedRecord>& out);
+
+// The record's argument rendered for its event kind; empty when it has none.
+std::string formatArg(const TraceRecord& record);